@@ -0,0 +1,210 @@
+// Repeatable microbenchmarks for the CPU side of the molecule pipeline. Needs no display or GL context.
+// Usage: GeoLDMVizBenchmark [--filter <substring>] [--out <results.json>] [--res <resource dir>]
+// Results are written as JSON (to stdout if no `--out` is given), for comparing runs across versions.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <format>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "ChainAlignment.h"
+#include "DatasetConfig.h"
+#include "Molecule.h"
+#include "MoleculeData.h"
+#include "SyntheticAtoms.h"
+
+using Clock = std::chrono::steady_clock;
+
+static const QM9WithH DatasetConfig;
+
+// Bond detection is quadratic in the number of atoms, so skip it (and anything constructing a `Molecule`) above this size.
+static const uint MaxQuadraticAtoms = 10'000;
+static const uint SyntheticAtomCounts[] = {20, 100, 1'000, 10'000, 100'000};
+
+// Prevent the compiler from optimizing away a computed value.
+template<typename T> static void DoNotOptimize(const T &value) { asm volatile("" : : "g"(&value) : "memory"); }
+
+struct BenchmarkResult {
+    std::string Name;
+    uint Iterations;
+    double MinNs, MedianNs, MeanNs;
+    uint64_t ItemsPerIteration; // E.g. atoms or files, for throughput.
+};
+
+struct BenchmarkRunner {
+    std::string Filter;
+    std::vector<BenchmarkResult> Results;
+
+    // Runs `fn` repeatedly for roughly `TargetDuration`, timing each iteration separately.
+    void Run(const std::string &name, uint64_t items_per_iteration, const std::function<void()> &fn) {
+        if (!Filter.empty() && name.find(Filter) == std::string::npos) return;
+
+        static const auto TargetDuration = std::chrono::milliseconds(500);
+        static const uint MinIterations = 5, MaxIterations = 100'000;
+
+        fn(); // Warm up caches and allocators.
+        std::vector<double> times_ns;
+        const auto start = Clock::now();
+        while (times_ns.size() < MinIterations || (times_ns.size() < MaxIterations && Clock::now() - start < TargetDuration)) {
+            const auto iteration_start = Clock::now();
+            fn();
+            times_ns.push_back(std::chrono::duration<double, std::nano>(Clock::now() - iteration_start).count());
+        }
+
+        std::sort(times_ns.begin(), times_ns.end());
+        double sum = 0;
+        for (const double t : times_ns) sum += t;
+        const auto &result = Results.emplace_back(BenchmarkResult{name, uint(times_ns.size()), times_ns.front(), times_ns[times_ns.size() / 2], sum / times_ns.size(), items_per_iteration});
+        std::cerr << std::format("{:<48} {:>10.3f} us (min {:>10.3f} us, {} iterations)\n", name, result.MedianNs / 1e3, result.MinNs / 1e3, result.Iterations);
+    }
+
+    std::string ToJson() const {
+        char date[32];
+        const std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%FT%TZ", std::gmtime(&now));
+
+        std::ostringstream json;
+        json << "{\n  \"context\": {\"date\": \"" << date
+             << "\", \"num_cpus\": " << std::thread::hardware_concurrency()
+#ifdef NDEBUG
+             << ", \"build_type\": \"release\""
+#else
+             << ", \"build_type\": \"debug\""
+#endif
+             << "},\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < Results.size(); i++) {
+            const auto &r = Results[i];
+            json << std::format(
+                "    {{\"name\": \"{}\", \"iterations\": {}, \"min_ns\": {:.1f}, \"median_ns\": {:.1f}, \"mean_ns\": {:.1f}, \"items_per_second\": {:.1f}}}{}\n",
+                r.Name, r.Iterations, r.MinNs, r.MedianNs, r.MeanNs, r.ItemsPerIteration * 1e9 / r.MedianNs, i + 1 < Results.size() ? "," : ""
+            );
+        }
+        json << "  ]\n}\n";
+        return json.str();
+    }
+};
+
+static fs::path WriteXyzFile(const MoleculeData &molecule, const fs::path &path) {
+    std::ofstream file(path);
+    file << molecule.NumAtoms() << "\n\n";
+    for (uint i = 0; i < molecule.NumAtoms(); i++) {
+        file << std::format("{} {:.9f} {:.9f} {:.9f}\n", DatasetConfig.AtomDecoder[molecule.Types[i]], molecule.X[i], molecule.Y[i], molecule.Z[i]);
+    }
+    return path;
+}
+
+static int PrintUsage() {
+    std::cerr << "Usage: GeoLDMVizBenchmark [--filter <substring>] [--out <results.json>] [--res <resource dir>]" << std::endl;
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    BenchmarkRunner runner;
+    fs::path out_path, res_path = "res";
+    // Every option takes a value.
+    for (int i = 1; i < argc; i += 2) {
+        const char *option = argv[i], *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            std::cerr << "Missing value for " << option << std::endl;
+            return PrintUsage();
+        }
+        if (std::strcmp(option, "--filter") == 0) runner.Filter = value;
+        else if (std::strcmp(option, "--out") == 0) out_path = value;
+        else if (std::strcmp(option, "--res") == 0) res_path = value;
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return PrintUsage();
+        }
+    }
+
+    std::vector<fs::path> chain_paths;
+    for (const auto &entry : fs::directory_iterator(res_path / "chain_0")) {
+        if (entry.path().extension() == ".txt") chain_paths.push_back(entry.path());
+    }
+    std::sort(chain_paths.begin(), chain_paths.end());
+    if (chain_paths.empty()) {
+        std::cerr << "No chain files found in " << res_path / "chain_0" << std::endl;
+        return 1;
+    }
+    const MoleculeData final_chain_molecule = *ReadXyzFile(chain_paths.back());
+
+    // Parsing
+    runner.Run("ParseXyz/chain_0", chain_paths.size(), [&] {
+        for (const auto &path : chain_paths) DoNotOptimize(ReadXyzFile(path));
+    });
+    const fs::path synthetic_dir = fs::temp_directory_path() / "geoldmviz_benchmark";
+    fs::create_directories(synthetic_dir);
+    for (const uint num_atoms : SyntheticAtomCounts) {
+        const auto path = WriteXyzFile(MakeSyntheticAtoms(num_atoms), synthetic_dir / std::format("synthetic_{}.txt", num_atoms));
+        runner.Run(std::format("ParseXyz/synthetic_{}", num_atoms), num_atoms, [&] { DoNotOptimize(ReadXyzFile(path)); });
+    }
+    fs::remove_all(synthetic_dir);
+
+    // Bonds
+    runner.Run("GetBondOrder", 1000, [&] {
+        for (uint i = 0; i < 1000; i++) {
+            const auto &a = DatasetConfig.AtomDecoder[i % 5], &b = DatasetConfig.AtomDecoder[(i / 5) % 5];
+            DoNotOptimize(GetBondOrder(a, b, 1.0 + (i % 100) * 0.01));
+        }
+    });
+    runner.Run("FindBonds/chain_0_final", final_chain_molecule.NumAtoms(), [&] { DoNotOptimize(FindBonds(final_chain_molecule)); });
+    for (const uint num_atoms : SyntheticAtomCounts) {
+        if (num_atoms > MaxQuadraticAtoms) continue;
+        const auto molecule = MakeSyntheticAtoms(num_atoms);
+        runner.Run(std::format("FindBonds/synthetic_{}", num_atoms), num_atoms, [&] { DoNotOptimize(FindBonds(molecule)); });
+    }
+
+    // Geometry generation
+    runner.Run("Sphere/recursion_3", 1, [] { DoNotOptimize(Sphere{}); });
+    runner.Run("Cylinder/slices_32", 1, [] { DoNotOptimize(Cylinder{}); });
+
+    // Instance updates
+    for (const uint num_atoms : SyntheticAtomCounts) {
+        if (num_atoms > MaxQuadraticAtoms) continue;
+        Molecule molecule(MakeSyntheticAtoms(num_atoms), "synthetic");
+        runner.Run(std::format("SetAtomScale/synthetic_{}", num_atoms), num_atoms, [&] { molecule.SetAtomScale(0.5); });
+        runner.Run(std::format("SetBondRadius/synthetic_{}", num_atoms), molecule.BondMesh.NumInstances(), [&] { molecule.SetBondRadius(1.2); });
+    }
+
+    // Alignment
+    {
+        std::vector<MoleculeData> chain;
+        chain.reserve(chain_paths.size());
+        for (const auto &path : chain_paths) chain.push_back(*ReadXyzFile(path));
+        std::vector<const MoleculeData *> frames;
+        uint num_atoms = 0;
+        for (const auto &data : chain) {
+            frames.push_back(&data);
+            num_atoms += data.NumAtoms();
+        }
+        runner.Run("AlignFrame/chain_0_first", chain.front().NumAtoms(), [&] { DoNotOptimize(AlignFrame(chain.front(), chain.back())); });
+        runner.Run("AlignChain/chain_0", num_atoms, [&] { DoNotOptimize(AlignChain(frames)); });
+    }
+    for (const uint num_atoms : SyntheticAtomCounts) {
+        const auto molecule = MakeSyntheticAtoms(num_atoms);
+        runner.Run(std::format("AlignFrame/synthetic_{}", num_atoms), num_atoms, [&] { DoNotOptimize(AlignFrame(molecule, molecule)); });
+    }
+
+    // Whole-chain loading: everything `MoleculeChain` does per file, except the GL uploads.
+    runner.Run("LoadChain/chain_0", chain_paths.size(), [&] {
+        std::vector<Molecule> molecules;
+        molecules.reserve(chain_paths.size());
+        for (const auto &path : chain_paths) molecules.emplace_back(path);
+        DoNotOptimize(molecules);
+    });
+
+    const auto json = runner.ToJson();
+    if (out_path.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream(out_path) << json;
+        std::cerr << "Wrote " << out_path << std::endl;
+    }
+    return 0;
+}
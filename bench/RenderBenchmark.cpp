@@ -0,0 +1,286 @@
+// Scripted, reproducible rendering benchmark.
+// Renders the scene offscreen from a hidden window, so it also runs on software GL (e.g. Mesa llvmpipe) on machines with no GPU or display.
+// Usage: GeoLDMVizRenderBenchmark [--chain <dir>] [--atoms <n>] [--frames <n>] [--width <px>] [--height <px>] [--aa none|msaa|fxaa] [--depth-prepass on|off] [--sort on|off] [--out <results.json>]
+// Each input flies the same camera path twice: once showing only the final molecule ("orbit"), and once showing a different chain molecule every frame ("scrub").
+// Each frame ends with `glFinish`, so frame times include all GPU work. Results are written as JSON (to stdout if no `--out` is given),
+// along with each chain's memory usage and any GPU memory still allocated after unloading all chains (leaks).
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <strings.h>
+
+#include <GL/glew.h>
+#include <SDL.h>
+#include <SDL_opengl.h>
+
+#include "CommandLine.h"
+#include "GLCanvas.h"
+#include "Memory.h"
+#include "Molecule.h"
+#include "Profiler.h"
+#include "Scene.h"
+#include "SyntheticAtoms.h"
+
+using Clock = std::chrono::steady_clock;
+
+static const uint WarmupFrames = 10; // Not measured, so first-use costs (buffer and framebuffer creation) don't skew the results.
+static const glm::vec4 BackgroundColor{0.1, 0.1, 0.1, 1};
+
+struct Options {
+    fs::path ChainPath = fs::path("res") / "chain_0"; // Empty to skip.
+    uint NumSyntheticAtoms = 10'000; // 0 to skip.
+    uint NumFrames = 600, Width = 1280, Height = 720;
+    AntiAliasing Aa = AntiAliasing::Msaa;
+    bool DepthPrePass = false, SortFrontToBack = false;
+    fs::path OutPath;
+};
+
+struct RenderResult {
+    std::string Name;
+    uint Frames;
+    double MeanMs, P50Ms, P90Ms, P99Ms, MaxMs;
+    double DrawCalls, Triangles, UploadedBytes; // Per-frame means
+    double ShadedSamples; // Per-frame mean of samples passing the depth test in the shading pass.
+    MemoryUsage ChainMemory; // After the run, excluding shared geometry.
+};
+
+// One full orbit with a slow elevation sweep, dollying from the fitted distance in to a close-up and back out,
+// so the path covers both wide shots and overdraw-heavy close views. `t` is in [0, 1).
+static void SetCameraOnPath(Scene &scene, float t, float fitted_distance) {
+    const float azimuth = 2 * M_PI * t;
+    const float elevation = 0.4f * std::sin(4 * M_PI * t);
+    const float distance = fitted_distance * (0.6f + 0.4f * std::cos(2 * M_PI * t));
+    const glm::vec3 eye{std::cos(azimuth) * std::cos(elevation), std::sin(elevation), std::sin(azimuth) * std::cos(elevation)};
+    scene.CameraDistance = distance;
+    scene.CameraView = glm::lookAt(eye * distance, Origin, Up);
+}
+
+static RenderResult RunCameraPath(const std::string &name, Scene &scene, MoleculeChain &chain, bool scrub, const Options &options) {
+    const uint num_molecules = chain.Molecules.size();
+    chain.SetMoleculeIndex(num_molecules - 1);
+    // Fit the path to the final molecule, and keep it fixed while scrubbing so every run sees the same views.
+    const float fitted_distance = scene.CameraDistance;
+
+    std::vector<double> frame_ms;
+    double draw_calls = 0, triangles = 0, uploaded_bytes = 0, shaded_samples = 0;
+    uint num_shaded_samples = 0;
+    uint64_t shaded_samples_count = Profiler::GetLatestSamplesPassed(Scene::ShadedSamplesZone).Count;
+    for (uint frame = 0; frame < WarmupFrames + options.NumFrames; frame++) {
+        const bool measured = frame >= WarmupFrames;
+        const uint path_frame = measured ? frame - WarmupFrames : frame;
+
+        Profiler::BeginFrame();
+        const auto start = Clock::now();
+        if (scrub) chain.SetMoleculeIndex(path_frame % num_molecules);
+        SetCameraOnPath(scene, float(path_frame) / options.NumFrames, fitted_distance);
+        scene.RenderCanvas(options.Width, options.Height, BackgroundColor);
+        glFinish();
+        const auto end = Clock::now();
+        Profiler::EndFrame();
+
+        if (!measured) continue;
+
+        frame_ms.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        const auto &counters = Profiler::GetLastFrameCounters();
+        draw_calls += counters.DrawCalls;
+        triangles += counters.Triangles;
+        uploaded_bytes += counters.UploadedBytes;
+        // Read back at the start of the next frame, so this is the previous frame's count.
+        if (const auto shaded = Profiler::GetLatestSamplesPassed(Scene::ShadedSamplesZone); shaded.Count != shaded_samples_count) {
+            shaded_samples_count = shaded.Count;
+            shaded_samples += shaded.Value;
+            num_shaded_samples++;
+        }
+    }
+
+    const uint n = frame_ms.size();
+    double sum = 0;
+    for (const double ms : frame_ms) sum += ms;
+    std::sort(frame_ms.begin(), frame_ms.end());
+    const auto percentile = [&](double p) { return frame_ms[std::min(n - 1, uint(p * n))]; };
+    RenderResult result{name, n, sum / n, percentile(0.5), percentile(0.9), percentile(0.99), frame_ms.back(), draw_calls / n, triangles / n, uploaded_bytes / n, num_shaded_samples > 0 ? shaded_samples / num_shaded_samples : 0, {}};
+    std::cerr << std::format(
+        "{:<32} p50 {:>8.3f} ms  p90 {:>8.3f} ms  p99 {:>8.3f} ms  {:>6.1f} draws  {:>10.0f} tris  {:>10.1f} KB/frame  {:>10.0f} shaded\n",
+        name, result.P50Ms, result.P90Ms, result.P99Ms, result.DrawCalls, result.Triangles, result.UploadedBytes / 1024, result.ShadedSamples
+    );
+    return result;
+}
+
+static void RunChain(const std::string &name, Scene &scene, MoleculeChain &chain, const Options &options, std::vector<RenderResult> &results) {
+    if (chain.Molecules.empty()) return;
+
+    results.push_back(RunCameraPath(name + "/orbit", scene, chain, false, options));
+    results.back().ChainMemory = chain.GetMemoryReport().Total();
+    if (chain.Molecules.size() > 1) {
+        results.push_back(RunCameraPath(name + "/scrub", scene, chain, true, options));
+        results.back().ChainMemory = chain.GetMemoryReport().Total();
+    }
+}
+
+static std::string ToJson(const std::vector<RenderResult> &results, const Options &options, int64_t leaked_gpu_bytes) {
+    char date[32];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%FT%TZ", std::gmtime(&now));
+
+    std::ostringstream json;
+    json << "{\n  \"context\": {\"date\": \"" << date
+         << "\", \"renderer\": \"" << (const char *)glGetString(GL_RENDERER)
+         << "\", \"gl_version\": \"" << (const char *)glGetString(GL_VERSION)
+         << "\", \"width\": " << options.Width << ", \"height\": " << options.Height
+         << ", \"anti_aliasing\": \"" << AntiAliasingNames[size_t(options.Aa)] << "\""
+         << ", \"depth_prepass\": " << (options.DepthPrePass ? "true" : "false")
+         << ", \"sort_front_to_back\": " << (options.SortFrontToBack ? "true" : "false")
+         << ", \"leaked_gpu_bytes\": " << leaked_gpu_bytes
+#ifdef NDEBUG
+         << ", \"build_type\": \"release\""
+#else
+         << ", \"build_type\": \"debug\""
+#endif
+         << "},\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto &r = results[i];
+        json << std::format(
+            "    {{\"name\": \"{}\", \"frames\": {}, \"mean_ms\": {:.3f}, \"p50_ms\": {:.3f}, \"p90_ms\": {:.3f}, \"p99_ms\": {:.3f}, \"max_ms\": {:.3f}, "
+            "\"draw_calls_per_frame\": {:.1f}, \"triangles_per_frame\": {:.0f}, \"uploaded_bytes_per_frame\": {:.0f}, \"shaded_samples_per_frame\": {:.0f}, \"chain_memory\": {}}}{}\n",
+            r.Name, r.Frames, r.MeanMs, r.P50Ms, r.P90Ms, r.P99Ms, r.MaxMs, r.DrawCalls, r.Triangles, r.UploadedBytes, r.ShadedSamples, r.ChainMemory.ToJson(), i + 1 < results.size() ? "," : ""
+        );
+    }
+    json << "  ]\n}\n";
+    return json.str();
+}
+
+static int PrintUsage() {
+    std::cerr << "Usage: GeoLDMVizRenderBenchmark [--chain <dir>] [--atoms <n>] [--frames <n>] [--width <px>] [--height <px>] [--aa none|msaa|fxaa] "
+                 "[--depth-prepass on|off] [--sort on|off] [--out <results.json>]"
+              << std::endl;
+    return 1;
+}
+
+static bool ParseAntiAliasing(const char *value, AntiAliasing &result) {
+    for (size_t mode = 0; mode < size_t(AntiAliasing::Count); mode++) {
+        if (strcasecmp(value, AntiAliasingNames[mode]) == 0) {
+            result = AntiAliasing(mode);
+            return true;
+        }
+    }
+    return false;
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    // Every option takes a value. Bad options fail the run, so a scripted job never benchmarks something other than what it asked for.
+    for (int i = 1; i < argc; i += 2) {
+        const char *option = argv[i], *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            std::cerr << "Missing value for " << option << std::endl;
+            return PrintUsage();
+        }
+        bool valid = true;
+        if (std::strcmp(option, "--chain") == 0) options.ChainPath = value;
+        else if (std::strcmp(option, "--atoms") == 0) valid = ParseCount(value, options.NumSyntheticAtoms);
+        else if (std::strcmp(option, "--frames") == 0) valid = ParseCount(value, options.NumFrames);
+        else if (std::strcmp(option, "--width") == 0) valid = ParseCount(value, options.Width);
+        else if (std::strcmp(option, "--height") == 0) valid = ParseCount(value, options.Height);
+        else if (std::strcmp(option, "--out") == 0) options.OutPath = value;
+        else if (std::strcmp(option, "--aa") == 0) valid = ParseAntiAliasing(value, options.Aa);
+        else if (std::strcmp(option, "--depth-prepass") == 0) valid = ParseOnOff(value, options.DepthPrePass);
+        else if (std::strcmp(option, "--sort") == 0) valid = ParseOnOff(value, options.SortFrontToBack);
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return PrintUsage();
+        }
+        if (!valid) {
+            std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+            return PrintUsage();
+        }
+    }
+    options.NumFrames = std::max(options.NumFrames, 1u);
+    options.Width = std::max(options.Width, 1u);
+    options.Height = std::max(options.Height, 1u);
+
+    // Without a display server, fall back to SDL's offscreen (EGL) video driver. Both spellings, for older and newer SDL3.
+    if (!std::getenv("DISPLAY") && !std::getenv("WAYLAND_DISPLAY")) {
+        setenv("SDL_VIDEO_DRIVER", "offscreen", 0);
+        setenv("SDL_VIDEODRIVER", "offscreen", 0);
+    }
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        std::cerr << "Error: " << SDL_GetError() << '\n';
+        return 1;
+    }
+
+    // Same GL version as the app.
+#if defined(__APPLE__)
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_FORWARD_COMPATIBLE_FLAG);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 2);
+#else
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, 0);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 0);
+#endif
+    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+
+    // Everything is drawn into the scene's own frame buffer, so the window is never shown or swapped.
+    SDL_Window *window = SDL_CreateWindowWithPosition("GeoLDMViz render benchmark", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 64, 64, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    SDL_GLContext gl_context = window ? SDL_GL_CreateContext(window) : nullptr;
+    if (!gl_context) {
+        std::cerr << "Error creating GL context: " << SDL_GetError() << '\n';
+        return 1;
+    }
+    SDL_GL_MakeCurrent(window, gl_context);
+
+    const int glew_result = glewInit();
+    if (glew_result != GLEW_OK && glew_result != GLEW_ERROR_NO_GLX_DISPLAY) {
+        std::cerr << "Error initializing `glew`: Error " << glew_result << '\n';
+        return 1;
+    }
+    std::cerr << "Renderer: " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")\n";
+
+    std::vector<RenderResult> results;
+    int64_t leaked_gpu_bytes = 0;
+    {
+        Scene scene;
+        scene.Canvas->SetAntiAliasing(options.Aa);
+        scene.DepthPrePass = options.DepthPrePass;
+        scene.SortFrontToBack = options.SortFrontToBack;
+        if (!options.ChainPath.empty()) {
+            MoleculeChain chain(options.ChainPath, &scene);
+            RunChain(chain.GetName(), scene, chain, options, results);
+        }
+        if (options.NumSyntheticAtoms > 0) {
+            MoleculeChain chain(&scene);
+            chain.Append(MakeSyntheticAtoms(options.NumSyntheticAtoms), "synthetic");
+            RunChain(std::format("synthetic_{}", options.NumSyntheticAtoms), scene, chain, options, results);
+        }
+
+        // With all chains unloaded, only the scene and the shared geometry should still hold GPU memory.
+        MemoryUsage expected = scene.GetMemoryUsage();
+        expected += Molecule::GetSharedGeometryMemoryUsage();
+        leaked_gpu_bytes = int64_t(LiveGpuMemory.TotalGpu()) - int64_t(expected.TotalGpu());
+        if (leaked_gpu_bytes != 0) std::cerr << "Warning: " << leaked_gpu_bytes << " bytes of GPU memory leaked after unloading all chains.\n";
+    }
+
+    const auto json = ToJson(results, options, leaked_gpu_bytes);
+    GLContextAlive = false;
+    SDL_GL_DeleteContext(gl_context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+
+    if (options.OutPath.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream(options.OutPath) << json;
+        std::cerr << "Wrote " << options.OutPath << std::endl;
+    }
+    return 0;
+}
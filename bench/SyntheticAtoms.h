@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cmath>
+#include <random>
+
+#include "MoleculeData.h"
+
+// Deterministic QM9-like atoms: a jittered lattice with roughly bond-length spacing, so bond detection finds realistic neighbors.
+inline MoleculeData MakeSyntheticAtoms(uint num_atoms) {
+    std::mt19937 rng(num_atoms);
+    std::uniform_real_distribution<float> jitter(-0.15f, 0.15f);
+    std::discrete_distribution<uint> type({0.5, 0.35, 0.06, 0.08, 0.01}); // H, C, N, O, F
+    static const float Spacing = 1.3;
+    const uint side = std::ceil(std::cbrt(float(num_atoms)));
+
+    MoleculeData molecule;
+    molecule.Reserve(num_atoms);
+    for (uint i = 0; i < num_atoms; i++) {
+        const uint8_t atom_type = type(rng);
+        const glm::vec3 lattice{float(i % side), float((i / side) % side), float(i / (side * side))};
+        molecule.AddAtom(atom_type, lattice * Spacing + glm::vec3{jitter(rng), jitter(rng), jitter(rng)});
+    }
+    return molecule;
+}
@@ -0,0 +1,13 @@
+#version 330 core
+
+// Depth-only pre-pass: no color outputs, and no lighting.
+// Translucent fragments are skipped when they're drawn in a later transparency pass (see fragment.glsl),
+// so they don't hide what's behind them.
+
+uniform int transparency_pass;
+
+in vec4 frag_in_color;
+
+void main() {
+    if (transparency_pass == 1 && frag_in_color.a < 1.0) discard;
+}
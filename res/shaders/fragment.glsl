@@ -2,43 +2,78 @@
 
 struct Light {
     vec4 position;
-    vec4 color;
+    vec4 color; // Radius in alpha, 0 for unbounded.
 };
 
-uniform int num_lights;
 uniform vec4 ambient_color, diffuse_color, specular_color;
 uniform float shininess_factor;
 uniform int flat_shading; // 0 for smooth shading, 1 for flat shading
+// 0: Draw everything, blended in draw order.
+// 1: Opaque pass. Draw only opaque fragments.
+// 2: Transparent pass. Draw only translucent fragments, into the weighted blended order-independent transparency targets.
+uniform int transparency_pass;
 
-const int max_num_lights = 5; // Must be a constant. (Can't be a uniform.)
+const int max_num_lights = 256; // Must be a constant. (Can't be a uniform.) Must match `LightTiles::MaxLights`.
 layout (std140) uniform LightBlock {
     Light lights[max_num_lights];
 };
 
+// Tiled forward lighting (see `LightTiles`): each screen tile lists the lights reaching it.
+uniform int tile_size, tile_columns;
+uniform usamplerBuffer tile_lights; // (offset into `light_indices`, number of lights) per tile.
+uniform usamplerBuffer light_indices;
+
 in vec4 frag_in_position;
 in vec3 frag_in_normal;
 in vec4 frag_in_color;
 
-out vec4 frag_color;
+layout (location = 0) out vec4 frag_color; // Accumulated premultiplied color (rgb) and revealage (a) in the transparent pass.
+layout (location = 1) out vec4 frag_weight; // Transparent pass only. Accumulated weight (r).
 
-vec4 compute_lighting(vec3 direction, vec4 light_color, vec3 normal, vec3 half_vector) {
-    vec4 lambert = diffuse_color * light_color * max(dot(normal, direction), 0.0);
-    vec4 phong = specular_color * light_color * pow(max(dot(normal, half_vector), 0.0), shininess_factor);
+vec3 compute_lighting(vec3 direction, vec3 light_color, vec3 normal, vec3 half_vector) {
+    vec3 lambert = diffuse_color.rgb * light_color * max(dot(normal, direction), 0.0);
+    vec3 phong = specular_color.rgb * light_color * pow(max(dot(normal, half_vector), 0.0), shininess_factor);
     return lambert + phong;
-}       
+}
+
+// Smooth windowed inverse-square falloff, reaching zero at the radius.
+float attenuation(float distance, float radius) {
+    if (radius <= 0.0) return 1.0;
+    float ratio = distance / radius;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window / (1.0 + distance * distance);
+}
+
+// Weight translucent fragments by coverage and closeness, so nearer surfaces dominate the composite.
+// Equation 10 from McGuire & Bavoil, "Weighted Blended Order-Independent Transparency" (2013), using window-space depth.
+float transparency_weight(float alpha) {
+    float depth = 1.0 - gl_FragCoord.z * 0.9;
+    return clamp(pow(min(1.0, alpha * 10.0) + 0.01, 3.0) * 1e8 * depth * depth * depth, 1e-2, 3e3);
+}
 
 void main (void) {
+    bool opaque = frag_in_color.a >= 1.0;
+    if ((transparency_pass == 1 && !opaque) || (transparency_pass == 2 && opaque)) discard;
+
     vec3 fragment_position = frag_in_position.xyz / frag_in_position.w;
     vec3 eye_direction = normalize(-fragment_position);
     vec3 normal = normalize(flat_shading == 1 ? cross(dFdx(fragment_position), dFdy(fragment_position)) : frag_in_normal);
-    vec4 final_color = ambient_color;
-    for (int i = 0; i < num_lights; i++) {
-        vec4 light_pos = lights[i].position;
-        vec3 pos = light_pos.xyz / light_pos.w;
-        vec3 dir = normalize(pos - fragment_position);
+    vec3 final_color = ambient_color.rgb;
+    ivec2 tile_coord = ivec2(gl_FragCoord.xy) / tile_size;
+    uvec2 tile = texelFetch(tile_lights, tile_coord.y * tile_columns + tile_coord.x).xy;
+    for (uint i = 0u; i < tile.y; i++) {
+        Light light = lights[texelFetch(light_indices, int(tile.x + i)).r];
+        vec3 pos = light.position.xyz / light.position.w;
+        vec3 to_light = pos - fragment_position;
+        vec3 dir = normalize(to_light);
         vec3 half_vector = normalize(dir + eye_direction);
-        final_color += compute_lighting(dir, lights[i].color, normal, half_vector);
+        final_color += compute_lighting(dir, light.color.rgb, normal, half_vector) * attenuation(length(to_light), light.color.a);
     }
 
-    frag_color = final_color * frag_in_color;
+    frag_color = vec4(final_color * frag_in_color.rgb, frag_in_color.a);
+    if (transparency_pass == 2) {
+        float alpha = frag_color.a, weight = transparency_weight(alpha);
+        frag_color = vec4(frag_color.rgb * alpha * weight, alpha);
+        frag_weight = vec4(alpha * weight);
+    }
 }
@@ -0,0 +1,9 @@
+#version 330 core
+
+// One triangle covering the whole viewport, for post-process passes.
+// Draw 3 vertices with an empty vertex array bound. Positions are derived from the vertex index.
+
+void main() {
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
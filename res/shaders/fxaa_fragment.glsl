@@ -0,0 +1,40 @@
+#version 330 core
+
+// Fast approximate anti-aliasing (after Timothy Lottes' FXAA), as a post-process pass over a single-sample color texture.
+// Estimates the local edge direction from luma differences, and blends along it.
+
+uniform sampler2D source;
+uniform vec2 texel_size; // 1 / source texture size
+uniform vec2 max_uv; // The rendered region can be smaller than the texture.
+
+out vec4 frag_color;
+
+const float ReduceMin = 1.0 / 128.0;
+const float ReduceMul = 1.0 / 8.0;
+const float SpanMax = 8.0;
+
+vec3 sample_rgb(vec2 uv) { return texture(source, min(uv, max_uv)).rgb; }
+float luma(vec3 rgb) { return dot(rgb, vec3(0.299, 0.587, 0.114)); }
+
+void main() {
+    vec2 uv = gl_FragCoord.xy * texel_size;
+    vec3 rgb_m = sample_rgb(uv);
+    float luma_nw = luma(sample_rgb(uv + vec2(-1.0, -1.0) * texel_size));
+    float luma_ne = luma(sample_rgb(uv + vec2(1.0, -1.0) * texel_size));
+    float luma_sw = luma(sample_rgb(uv + vec2(-1.0, 1.0) * texel_size));
+    float luma_se = luma(sample_rgb(uv + vec2(1.0, 1.0) * texel_size));
+    float luma_m = luma(rgb_m);
+    float luma_min = min(luma_m, min(min(luma_nw, luma_ne), min(luma_sw, luma_se)));
+    float luma_max = max(luma_m, max(max(luma_nw, luma_ne), max(luma_sw, luma_se)));
+
+    vec2 dir = vec2(-((luma_nw + luma_ne) - (luma_sw + luma_se)), (luma_nw + luma_sw) - (luma_ne + luma_se));
+    float dir_reduce = max((luma_nw + luma_ne + luma_sw + luma_se) * (0.25 * ReduceMul), ReduceMin);
+    float dir_scale = 1.0 / (min(abs(dir.x), abs(dir.y)) + dir_reduce);
+    dir = clamp(dir * dir_scale, vec2(-SpanMax), vec2(SpanMax)) * texel_size;
+
+    vec3 rgb_a = 0.5 * (sample_rgb(uv + dir * (1.0 / 3.0 - 0.5)) + sample_rgb(uv + dir * (2.0 / 3.0 - 0.5)));
+    vec3 rgb_b = rgb_a * 0.5 + 0.25 * (sample_rgb(uv - dir * 0.5) + sample_rgb(uv + dir * 0.5));
+    float luma_b = luma(rgb_b);
+    // If the wider blend crossed into a different surface, fall back to the narrow one.
+    frag_color = vec4(luma_b < luma_min || luma_b > luma_max ? rgb_a : rgb_b, 1.0);
+}
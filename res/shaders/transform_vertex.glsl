@@ -3,22 +3,91 @@
 // Supports per-instance arbitrary 4x4 matrix transform and color.
 // Passes outputs to directly to fragment shader.
 
+// The bottom row of an affine instance transform is always (0, 0, 0, 1), so its first three elements carry per-instance metadata:
+//   Transform[0][3]: Bond order, for meshes with per-vertex copies (see `Cylinder`). Copy `i` is drawn only if `i < order`.
+//   Transform[1][3]: Grid cell index + 1, for drawing many molecules in one instanced draw. 0 for instances outside of any grid.
+//   Transform[2][3]: Element type + 1 of an atom, or of both bond atoms in base 64, for element masking. 0 for instances without elements.
+// Metadata is zeroed before the transform is applied.
+
 uniform mat4 camera_view;
 uniform mat4 projection;
+uniform int grid_columns, grid_rows;
+uniform float grid_spacing;
+// Instance data of sorted meshes, read by draw index (see `Mesh::SortFrontToBack`): four texels per transform, one per color.
+uniform samplerBuffer instance_transforms, instance_colors;
+
+// Bit `i` for element type `i` (see `ElementMask`).
+layout (std140) uniform ElementMaskBlock {
+    uint hidden_elements; // Hidden atoms, and bonds to them.
+    uint highlighted_elements; // Highlighted atoms.
+};
 
 layout (location = 0) in vec3 Pos;
 layout (location = 1) in vec3 Normal;
 layout (location = 2) in vec4 Color;
 layout (location = 3) in mat4 Transform;
+layout (location = 7) in float Copy; // 0 for meshes without copies.
+layout (location = 8) in float DrawIndex; // Instance index + 1 at this draw position of a sorted mesh. 0 (attribute disabled) to draw in instance order.
+
+// Identical depths in every program using this shader, so a depth pre-pass can be followed by an equal depth test.
+invariant gl_Position;
 
 out vec4 frag_in_position;
 out vec3 frag_in_normal;
 out vec4 frag_in_color;
 
+// Cells are laid out left-to-right, top-to-bottom, centered on the origin.
+vec3 grid_offset(float cell) {
+    vec2 column_row = vec2(mod(cell, float(grid_columns)), floor(cell / float(grid_columns)));
+    vec2 centered = column_row - vec2(grid_columns - 1, grid_rows - 1) * 0.5;
+    return vec3(centered.x, -centered.y, 0.0) * grid_spacing;
+}
+
+// Multi-order bonds are drawn as thinner parallel copies of the cylinder, spread along its local x axis.
+// Must match `MultiBondThickness` and `MultiBondSpacing` (relative to the unit bond cylinder's radius of 0.1).
+const float multi_bond_thickness = 0.5;
+const float multi_bond_spacing = 1.2 * 0.1;
+
+// Copies beyond the order collapse to a point, so they produce no fragments.
+vec3 expand_copy(vec3 position, float order) {
+    if (order <= 1.0) return Copy == 0.0 ? position : vec3(0.0);
+    if (Copy >= order) return vec3(0.0);
+
+    position.xz *= multi_bond_thickness;
+    position.x += (Copy - (order - 1.0) * 0.5) * multi_bond_spacing;
+    return position;
+}
+
+const vec3 highlight_color = vec3(1.0, 0.8, 0.0); // Must match `Highlight`.
+
+uint element_bit(uint element) { return element > 0u && element <= 32u ? 1u << (element - 1u) : 0u; }
+
 void main() {
-    frag_in_position = Transform * vec4(Pos, 1.0);
-    frag_in_normal = mat3(transpose(inverse(Transform))) * Normal;
-    frag_in_color = Color;
+    mat4 transform = Transform;
+    vec4 color = Color;
+    if (DrawIndex > 0.0) {
+        int instance = int(DrawIndex) - 1;
+        transform = mat4(
+            texelFetch(instance_transforms, instance * 4), texelFetch(instance_transforms, instance * 4 + 1),
+            texelFetch(instance_transforms, instance * 4 + 2), texelFetch(instance_transforms, instance * 4 + 3)
+        );
+        color = texelFetch(instance_colors, instance);
+    }
+    float order = transform[0][3], grid_cell = transform[1][3], elements = transform[2][3];
+    transform[0][3] = transform[1][3] = transform[2][3] = 0.0;
+
+    uint element_bits = element_bit(uint(mod(elements, 64.0))) | element_bit(uint(elements / 64.0));
+    if ((element_bits & hidden_elements) != 0u) {
+        // Outside the clip volume, so all of the instance's triangles are clipped.
+        gl_Position = vec4(0.0, 0.0, 2.0, 1.0);
+        return;
+    }
+
+    frag_in_position = transform * vec4(expand_copy(Pos, order), 1.0);
+    if (grid_cell > 0.0) frag_in_position.xyz += grid_offset(grid_cell - 1.0);
+    frag_in_normal = mat3(transpose(inverse(transform))) * Normal;
+    bool highlight = elements < 64.0 && (element_bits & highlighted_elements) != 0u; // Atoms only.
+    frag_in_color = highlight ? vec4(mix(color.rgb, highlight_color, 0.7), color.a) : color;
 
     gl_Position = projection * camera_view * frag_in_position;
 }
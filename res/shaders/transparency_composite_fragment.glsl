@@ -0,0 +1,36 @@
+#version 330 core
+
+// Composite the weighted blended order-independent transparency targets over the opaque image.
+// Blend with `glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA)`: the output alpha is the revealage (product of 1 - alpha).
+// Compile with `MULTISAMPLE` defined to read multisampled targets, averaging their samples.
+
+#ifdef MULTISAMPLE
+uniform sampler2DMS accumulation, weight;
+uniform int num_samples;
+#else
+uniform sampler2D accumulation, weight;
+#endif
+
+out vec4 frag_color;
+
+void main() {
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+#ifdef MULTISAMPLE
+    vec4 accumulated = vec4(0.0);
+    float total_weight = 0.0;
+    for (int i = 0; i < num_samples; i++) {
+        accumulated += texelFetch(accumulation, texel, i);
+        total_weight += texelFetch(weight, texel, i).r;
+    }
+    accumulated /= float(num_samples);
+    total_weight /= float(num_samples);
+#else
+    vec4 accumulated = texelFetch(accumulation, texel, 0);
+    float total_weight = texelFetch(weight, texel, 0).r;
+#endif
+
+    float revealage = accumulated.a;
+    if (revealage >= 1.0) discard; // No translucent fragments here.
+
+    frag_color = vec4(accumulated.rgb / clamp(total_weight, 1e-4, 5e4), revealage);
+}
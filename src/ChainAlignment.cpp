@@ -0,0 +1,199 @@
+#include "ChainAlignment.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+#include <glm/geometric.hpp>
+#include <glm/matrix.hpp>
+
+#include "Simd.h"
+#include "Trace.h"
+
+// Below this many atoms per thread, aligning in parallel costs more than it saves.
+static const uint MinAtomsPerThread = 16'384;
+
+// Sums over atoms read the contiguous X/Y/Z arrays four atoms at a time, one per SIMD lane (see `Float4`),
+// with the lanes' partial sums (and the last atoms, if fewer than four) added up in double precision at the end.
+
+glm::vec3 ComputeCentroid(const MoleculeData &molecule) {
+    const uint n = molecule.NumAtoms();
+    if (n == 0) return glm::vec3{0};
+
+    const float *x = molecule.X.data(), *y = molecule.Y.data(), *z = molecule.Z.data();
+    // Two blocks per iteration, so consecutive additions don't wait on each other.
+    Float4 sum_x[2]{0.f, 0.f}, sum_y[2]{0.f, 0.f}, sum_z[2]{0.f, 0.f};
+    const uint num_blocked = n / 8 * 8;
+    for (uint i = 0; i < num_blocked; i += 8) {
+        for (uint b = 0; b < 2; b++) {
+            sum_x[b] = sum_x[b] + Float4::Load(x + i + b * 4);
+            sum_y[b] = sum_y[b] + Float4::Load(y + i + b * 4);
+            sum_z[b] = sum_z[b] + Float4::Load(z + i + b * 4);
+        }
+    }
+    double sx = (sum_x[0] + sum_x[1]).Sum(), sy = (sum_y[0] + sum_y[1]).Sum(), sz = (sum_z[0] + sum_z[1]).Sum();
+    for (uint i = num_blocked; i < n; i++) {
+        sx += x[i];
+        sy += y[i];
+        sz += z[i];
+    }
+    return glm::vec3(sx / n, sy / n, sz / n);
+}
+
+using Matrix4 = std::array<std::array<double, 4>, 4>;
+
+// Largest eigenvalue of a symmetric 4x4 matrix, and its unit eigenvector, by cyclic Jacobi rotations.
+static std::pair<double, std::array<double, 4>> LargestEigen(Matrix4 a) {
+    Matrix4 v{};
+    for (uint i = 0; i < 4; i++) v[i][i] = 1;
+
+    for (uint sweep = 0; sweep < 32; sweep++) {
+        double off_diagonal = 0, diagonal = 0;
+        for (uint p = 0; p < 4; p++) {
+            diagonal += a[p][p] * a[p][p];
+            for (uint q = p + 1; q < 4; q++) off_diagonal += a[p][q] * a[p][q];
+        }
+        if (off_diagonal <= 1e-24 * diagonal) break;
+
+        for (uint p = 0; p < 4; p++) {
+            for (uint q = p + 1; q < 4; q++) {
+                if (a[p][q] == 0) continue;
+
+                // Rotate in the (p, q) plane to zero `a[p][q]`.
+                const double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+                const double t = (theta >= 0 ? 1 : -1) / (std::abs(theta) + std::sqrt(theta * theta + 1));
+                const double c = 1 / std::sqrt(t * t + 1), s = t * c;
+                for (uint k = 0; k < 4; k++) {
+                    const double kp = a[k][p], kq = a[k][q];
+                    a[k][p] = c * kp - s * kq;
+                    a[k][q] = s * kp + c * kq;
+                }
+                for (uint k = 0; k < 4; k++) {
+                    const double pk = a[p][k], qk = a[q][k];
+                    a[p][k] = c * pk - s * qk;
+                    a[q][k] = s * pk + c * qk;
+                }
+                for (uint k = 0; k < 4; k++) {
+                    const double kp = v[k][p], kq = v[k][q];
+                    v[k][p] = c * kp - s * kq;
+                    v[k][q] = s * kp + c * kq;
+                }
+            }
+        }
+    }
+
+    uint largest = 0;
+    for (uint i = 1; i < 4; i++) {
+        if (a[i][i] > a[largest][largest]) largest = i;
+    }
+    return {a[largest][largest], {v[0][largest], v[1][largest], v[2][largest], v[3][largest]}};
+}
+
+// Max distance of the frame's atoms from its centroid.
+static float CentroidRadius(const MoleculeData &frame, const glm::vec3 &centroid) {
+    float max_squared = 0;
+    for (uint atom = 0; atom < frame.NumAtoms(); atom++) {
+        const auto offset = frame.GetPosition(atom) - centroid;
+        max_squared = std::max(max_squared, glm::dot(offset, offset));
+    }
+    return std::sqrt(max_squared);
+}
+
+FrameAlignment AlignFrame(const MoleculeData &frame, const MoleculeData &reference) {
+    const glm::vec3 frame_centroid = ComputeCentroid(frame), reference_centroid = ComputeCentroid(reference);
+    const float radius = CentroidRadius(frame, frame_centroid);
+    const uint n = frame.NumAtoms();
+    if (n == 0 || n != reference.NumAtoms()) return {{glm::mat3{1}, reference_centroid - frame_centroid}, -1, radius};
+
+    // Covariance of the centered positions, and their summed squared norms.
+    const float *px = frame.X.data(), *py = frame.Y.data(), *pz = frame.Z.data();
+    const float *qx = reference.X.data(), *qy = reference.Y.data(), *qz = reference.Z.data();
+    const Float4 pcx{frame_centroid.x}, pcy{frame_centroid.y}, pcz{frame_centroid.z};
+    const Float4 qcx{reference_centroid.x}, qcy{reference_centroid.y}, qcz{reference_centroid.z};
+    // Ten independent accumulators, so one block's additions don't wait on each other.
+    Float4 lanes[10]{0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f};
+    const uint num_blocked = n / 4 * 4;
+    for (uint i = 0; i < num_blocked; i += 4) {
+        const Float4 x = Float4::Load(px + i) - pcx, y = Float4::Load(py + i) - pcy, z = Float4::Load(pz + i) - pcz;
+        const Float4 rx = Float4::Load(qx + i) - qcx, ry = Float4::Load(qy + i) - qcy, rz = Float4::Load(qz + i) - qcz;
+        lanes[0] = lanes[0] + x * rx;
+        lanes[1] = lanes[1] + x * ry;
+        lanes[2] = lanes[2] + x * rz;
+        lanes[3] = lanes[3] + y * rx;
+        lanes[4] = lanes[4] + y * ry;
+        lanes[5] = lanes[5] + y * rz;
+        lanes[6] = lanes[6] + z * rx;
+        lanes[7] = lanes[7] + z * ry;
+        lanes[8] = lanes[8] + z * rz;
+        lanes[9] = lanes[9] + (x * x + y * y + z * z) + (rx * rx + ry * ry + rz * rz);
+    }
+    std::array<double, 10> sums;
+    for (uint i = 0; i < 10; i++) sums[i] = lanes[i].Sum();
+    for (uint i = num_blocked; i < n; i++) {
+        const float x = px[i] - frame_centroid.x, y = py[i] - frame_centroid.y, z = pz[i] - frame_centroid.z;
+        const float rx = qx[i] - reference_centroid.x, ry = qy[i] - reference_centroid.y, rz = qz[i] - reference_centroid.z;
+        const std::array<float, 10> terms{x * rx, x * ry, x * rz, y * rx, y * ry, y * rz, z * rx, z * ry, z * rz, x * x + y * y + z * z + rx * rx + ry * ry + rz * rz};
+        for (uint t = 0; t < 10; t++) sums[t] += terms[t];
+    }
+    const double sxx = sums[0], sxy = sums[1], sxz = sums[2], syx = sums[3], syy = sums[4], syz = sums[5], szx = sums[6], szy = sums[7], szz = sums[8];
+
+    // The unit quaternion (w, x, y, z) of the optimal rotation is the top eigenvector of this matrix (Horn, 1987).
+    const Matrix4 horn{{
+        {sxx + syy + szz, syz - szy, szx - sxz, sxy - syx},
+        {syz - szy, sxx - syy - szz, sxy + syx, szx + sxz},
+        {szx - sxz, sxy + syx, -sxx + syy - szz, syz + szy},
+        {sxy - syx, szx + sxz, syz + szy, -sxx - syy + szz},
+    }};
+    const auto [eigenvalue, q] = LargestEigen(horn);
+    const float w = q[0], x = q[1], y = q[2], z = q[3];
+    const glm::mat3 rotation{
+        glm::vec3{1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y)},
+        glm::vec3{2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x)},
+        glm::vec3{2 * (x * z + w * y), 2 * (y * z - w * x), 1 - 2 * (x * x + y * y)},
+    };
+    const float rmsd = std::sqrt(std::max(0.0, (sums[9] - 2 * eigenvalue) / n));
+    return {{rotation, reference_centroid - rotation * frame_centroid}, rmsd, radius};
+}
+
+void ChainAlignment::Add(const MoleculeData &frame, const MoleculeData &reference) {
+    Frames.push_back(AlignFrame(frame, reference));
+    Radius = std::max(Radius, Frames.back().Radius);
+}
+
+ChainAlignment StartAlignment(const MoleculeData &reference, uint reference_index) {
+    ChainAlignment alignment;
+    alignment.Reference = reference_index;
+    alignment.Center = ComputeCentroid(reference);
+    return alignment;
+}
+
+ChainAlignment AlignChain(const std::vector<const MoleculeData *> &frames, uint num_threads) {
+    Trace::Scope trace{"Align chain", "load"};
+    if (frames.empty()) return {};
+
+    const auto &reference = *frames.back();
+    auto alignment = StartAlignment(reference, frames.size() - 1);
+    alignment.Frames.resize(frames.size());
+
+    std::atomic<uint> next{0};
+    const auto align_frames = [&] {
+        for (uint i = next++; i < frames.size(); i = next++) alignment.Frames[i] = AlignFrame(*frames[i], reference);
+    };
+
+    uint64_t num_atoms = 0;
+    for (const auto *frame : frames) num_atoms += frame->NumAtoms();
+    if (num_threads == 0) num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    num_threads = std::clamp(uint(std::min<uint64_t>(num_atoms / MinAtomsPerThread, frames.size())), 1u, num_threads);
+    std::vector<std::thread> threads;
+    for (uint i = 1; i < num_threads; i++) threads.emplace_back([&] {
+        Trace::SetThreadName("Alignment worker");
+        align_frames();
+    });
+    align_frames();
+    for (auto &thread : threads) thread.join();
+
+    for (const auto &frame : alignment.Frames) alignment.Radius = std::max(alignment.Radius, frame.Radius);
+    return alignment;
+}
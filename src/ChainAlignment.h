@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+
+#include "MoleculeData.h"
+
+// Rotation, then translation.
+struct RigidTransform {
+    glm::mat3 Rotation{1};
+    glm::vec3 Translation{0};
+
+    glm::vec3 Apply(const glm::vec3 &position) const { return Rotation * position + Translation; }
+    glm::vec3 ApplyInverse(const glm::vec3 &position) const { return glm::transpose(Rotation) * (position - Translation); }
+    glm::mat4 ToMat4() const { return {glm::vec4{Rotation[0], 0}, glm::vec4{Rotation[1], 0}, glm::vec4{Rotation[2], 0}, glm::vec4{Translation, 1}}; }
+
+    bool operator==(const RigidTransform &) const = default;
+};
+
+struct FrameAlignment {
+    RigidTransform Transform; // Onto the reference frame.
+    float Rmsd{0}; // Of aligned atom positions from the reference's. Negative if the frame couldn't be aligned.
+    // Max distance of atom centers from the frame's centroid, which `Transform` moves onto the reference's centroid.
+    // So it's also the aligned frame's extent around the reference centroid, for any reference.
+    float Radius{0};
+};
+
+glm::vec3 ComputeCentroid(const MoleculeData &);
+
+// Kabsch alignment: the rigid transform of `frame` onto `reference` minimizing the RMSD of atoms matched by index.
+// The rotation is found as the quaternion maximizing the covariance (Horn's method), so it's never a reflection.
+// Frames with a different number of atoms than the reference are only translated, centroid onto centroid, with a negative RMSD.
+FrameAlignment AlignFrame(const MoleculeData &frame, const MoleculeData &reference);
+
+// The first frames of a chain aligned onto one of its frames (the reference), so playback has a fixed orientation and extent.
+struct ChainAlignment {
+    std::vector<FrameAlignment> Frames; // Of the chain's first `Frames.size()` frames.
+    uint Reference{0}; // Index of the frame aligned onto.
+    glm::vec3 Center{0}; // The reference frame's centroid.
+    float Radius{0}; // Bounding sphere of the atom centers of all aligned frames, centered on `Center`.
+
+    // Align the chain's next frame (index `Frames.size()`) onto `reference`, which must be frame `Reference`.
+    void Add(const MoleculeData &frame, const MoleculeData &reference);
+
+    uint64_t GetAllocatedBytes() const { return Frames.capacity() * sizeof(FrameAlignment); }
+};
+
+// No frames aligned yet, onto the chain's frame `reference_index`.
+ChainAlignment StartAlignment(const MoleculeData &reference, uint reference_index);
+
+// Every frame of a chain aligned onto its final frame.
+// Frames are aligned in parallel, on up to `num_threads` threads (0 for one per hardware thread), when there are enough atoms to be worth it.
+ChainAlignment AlignChain(const std::vector<const MoleculeData *> &frames, uint num_threads = 0);
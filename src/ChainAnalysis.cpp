@@ -0,0 +1,110 @@
+#include "ChainAnalysis.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#include "DatasetConfig.h"
+#include "Trace.h"
+#include "WorkerPool.h"
+
+static const QM9WithH DatasetConfig;
+
+// Representative atom of the fragment containing `atom`, halving paths along the way.
+static uint FindRoot(std::vector<uint> &parents, uint atom) {
+    while (parents[atom] != atom) atom = parents[atom] = parents[parents[atom]];
+    return atom;
+}
+
+FrameMetrics ComputeFrameMetrics(const MoleculeData &molecule) {
+    FrameMetrics metrics;
+    const uint num_atoms = molecule.NumAtoms();
+    metrics.NumAtoms = num_atoms;
+    if (num_atoms == 0) return metrics;
+
+    const auto found_bonds = molecule.Bonds.empty() ? FindBonds(molecule) : std::vector<Bond>{};
+    const auto &bonds = molecule.Bonds.empty() ? found_bonds : molecule.Bonds;
+    metrics.NumBonds = bonds.size();
+
+    std::vector<uint> valences(num_atoms, 0), parents(num_atoms);
+    std::iota(parents.begin(), parents.end(), 0);
+    for (const auto &bond : bonds) {
+        valences[bond.A] += bond.Order;
+        valences[bond.B] += bond.Order;
+        parents[FindRoot(parents, bond.A)] = FindRoot(parents, bond.B);
+    }
+    std::vector<uint> fragment_sizes(num_atoms, 0);
+    for (uint atom = 0; atom < num_atoms; atom++) {
+        const uint8_t type = molecule.Types[atom];
+        if (type < DatasetConfig.AllowedValence.size() && valences[atom] == DatasetConfig.AllowedValence[type]) metrics.NumStableAtoms++;
+        metrics.LargestFragment = std::max(metrics.LargestFragment, ++fragment_sizes[FindRoot(parents, atom)]);
+    }
+
+    glm::vec3 centroid{0};
+    for (uint atom = 0; atom < num_atoms; atom++) centroid += molecule.GetPosition(atom);
+    centroid /= float(num_atoms);
+    float sum_squared = 0;
+    for (uint atom = 0; atom < num_atoms; atom++) {
+        const auto offset = molecule.GetPosition(atom) - centroid;
+        sum_squared += offset.x * offset.x + offset.y * offset.y + offset.z * offset.z;
+    }
+    metrics.RadiusOfGyration = std::sqrt(sum_squared / num_atoms);
+    return metrics;
+}
+
+ChainAnalysis::ChainAnalysis() : Shared(std::make_shared<State>()) {}
+
+ChainAnalysis::~ChainAnalysis() {
+    std::lock_guard lock{Shared->Mutex};
+    Shared->Queue.clear(); // Remaining tasks find nothing to analyze.
+}
+
+void ChainAnalysis::Add(const MoleculeData &molecule) {
+    {
+        std::lock_guard lock{Shared->Mutex};
+        Shared->Queue.emplace_back(Shared->Metrics.size(), molecule);
+        Shared->Metrics.emplace_back();
+    }
+    WorkerPool::Get().Submit([state = Shared] { AnalyzeNext(*state); });
+}
+
+void ChainAnalysis::Add(const FrameMetrics &metrics) {
+    std::lock_guard lock{Shared->Mutex};
+    Shared->Metrics.emplace_back(metrics);
+    Shared->Analyzed++;
+}
+
+void ChainAnalysis::AnalyzeNext(State &state) {
+    std::unique_lock lock{state.Mutex};
+    if (state.Queue.empty()) return;
+
+    auto [frame, molecule] = std::move(state.Queue.front());
+    state.Queue.pop_front();
+    lock.unlock();
+    FrameMetrics metrics;
+    {
+        Trace::Scope trace{"Analyze frame", "analysis"};
+        metrics = ComputeFrameMetrics(molecule);
+    }
+    lock.lock();
+    state.Metrics[frame] = metrics;
+    state.Analyzed++;
+}
+
+uint ChainAnalysis::NumFrames() const {
+    std::lock_guard lock{Shared->Mutex};
+    return Shared->Metrics.size();
+}
+
+std::vector<std::optional<FrameMetrics>> ChainAnalysis::GetMetrics() const {
+    std::lock_guard lock{Shared->Mutex};
+    return Shared->Metrics;
+}
+
+MemoryUsage ChainAnalysis::GetMemoryUsage() const {
+    std::lock_guard lock{Shared->Mutex};
+    MemoryUsage usage;
+    usage.AddCpu(MemoryCategory::Analysis, Shared->Metrics.capacity() * sizeof(std::optional<FrameMetrics>));
+    for (const auto &[_, molecule] : Shared->Queue) usage.AddCpu(MemoryCategory::Analysis, sizeof(molecule) + molecule.GetAllocatedBytes());
+    return usage;
+}
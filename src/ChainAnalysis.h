@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "Memory.h"
+#include "MoleculeData.h"
+
+// Validity of one chain frame, as in GeoLDM's `check_stability` (bond_analyze.py).
+struct FrameMetrics {
+    uint NumAtoms{0}, NumBonds{0};
+    uint NumStableAtoms{0}; // Atoms whose bond orders sum to their element's allowed valence.
+    uint LargestFragment{0}; // Atoms in the largest bonded fragment.
+    float RadiusOfGyration{0}; // RMS distance of atoms from their centroid.
+
+    bool IsStable() const { return NumStableAtoms == NumAtoms; }
+};
+
+// Finds bonds first if the molecule doesn't have any yet.
+FrameMetrics ComputeFrameMetrics(const MoleculeData &);
+
+// Metrics of every frame of a chain, computed on the shared `WorkerPool` as frames are added, so loading never waits on them.
+// Frames never change once added (chains only grow), so each frame is analyzed exactly once, and results are kept for the chain's lifetime.
+struct ChainAnalysis {
+    ChainAnalysis();
+    ~ChainAnalysis(); // Frames still queued are dropped.
+
+    // Queue a copy of the frame's atoms and bonds. Frames are numbered in the order they're added.
+    void Add(const MoleculeData &);
+    // Add a frame already analyzed elsewhere (e.g. cached in a `DirectoryIndex`).
+    void Add(const FrameMetrics &);
+
+    uint NumFrames() const;
+    uint NumAnalyzed() const { return Shared->Analyzed.load(); }
+    bool IsAnalyzing() const { return NumAnalyzed() < NumFrames(); }
+
+    // Incremented whenever a frame is analyzed, so callers can skip copying unchanged results.
+    uint GetVersion() const { return NumAnalyzed(); }
+    // Per frame, empty until analyzed.
+    std::vector<std::optional<FrameMetrics>> GetMetrics() const;
+
+    MemoryUsage GetMemoryUsage() const; // Results, and frames still queued.
+
+private:
+    // Shared with the pool tasks analyzing it, which can outlive the analysis.
+    struct State {
+        mutable std::mutex Mutex;
+        std::deque<std::pair<uint, MoleculeData>> Queue; // (frame, copy of its data), oldest first.
+        std::vector<std::optional<FrameMetrics>> Metrics;
+        std::atomic<uint> Analyzed{0};
+    };
+
+    static void AnalyzeNext(State &); // One pool task per added frame.
+
+    std::shared_ptr<State> Shared;
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+// Validated parsing of command line option values, shared by the tools and benchmarks.
+// Each returns false, leaving `result` unchanged, unless the whole of `value` is valid.
+
+// A whole non-negative number that fits in a `uint`.
+inline bool ParseCount(const char *value, uint &result) {
+    if (*value < '0' || *value > '9') return false; // `strtoul` would accept leading whitespace and signs.
+
+    char *end;
+    errno = 0;
+    const unsigned long long parsed = std::strtoull(value, &end, 10);
+    if (*end != '\0' || errno == ERANGE || parsed > std::numeric_limits<uint>::max()) return false;
+    result = parsed;
+    return true;
+}
+
+// A finite number.
+inline bool ParseFloat(const char *value, float &result) {
+    if (*value == '\0' || std::isspace((unsigned char)*value)) return false;
+
+    char *end;
+    errno = 0;
+    const float parsed = std::strtof(value, &end);
+    if (*end != '\0' || errno == ERANGE || !std::isfinite(parsed)) return false;
+    result = parsed;
+    return true;
+}
+
+// "on" or "off".
+inline bool ParseOnOff(const char *value, bool &result) {
+    if (std::strcmp(value, "on") != 0 && std::strcmp(value, "off") != 0) return false;
+    result = value[1] == 'n';
+    return true;
+}
@@ -77,4 +77,5 @@ struct QM9WithH {
         {0.0f, 1.0f, 0.0f, 1.0f} // F: Green
     };
     std::vector<float> RadiusForAtom = {0.46f, 0.77f, 0.77f, 0.77f, 0.77f};
+    std::vector<uint> AllowedValence = {1, 4, 3, 2, 1}; // `allowed_bonds` in bond_analyze.py. A stable atom's bond orders sum to this.
 };
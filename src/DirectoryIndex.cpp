@@ -0,0 +1,170 @@
+#include "DirectoryIndex.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+
+#include "Trace.h"
+
+static const uint32_t IndexMagic = 0x58444947; // "GIDX"
+static const uint32_t IndexVersion = 2;
+
+// Runs on the index worker threads, so it must not throw. Unreadable files get an empty entry (no atoms).
+static DirectoryIndexEntry ComputeEntry(const fs::path &path) {
+    DirectoryIndexEntry entry;
+    std::optional<MoleculeData> molecule;
+    try {
+        molecule = ReadXyzFile(path); // Reports malformed files itself.
+    } catch (const std::exception &e) {
+        std::cerr << "Failed to parse " << path << ": " << e.what() << std::endl;
+    }
+    if (!molecule) return entry;
+
+    const auto metrics = ComputeFrameMetrics(*molecule); // Finds its bonds.
+    entry.NumAtoms = metrics.NumAtoms;
+    entry.NumBonds = metrics.NumBonds;
+    entry.NumStableAtoms = metrics.NumStableAtoms;
+    entry.LargestFragment = metrics.LargestFragment;
+    entry.RadiusOfGyration = metrics.RadiusOfGyration;
+    entry.Formula = ChemicalFormula(molecule->Types);
+    std::tie(entry.BoundsMin, entry.BoundsMax) = molecule->ComputeBounds();
+    return entry;
+}
+
+DirectoryIndex DirectoryIndex::Open(const fs::path &directory) {
+    DirectoryIndex index{directory, {}};
+    index.Load();
+    if (index.Update()) index.Save();
+    return index;
+}
+
+template<typename T> static void Write(std::ofstream &out, const T &value) { out.write(reinterpret_cast<const char *>(&value), sizeof(T)); }
+template<typename T> static bool Read(std::ifstream &in, T &value) { return bool(in.read(reinterpret_cast<char *>(&value), sizeof(T))); }
+
+static void WriteString(std::ofstream &out, const std::string &str) {
+    Write(out, uint32_t(str.size()));
+    out.write(str.data(), str.size());
+}
+static bool ReadString(std::ifstream &in, std::string &str) {
+    uint32_t size;
+    if (!Read(in, size) || size > 4096) return false;
+    str.resize(size);
+    return bool(in.read(str.data(), size));
+}
+
+bool DirectoryIndex::Load() {
+    std::ifstream in(Directory / FileName, std::ios::binary);
+    if (!in.is_open()) return false;
+
+    uint32_t magic, version;
+    uint64_t num_entries;
+    if (!Read(in, magic) || !Read(in, version) || !Read(in, num_entries)) return false;
+    if (magic != IndexMagic || version != IndexVersion) return false;
+
+    std::vector<DirectoryIndexEntry> entries(num_entries);
+    for (auto &e : entries) {
+        if (!ReadString(in, e.FileName) || !Read(in, e.ModifiedTime) || !Read(in, e.FileSize) || !Read(in, e.FileOffset) ||
+            !Read(in, e.NumAtoms) || !Read(in, e.NumBonds) || !ReadString(in, e.Formula) ||
+            !Read(in, e.BoundsMin) || !Read(in, e.BoundsMax) ||
+            !Read(in, e.NumStableAtoms) || !Read(in, e.LargestFragment) || !Read(in, e.RadiusOfGyration)) {
+            std::cerr << "Ignoring truncated index file in " << Directory << std::endl;
+            return false;
+        }
+    }
+    Entries = std::move(entries);
+    return true;
+}
+
+bool DirectoryIndex::Save() const {
+    // Write to a temporary file and rename, so a crash mid-write never leaves a corrupt index behind.
+    const auto path = Directory / FileName, tmp_path = Directory / (std::string(FileName) + ".tmp");
+    {
+        std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false; // E.g. a read-only directory. The index is just rebuilt next time.
+
+        Write(out, IndexMagic);
+        Write(out, IndexVersion);
+        Write(out, uint64_t(Entries.size()));
+        for (const auto &e : Entries) {
+            WriteString(out, e.FileName);
+            Write(out, e.ModifiedTime);
+            Write(out, e.FileSize);
+            Write(out, e.FileOffset);
+            Write(out, e.NumAtoms);
+            Write(out, e.NumBonds);
+            WriteString(out, e.Formula);
+            Write(out, e.BoundsMin);
+            Write(out, e.BoundsMax);
+            Write(out, e.NumStableAtoms);
+            Write(out, e.LargestFragment);
+            Write(out, e.RadiusOfGyration);
+        }
+        if (!out.good()) return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp_path, path, ec);
+    return !ec;
+}
+
+bool DirectoryIndex::Update() {
+    std::unordered_map<std::string, DirectoryIndexEntry> existing;
+    for (auto &entry : Entries) existing.emplace(entry.FileName, std::move(entry));
+
+    // Only stat files here. Parsing is deferred so it can run in parallel.
+    std::vector<DirectoryIndexEntry> entries;
+    std::vector<uint> stale; // Indices into `entries` that need (re)parsing.
+    for (const auto &dir_entry : fs::directory_iterator(Directory)) {
+        const auto &path = dir_entry.path();
+        if (path.extension() != ".txt") continue;
+
+        const int64_t modified_time = dir_entry.last_write_time().time_since_epoch().count();
+        const uint64_t file_size = dir_entry.file_size();
+        auto found = existing.find(path.filename().string());
+        if (found != existing.end() && found->second.ModifiedTime == modified_time && found->second.FileSize == file_size) {
+            entries.emplace_back(std::move(found->second));
+        } else {
+            stale.push_back(entries.size());
+            auto &entry = entries.emplace_back();
+            entry.FileName = path.filename().string();
+            entry.ModifiedTime = modified_time;
+            entry.FileSize = file_size;
+        }
+    }
+
+    std::atomic<uint> next{0};
+    auto parse_stale = [&] {
+        for (uint i = next++; i < stale.size(); i = next++) {
+            auto &entry = entries[stale[i]];
+            auto computed = ComputeEntry(Directory / entry.FileName);
+            computed.FileName = std::move(entry.FileName);
+            computed.ModifiedTime = entry.ModifiedTime;
+            computed.FileSize = entry.FileSize;
+            entry = std::move(computed);
+        }
+    };
+    const uint num_threads = std::min(std::max(std::thread::hardware_concurrency(), 1u), uint(stale.size()));
+    std::vector<std::thread> threads;
+    for (uint i = 1; i < num_threads; i++) threads.emplace_back([&] {
+        Trace::SetThreadName("Index worker");
+        parse_stale();
+    });
+    parse_stale();
+    for (auto &thread : threads) thread.join();
+
+    std::sort(entries.begin(), entries.end(), [](const auto &a, const auto &b) { return a.FileName < b.FileName; });
+    const uint num_reused = entries.size() - stale.size();
+    const bool changed = !stale.empty() || num_reused != existing.size(); // Files were added, modified or removed.
+    Entries = std::move(entries);
+    return changed;
+}
+
+MemoryUsage DirectoryIndex::GetMemoryUsage() const {
+    MemoryUsage usage;
+    usage.AddCpu(MemoryCategory::ParseBuffers, Entries.capacity() * sizeof(DirectoryIndexEntry));
+    for (const auto &entry : Entries) usage.AddCpu(MemoryCategory::ParseBuffers, entry.FileName.capacity() + entry.Formula.capacity()); // Approximate (ignores small-string storage).
+    return usage;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "ChainAnalysis.h"
+#include "Memory.h"
+#include "MoleculeData.h"
+
+// Per-molecule metadata, computed once from the file contents and cached on disk.
+struct DirectoryIndexEntry {
+    std::string FileName; // Relative to the indexed directory.
+    int64_t ModifiedTime{0}; // `fs::file_time_type` ticks. Together with `FileSize`, used to detect changed files.
+    uint64_t FileSize{0};
+    uint64_t FileOffset{0}; // Byte offset of the molecule within the file. Always 0 for XYZ files (one molecule per file).
+    uint NumAtoms{0}, NumBonds{0};
+    std::string Formula;
+    glm::vec3 BoundsMin{0}, BoundsMax{0};
+    // The rest of the molecule's `FrameMetrics`, so a chain's analysis doesn't need its files parsed.
+    uint NumStableAtoms{0}, LargestFragment{0};
+    float RadiusOfGyration{0};
+
+    FrameMetrics GetMetrics() const { return {NumAtoms, NumBonds, NumStableAtoms, LargestFragment, RadiusOfGyration}; }
+};
+
+// Persistent metadata index of all molecule (.txt XYZ) files in a directory, stored in the directory as `FileName`.
+// `Open` loads the existing index and only parses files that were added or modified since it was written,
+// so reopening an unchanged directory needs no parsing.
+// New and modified files are parsed in parallel across all cores.
+struct DirectoryIndex {
+    inline static const char *FileName = ".geoldmviz_index";
+
+    static DirectoryIndex Open(const fs::path &directory);
+
+    fs::path Directory;
+    std::vector<DirectoryIndexEntry> Entries; // Sorted by file name (the same order `MoleculeChain` uses).
+
+    fs::path GetPath(uint entry_index) const { return Directory / Entries[entry_index].FileName; }
+
+    bool Load(); // Returns false if there is no valid index file.
+    bool Save() const;
+    // Sync with the directory contents, parsing new and modified files. Returns true if anything changed.
+    bool Update();
+
+    MemoryUsage GetMemoryUsage() const;
+};
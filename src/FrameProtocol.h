@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+
+// Compact binary protocol for streaming molecule frames from a running sampler.
+// Each frame is a `FrameHeader`, followed by `NumAtoms` `uint8` atom types (indices into `QM9WithH::AtomDecoder`),
+// followed by `NumAtoms * 3` `float32` positions (x, y, z per atom).
+// All values are in host byte order, since producer and consumer always share a machine.
+
+inline static const char *DefaultFrameSocketPath = "/tmp/geoldmviz.sock";
+
+inline static const uint32_t FrameMagic = 0x46444c47; // "GLDF"
+inline static const uint32_t MaxFrameAtoms = 1 << 20; // Reject obviously corrupt headers.
+
+struct FrameHeader {
+    uint32_t Magic{FrameMagic};
+    uint32_t NumAtoms{0};
+};
@@ -0,0 +1,128 @@
+#include "FrameStream.h"
+
+#include <cstring>
+#include <iostream>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "DatasetConfig.h"
+#include "Trace.h"
+
+static const QM9WithH DatasetConfig;
+
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "Frame positions are read directly into `glm::vec3`s.");
+
+static const int PollTimeoutMs = 100; // How often blocked socket calls check whether the stream is shutting down.
+
+// Wait until `fd` is readable, or the timeout expires. Returns true if readable.
+static bool PollReadable(int fd) {
+    pollfd pfd{fd, POLLIN, 0};
+    return poll(&pfd, 1, PollTimeoutMs) > 0 && (pfd.revents & (POLLIN | POLLHUP));
+}
+
+FrameStream::FrameStream(const fs::path &socket_path) : SocketPath(socket_path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    const std::string path = SocketPath.string();
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path too long: " << SocketPath << std::endl;
+        return;
+    }
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    ListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (ListenFd < 0) {
+        std::cerr << "Failed to create socket: " << std::strerror(errno) << std::endl;
+        return;
+    }
+    unlink(path.c_str()); // Remove a stale socket left behind by a previous run.
+    if (bind(ListenFd, (sockaddr *)&address, sizeof(address)) != 0 || listen(ListenFd, 1) != 0) {
+        std::cerr << "Failed to listen on " << SocketPath << ": " << std::strerror(errno) << std::endl;
+        close(ListenFd);
+        ListenFd = -1;
+        return;
+    }
+
+    ListenThread = std::thread(&FrameStream::Listen, this);
+}
+
+FrameStream::~FrameStream() {
+    Running = false;
+    if (ListenThread.joinable()) ListenThread.join();
+    if (ListenFd >= 0) {
+        close(ListenFd);
+        unlink(SocketPath.c_str());
+    }
+}
+
+std::optional<MoleculeData> FrameStream::Pop() { return Frames.Pop(); }
+
+void FrameStream::Listen() {
+    Trace::SetThreadName("Frame stream");
+    while (Running) {
+        if (!PollReadable(ListenFd)) continue;
+
+        const int fd = accept(ListenFd, nullptr, nullptr);
+        if (fd < 0) continue;
+
+        Connected = true;
+        while (Running && ReadFrames(fd)) {}
+        Connected = false;
+        close(fd);
+    }
+}
+
+bool FrameStream::ReadExact(int fd, void *data, size_t size) {
+    auto *bytes = static_cast<char *>(data);
+    while (size > 0) {
+        if (!Running) return false;
+        if (!PollReadable(fd)) continue;
+
+        const ssize_t n = recv(fd, bytes, size, 0);
+        if (n <= 0) return false; // Closed or failed.
+
+        bytes += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool FrameStream::ReadFrames(int fd) {
+    FrameHeader header;
+    if (!ReadExact(fd, &header, sizeof(header))) return false;
+    if (header.Magic != FrameMagic || header.NumAtoms > MaxFrameAtoms) {
+        std::cerr << "Received a corrupt frame header. Dropping connection." << std::endl;
+        return false;
+    }
+
+    MoleculeData frame;
+    frame.Types.resize(header.NumAtoms);
+    std::vector<glm::vec3> positions(header.NumAtoms); // Interleaved on the wire.
+    if (!ReadExact(fd, frame.Types.data(), frame.Types.size())) return false;
+    if (!ReadExact(fd, positions.data(), positions.size() * sizeof(glm::vec3))) return false;
+    for (const uint8_t type : frame.Types) {
+        if (type >= DatasetConfig.AtomDecoder.size()) {
+            std::cerr << "Received unknown atom type " << int(type) << ". Dropping connection." << std::endl;
+            return false;
+        }
+    }
+    frame.X.resize(header.NumAtoms);
+    frame.Y.resize(header.NumAtoms);
+    frame.Z.resize(header.NumAtoms);
+    for (uint i = 0; i < header.NumAtoms; i++) {
+        frame.X[i] = positions[i].x;
+        frame.Y[i] = positions[i].y;
+        frame.Z[i] = positions[i].z;
+    }
+
+    // Backpressure: hold on to the frame until the render thread makes room.
+    while (!Frames.Push(std::move(frame))) {
+        if (!Running) return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    Received.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
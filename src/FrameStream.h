@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+
+#include "MoleculeData.h"
+#include "FrameProtocol.h"
+#include "SpscQueue.h"
+
+// Listens on a Unix domain socket for molecule frames (see `FrameProtocol.h`) on a background thread.
+// Decoded frames are handed to the render thread through a lock-free queue, so rendering never waits on ingest.
+// One producer is served at a time. When the queue is full, the listener stops reading, applying backpressure to the producer.
+struct FrameStream {
+    FrameStream(const fs::path &socket_path = DefaultFrameSocketPath);
+    ~FrameStream();
+
+    std::optional<MoleculeData> Pop(); // Called from the render thread. Never blocks.
+
+    bool IsListening() const { return ListenFd >= 0; }
+    bool IsConnected() const { return Connected.load(std::memory_order_relaxed); }
+    uint NumReceived() const { return Received.load(std::memory_order_relaxed); }
+
+    const fs::path SocketPath;
+
+private:
+    void Listen();
+    bool ReadFrames(int fd); // Returns false when the connection is closed or sends a corrupt frame.
+    bool ReadExact(int fd, void *data, size_t size);
+
+    int ListenFd{-1};
+    std::atomic<bool> Running{true}, Connected{false};
+    std::atomic<uint> Received{0};
+    SpscQueue<MoleculeData, 64> Frames;
+    std::thread ListenThread;
+};
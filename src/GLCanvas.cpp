@@ -1,11 +1,17 @@
 #include "GLCanvas.h"
 #include "GL/glew.h"
+#include "Profiler.h"
+#include "Shader/ShaderProgram.h"
+#include "Trace.h"
+#include <algorithm>
 #include <stdexcept>
 
 const GLenum ColorFormat = GL_RGB;
 const GLenum DepthFormat = GL_DEPTH_COMPONENT;
 const GLenum DataType = GL_UNSIGNED_BYTE;
 
+static const fs::path ShaderDir = fs::path("res") / "shaders";
+
 GLCanvas::~GLCanvas() {
     Destroy();
 }
@@ -23,19 +29,19 @@ static void SetTextureParameters() {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 }
 
-static void CreateTexture(unsigned int &id, GLenum target, uint width, uint height, int samples) {
-    glGenTextures(1, &id);
-    glBindTexture(target, id);
+static void CreateTexture(GLTextureHandle &texture, GLenum target, uint width, uint height, int samples, GLenum internal_format = ColorFormat, GLenum format = ColorFormat, GLenum type = DataType) {
+    texture.Generate();
+    glBindTexture(target, texture);
     if (samples > 1) {
-        glTexImage2DMultisample(target, samples, ColorFormat, width, height, GL_TRUE);
+        glTexImage2DMultisample(target, samples, internal_format, width, height, GL_TRUE);
     } else {
-        glTexImage2D(target, 0, ColorFormat, width, height, 0, ColorFormat, DataType, nullptr);
+        glTexImage2D(target, 0, internal_format, width, height, 0, format, type, nullptr);
     }
 }
 
-static void CreateRenderbuffer(unsigned int &id, GLenum format, uint samples, uint width, uint height) {
-    glGenRenderbuffers(1, &id);
-    glBindRenderbuffer(GL_RENDERBUFFER, id);
+static void CreateRenderbuffer(GLRenderbufferHandle &render_buffer, GLenum format, uint samples, uint width, uint height) {
+    render_buffer.Generate();
+    glBindRenderbuffer(GL_RENDERBUFFER, render_buffer);
     if (samples > 1) {
         glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, format, width, height);
     } else {
@@ -43,52 +49,230 @@ static void CreateRenderbuffer(unsigned int &id, GLenum format, uint samples, ui
     }
 }
 
+// Round up with 25% headroom, to a multiple of 64 pixels.
+static uint WithHeadroom(uint size) { return (size + size / 4 + 63) / 64 * 64; }
+
+const char *GLCanvas::GetAntiAliasingZone(AntiAliasing mode) {
+    switch (mode) {
+        case AntiAliasing::Msaa: return "MSAA resolve";
+        case AntiAliasing::Fxaa: return "FXAA pass";
+        default: return nullptr;
+    }
+}
+
+uint64_t GLCanvas::EstimateBytes(uint width, uint height, AntiAliasing mode, bool transparency) {
+    // Drivers typically pad RGB color and 24-bit depth to 4 bytes per sample.
+    const uint64_t pixels = uint64_t(width) * height;
+    const uint64_t samples = mode == AntiAliasing::Msaa ? SubsamplesPerPixel : 1;
+    const uint64_t output_bytes = mode == AntiAliasing::None ? 0 : pixels * 4;
+    // RGBA16F accumulation, and R16F weight (padded to 4 bytes).
+    const uint64_t transparency_bytes = transparency ? pixels * (8 + 4) * samples : 0;
+    return pixels * (4 + 4) * samples + output_bytes + transparency_bytes;
+}
+
 void GLCanvas::PrepareRender(uint width, uint height, float r, float g, float b, float a) {
-    if (width != Width || height != Height) {
+    Width = width;
+    Height = height;
+    // Reallocate when growing past the allocation, or shrinking far enough below it to be worth reclaiming.
+    const bool grow = Width > AllocatedWidth || Height > AllocatedHeight;
+    const bool shrink = uint64_t(Width) * Height * 16 < uint64_t(AllocatedWidth) * AllocatedHeight;
+    if (grow || shrink || Mode != AllocatedMode || Transparency != AllocatedTransparency) {
+        Trace::Scope trace{"Recreate framebuffers", "framebuffer"};
         Destroy();
-        Width = width;
-        Height = height;
+        AllocatedWidth = WithHeadroom(Width);
+        AllocatedHeight = WithHeadroom(Height);
+        AllocatedMode = Mode;
+        AllocatedTransparency = Transparency;
 
-        glGenFramebuffers(1, &FrameBufferId);
+        FrameBufferId.Generate();
         glBindFramebuffer(GL_FRAMEBUFFER, FrameBufferId);
 
-        GLenum texture_target = SubsamplesPerPixel > 1 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
-        CreateTexture(TextureId, texture_target, Width, Height, SubsamplesPerPixel);
+        const uint samples = Mode == AntiAliasing::Msaa ? SubsamplesPerPixel : 1;
+        const GLenum texture_target = samples > 1 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+        CreateTexture(TextureId, texture_target, AllocatedWidth, AllocatedHeight, samples);
+        if (samples == 1) SetTextureParameters(); // Sampled directly (`None`) or by the FXAA pass.
         glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture_target, TextureId, 0);
 
-        CreateRenderbuffer(DepthRenderBufferId, DepthFormat, SubsamplesPerPixel, Width, Height);
+        CreateRenderbuffer(DepthRenderBufferId, DepthFormat, samples, AllocatedWidth, AllocatedHeight);
         glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, DepthRenderBufferId);
 
         CheckFramebufferStatus();
 
-        glGenFramebuffers(1, &ResolveBufferId);
-        glBindFramebuffer(GL_FRAMEBUFFER, ResolveBufferId);
+        if (Mode != AntiAliasing::None) {
+            ResolveBufferId.Generate();
+            glBindFramebuffer(GL_FRAMEBUFFER, ResolveBufferId);
 
-        CreateTexture(ResolveTextureId, GL_TEXTURE_2D, Width, Height, 1);
-        SetTextureParameters();
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ResolveTextureId, 0);
+            CreateTexture(ResolveTextureId, GL_TEXTURE_2D, AllocatedWidth, AllocatedHeight, 1);
+            SetTextureParameters();
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ResolveTextureId, 0);
 
-        CheckFramebufferStatus();
+            CheckFramebufferStatus();
+        }
+
+        if (Transparency) {
+            // Same sample count as the main target, to share its depth buffer.
+            TransparencyFrameBufferId.Generate();
+            glBindFramebuffer(GL_FRAMEBUFFER, TransparencyFrameBufferId);
+
+            CreateTexture(AccumulationTextureId, texture_target, AllocatedWidth, AllocatedHeight, samples, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture_target, AccumulationTextureId, 0);
+            CreateTexture(WeightTextureId, texture_target, AllocatedWidth, AllocatedHeight, samples, GL_R16F, GL_RED, GL_FLOAT);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, texture_target, WeightTextureId, 0);
+            if (samples == 1) {
+                // Read with `texelFetch` only, but single-sample textures are incomplete without this (default filter uses mipmaps).
+                glBindTexture(GL_TEXTURE_2D, AccumulationTextureId);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                glBindTexture(GL_TEXTURE_2D, WeightTextureId);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            }
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, DepthRenderBufferId);
+            static const GLenum DrawBuffers[]{GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+            glDrawBuffers(2, DrawBuffers);
+
+            CheckFramebufferStatus();
+        }
+
+        AllocatedBytes = EstimateBytes(AllocatedWidth, AllocatedHeight, Mode, Transparency);
+        LiveGpuMemory.AddGpu(MemoryCategory::Framebuffers, AllocatedBytes);
     }
 
     glBindFramebuffer(GL_FRAMEBUFFER, FrameBufferId);
     glViewport(0, 0, Width, Height);
+    // Only clear the rendered region.
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(0, 0, Width, Height);
     glClearColor(r, g, b, a);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glDisable(GL_SCISSOR_TEST);
+}
+
+void GLCanvas::BeginTransparentPass() {
+    glBindFramebuffer(GL_FRAMEBUFFER, TransparencyFrameBufferId);
+    glViewport(0, 0, Width, Height);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(0, 0, Width, Height);
+    // Accumulated color starts at zero, and revealage (the accumulation alpha) at one. The depth buffer is the opaque pass's.
+    static const GLfloat AccumulationClear[]{0, 0, 0, 1}, WeightClear[]{0, 0, 0, 0};
+    glClearBufferfv(GL_COLOR, 0, AccumulationClear);
+    glClearBufferfv(GL_COLOR, 1, WeightClear);
+    glDisable(GL_SCISSOR_TEST);
+
+    // Depth-test against opaque geometry, but don't occlude other translucent fragments.
+    // Per-target blend functions need GL 4, so color and weight sums use the RGB factors, and revealage the alpha factors:
+    // accumulation.rgb += color * alpha * weight, weight.r += alpha * weight, accumulation.a *= 1 - alpha.
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void GLCanvas::EndTransparentPass() {
+    const bool multisample = AllocatedMode == AntiAliasing::Msaa;
+    static const Shader CompositeFragmentShader{GL_FRAGMENT_SHADER, ShaderDir / "transparency_composite_fragment.glsl", {"accumulation", "weight"}};
+    static const Shader MultisampleCompositeFragmentShader{GL_FRAGMENT_SHADER, ShaderDir / "transparency_composite_fragment.glsl", {"accumulation", "weight", "num_samples"}, {"MULTISAMPLE"}};
+    static ShaderProgram CompositeProgram{{&GetFullscreenVertexShader(), &CompositeFragmentShader}};
+    static ShaderProgram MultisampleCompositeProgram{{&GetFullscreenVertexShader(), &MultisampleCompositeFragmentShader}};
+    auto &program = multisample ? MultisampleCompositeProgram : CompositeProgram;
+
+    // Blend the average translucent color over the opaque image, by the total revealage.
+    glBindFramebuffer(GL_FRAMEBUFFER, FrameBufferId);
+    glViewport(0, 0, Width, Height);
+    glDepthMask(GL_TRUE);
+    const GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glBlendFunc(GL_ONE_MINUS_SRC_ALPHA, GL_SRC_ALPHA);
+
+    program.Use();
+    const GLenum texture_target = multisample ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(texture_target, AccumulationTextureId);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(texture_target, WeightTextureId);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(program.GetUniform("accumulation"), 0);
+    glUniform1i(program.GetUniform("weight"), 1);
+    if (multisample) glUniform1i(program.GetUniform("num_samples"), SubsamplesPerPixel);
+    DrawFullscreenTriangle();
+
+    glDisable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    if (depth_test) glEnable(GL_DEPTH_TEST);
+}
+
+const Shader &GLCanvas::GetFullscreenVertexShader() {
+    static const Shader FullscreenVertexShader{GL_VERTEX_SHADER, ShaderDir / "fullscreen_vertex.glsl"};
+    return FullscreenVertexShader;
+}
+
+void GLCanvas::DrawFullscreenTriangle() {
+    if (PostProcessVertexArray == 0) PostProcessVertexArray.Generate();
+    glBindVertexArray(PostProcessVertexArray);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
 }
 
 uint GLCanvas::Render() {
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, FrameBufferId);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ResolveBufferId);
-    glBlitFramebuffer(0, 0, Width, Height, 0, 0, Width, Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    if (Mode == AntiAliasing::None) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return TextureId;
+    }
+
+    Profiler::GpuZone zone{GetAntiAliasingZone(Mode)};
+    if (Mode == AntiAliasing::Msaa) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FrameBufferId);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, ResolveBufferId);
+        glBlitFramebuffer(0, 0, Width, Height, 0, 0, Width, Height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    } else {
+        ApplyFxaa();
+    }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     return ResolveTextureId;
 }
 
+void GLCanvas::ApplyFxaa() {
+    static const Shader FxaaFragmentShader{GL_FRAGMENT_SHADER, ShaderDir / "fxaa_fragment.glsl", {"texel_size", "max_uv"}};
+    static ShaderProgram FxaaProgram{{&GetFullscreenVertexShader(), &FxaaFragmentShader}};
+
+    glBindFramebuffer(GL_FRAMEBUFFER, ResolveBufferId);
+    glViewport(0, 0, Width, Height);
+    const GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+
+    FxaaProgram.Use();
+    glUniform2f(FxaaProgram.GetUniform("texel_size"), 1.f / AllocatedWidth, 1.f / AllocatedHeight);
+    // Keep samples inside the rendered region, rather than reading the unused headroom.
+    glUniform2f(FxaaProgram.GetUniform("max_uv"), (Width - 0.5f) / AllocatedWidth, (Height - 0.5f) / AllocatedHeight);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, TextureId);
+    DrawFullscreenTriangle();
+
+    if (depth_test) glEnable(GL_DEPTH_TEST);
+}
+
+void GLCanvas::BlitTo(uint frame_buffer_id, int x, int y, int width, int height) const {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, GetOutputFrameBuffer());
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, frame_buffer_id);
+    glBlitFramebuffer(0, 0, Width, Height, x, y, x + width, y + height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+MemoryUsage GLCanvas::GetMemoryUsage() const {
+    MemoryUsage usage;
+    usage.AddGpu(MemoryCategory::Framebuffers, AllocatedBytes);
+    return usage;
+}
+
 void GLCanvas::Destroy() {
-    glDeleteRenderbuffers(1, &DepthRenderBufferId);
-    glDeleteTextures(1, &TextureId);
-    glDeleteFramebuffers(1, &FrameBufferId);
-    glDeleteFramebuffers(1, &ResolveBufferId);
-    glDeleteTextures(1, &ResolveTextureId);
+    LiveGpuMemory.GpuBytes[size_t(MemoryCategory::Framebuffers)] -= AllocatedBytes;
+    AllocatedBytes = 0;
+    AllocatedWidth = AllocatedHeight = 0;
+    AllocatedMode = AntiAliasing::Count;
+    AllocatedTransparency = false;
+    DepthRenderBufferId.Reset();
+    TextureId.Reset();
+    FrameBufferId.Reset();
+    ResolveBufferId.Reset();
+    ResolveTextureId.Reset();
+    TransparencyFrameBufferId.Reset();
+    AccumulationTextureId.Reset();
+    WeightTextureId.Reset();
 }
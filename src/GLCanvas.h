@@ -1,20 +1,78 @@
 #pragma once
 
+#include "GLHandle.h"
+#include "Memory.h"
+
 using uint = unsigned int;
 
-// Render an OpenGL frame buffer to a texture.
-// Uses MSAA if `SubsamplesPerPixel` > 1.
+struct Shader;
+
+enum class AntiAliasing {
+    None, // Render straight into the output texture.
+    Msaa, // Multisampled color and depth, resolved with a blit.
+    Fxaa, // Single-sample render, then an FXAA post-process pass into the output texture.
+    Count
+};
+inline static const char *AntiAliasingNames[]{"None", "MSAA", "FXAA"};
+
+// Render an OpenGL frame buffer to a texture, with the chosen anti-aliasing.
+// Frame buffers are allocated with headroom and rendered into through a viewport, so small size changes
+// (e.g. while resizing a docked window, or with dynamic resolution) don't recreate them.
 struct GLCanvas {
     ~GLCanvas();
 
     // RGBA background color.
     void PrepareRender(uint width, uint height, float r, float g, float b, float a);
-    uint Render(); // Returns `TextureId` after binding the frame buffer.
+    uint Render(); // Applies anti-aliasing and returns the output texture id, after binding the default frame buffer.
+    // Copy the most recent `Render` result into a region of another frame buffer, scaling if needed.
+    void BlitTo(uint frame_buffer_id, int x, int y, int width, int height) const;
+
+    // Takes effect on the next `PrepareRender`, which recreates the frame buffers if it changed.
+    void SetAntiAliasing(AntiAliasing mode) { Mode = mode; }
+    AntiAliasing GetAntiAliasing() const { return Mode; }
+    // Profiler GPU zone timing the anti-aliasing pass of `Render` (null for `None`, which has no pass).
+    static const char *GetAntiAliasingZone(AntiAliasing);
+    // Estimated GPU memory for frame buffers of the given size with each mode.
+    static uint64_t EstimateBytes(uint width, uint height, AntiAliasing, bool transparency = false);
+
+    // Weighted blended order-independent transparency (McGuire & Bavoil, 2013).
+    // When enabled (taking effect on the next `PrepareRender`), translucent fragments drawn between `BeginTransparentPass`
+    // and `EndTransparentPass` are accumulated into separate targets, sharing the opaque depth buffer, and then composited
+    // over the opaque image in one fullscreen pass. Needs no sorting, and costs the same regardless of overlap depth.
+    void SetTransparency(bool enabled) { Transparency = enabled; }
+    bool GetTransparency() const { return AllocatedTransparency; }
+    void BeginTransparentPass();
+    void EndTransparentPass();
+
+    uint GetSamplesPerPixel() const { return AllocatedMode == AntiAliasing::Msaa ? SubsamplesPerPixel : 1; }
+    uint GetWidth() const { return Width; }
+    uint GetHeight() const { return Height; }
+    uint GetAllocatedWidth() const { return AllocatedWidth; }
+    uint GetAllocatedHeight() const { return AllocatedHeight; }
+    // Fraction of the (padded) texture covered by the most recent render, for texture coordinates.
+    float GetTextureU() const { return AllocatedWidth == 0 ? 1 : float(Width) / AllocatedWidth; }
+    float GetTextureV() const { return AllocatedHeight == 0 ? 1 : float(Height) / AllocatedHeight; }
+
+    MemoryUsage GetMemoryUsage() const;
+
+    inline static const uint SubsamplesPerPixel = 4; // For `Msaa`.
 
 private:
-    uint Width = 0, Height = 0;
-    uint SubsamplesPerPixel = 4;
-    uint FrameBufferId, TextureId, DepthRenderBufferId, ResolveBufferId, ResolveTextureId;
+    uint Width = 0, Height = 0; // Render size, in the bottom-left corner of the allocation.
+    uint AllocatedWidth = 0, AllocatedHeight = 0;
+    AntiAliasing Mode = AntiAliasing::Msaa, AllocatedMode = AntiAliasing::Count;
+    bool Transparency = false, AllocatedTransparency = false;
+    GLFramebufferHandle FrameBufferId, ResolveBufferId; // No resolve buffer for `None`.
+    GLTextureHandle TextureId, ResolveTextureId;
+    GLRenderbufferHandle DepthRenderBufferId;
+    GLFramebufferHandle TransparencyFrameBufferId;
+    GLTextureHandle AccumulationTextureId, WeightTextureId;
+    GLVertexArrayHandle PostProcessVertexArray; // Empty. Core profiles need one bound to draw.
+    uint64_t AllocatedBytes = 0; // Estimated from the attachment sizes, since GL doesn't report driver allocations.
 
+    void ApplyFxaa();
+    void DrawFullscreenTriangle();
+    static const Shader &GetFullscreenVertexShader();
+    uint GetOutputFrameBuffer() const { return AllocatedMode == AntiAliasing::None ? FrameBufferId : ResolveBufferId; }
     void Destroy();
 };
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <utility>
+
+#include <GL/glew.h>
+
+// Cleared just before the GL context is destroyed, so handles that outlive it (e.g. static shared geometry, destroyed at exit)
+// don't call into GL without a context.
+inline bool GLContextAlive = true;
+
+// Owning, move-only handle to a GL object (0 if none).
+// The object is deleted when the handle is destroyed or reset, and moving transfers ownership, so objects are never leaked or double-deleted.
+// Generating is explicit (and needs a current context), so holders can be constructed and moved around on threads without one.
+template<typename Traits> struct GLHandle {
+    GLHandle() = default;
+    explicit GLHandle(GLuint id) : Id(id) {} // Take ownership of an existing object (e.g. from `glCreateShader`).
+    GLHandle(const GLHandle &) = delete;
+    GLHandle &operator=(const GLHandle &) = delete;
+    GLHandle(GLHandle &&other) noexcept : Id(std::exchange(other.Id, 0)) {}
+    GLHandle &operator=(GLHandle &&other) noexcept {
+        if (this != &other) {
+            Reset();
+            Id = std::exchange(other.Id, 0);
+        }
+        return *this;
+    }
+    ~GLHandle() { Reset(); }
+
+    operator GLuint() const { return Id; }
+
+    void Generate() {
+        Reset();
+        Traits::Generate(&Id);
+    }
+    void Reset() {
+        if (Id != 0 && GLContextAlive) Traits::Delete(Id);
+        Id = 0;
+    }
+
+private:
+    GLuint Id{0};
+};
+
+namespace GLObject {
+struct Buffer {
+    static void Generate(GLuint *id) { glGenBuffers(1, id); }
+    static void Delete(GLuint id) { glDeleteBuffers(1, &id); }
+};
+struct VertexArray {
+    static void Generate(GLuint *id) { glGenVertexArrays(1, id); }
+    static void Delete(GLuint id) { glDeleteVertexArrays(1, &id); }
+};
+struct Texture {
+    static void Generate(GLuint *id) { glGenTextures(1, id); }
+    static void Delete(GLuint id) { glDeleteTextures(1, &id); }
+};
+struct Framebuffer {
+    static void Generate(GLuint *id) { glGenFramebuffers(1, id); }
+    static void Delete(GLuint id) { glDeleteFramebuffers(1, &id); }
+};
+struct Renderbuffer {
+    static void Generate(GLuint *id) { glGenRenderbuffers(1, id); }
+    static void Delete(GLuint id) { glDeleteRenderbuffers(1, &id); }
+};
+// Shaders and programs are created with `glCreateShader`/`glCreateProgram`, and adopted with the `GLuint` constructor.
+struct Shader {
+    static void Delete(GLuint id) { glDeleteShader(id); }
+};
+struct Program {
+    static void Delete(GLuint id) { glDeleteProgram(id); }
+};
+} // namespace GLObject
+
+using GLBufferHandle = GLHandle<GLObject::Buffer>;
+using GLVertexArrayHandle = GLHandle<GLObject::VertexArray>;
+using GLTextureHandle = GLHandle<GLObject::Texture>;
+using GLFramebufferHandle = GLHandle<GLObject::Framebuffer>;
+using GLRenderbufferHandle = GLHandle<GLObject::Renderbuffer>;
+using GLShaderHandle = GLHandle<GLObject::Shader>;
+using GLProgramHandle = GLHandle<GLObject::Program>;
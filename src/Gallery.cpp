@@ -0,0 +1,181 @@
+#include "Gallery.h"
+
+#define IMGUI_DEFINE_MATH_OPERATORS
+#include "imgui.h"
+
+#include "GLCanvas.h"
+#include "Molecule.h"
+#include "Scene.h"
+
+static const uint64_t AtlasBytes = uint64_t(Gallery::AtlasSize) * Gallery::AtlasSize * 4; // RGB is typically padded to 4 bytes.
+
+// Same defaults as `MoleculeChain`.
+static const float ThumbnailAtomScale = 0.5, ThumbnailBondRadius = 1.2;
+
+Gallery::Gallery(const fs::path &directory) : Index(DirectoryIndex::Open(directory)) {
+    ThumbnailScene = std::make_unique<::Scene>();
+    ThumbnailEyeDirection = glm::normalize(glm::vec3(glm::inverse(ThumbnailScene->CameraView)[3]));
+
+    AtlasTextureId.Generate();
+    glBindTexture(GL_TEXTURE_2D, AtlasTextureId);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, AtlasSize, AtlasSize, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    LiveGpuMemory.AddGpu(MemoryCategory::Framebuffers, AtlasBytes);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    AtlasFrameBufferId.Generate();
+    glBindFramebuffer(GL_FRAMEBUFFER, AtlasFrameBufferId);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, AtlasTextureId, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+Gallery::~Gallery() {
+    LiveGpuMemory.GpuBytes[size_t(MemoryCategory::Framebuffers)] -= AtlasBytes;
+}
+
+MemoryUsage Gallery::GetMemoryUsage() const {
+    MemoryUsage usage = ThumbnailScene->GetMemoryUsage();
+    usage.AddGpu(MemoryCategory::Framebuffers, AtlasBytes);
+    usage.AddCpu(MemoryCategory::Framebuffers, CachedPixels.size() * ThumbnailSize * ThumbnailSize * 3);
+    usage += Index.GetMemoryUsage();
+    return usage;
+}
+
+static std::pair<uint, uint> SlotOrigin(uint slot) {
+    return {(slot % Gallery::AtlasSlotsPerSide) * Gallery::ThumbnailSize, (slot / Gallery::AtlasSlotsPerSide) * Gallery::ThumbnailSize};
+}
+
+int Gallery::AcquireSlot() {
+    int slot = -1;
+    for (uint i = 0; i < Slots.size(); i++) {
+        if (Slots[i].EntryIndex == -1) return i;
+        if (Slots[i].LastUsedFrame < Frame && (slot == -1 || Slots[i].LastUsedFrame < Slots[slot].LastUsedFrame)) slot = i;
+    }
+    if (slot == -1) return -1;
+
+    // Evict, keeping the pixels around in case it scrolls back into view.
+    const uint evicted_entry_index = Slots[slot].EntryIndex;
+    std::vector<uint8_t> pixels(ThumbnailSize * ThumbnailSize * 3);
+    const auto [x, y] = SlotOrigin(slot);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, AtlasFrameBufferId);
+    glReadPixels(x, y, ThumbnailSize, ThumbnailSize, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+    CachedPixels.emplace_front(evicted_entry_index, std::move(pixels));
+    CachedPixelsForEntry[evicted_entry_index] = CachedPixels.begin();
+    if (CachedPixels.size() > MaxCachedThumbnails) {
+        CachedPixelsForEntry.erase(CachedPixels.back().first);
+        CachedPixels.pop_back();
+    }
+
+    SlotForEntry.erase(evicted_entry_index);
+    Slots[slot].EntryIndex = -1;
+    return slot;
+}
+
+void Gallery::RenderThumbnail(uint entry_index, uint slot) {
+    const auto &entry = Index.Entries[entry_index];
+    Molecule molecule(Index.GetPath(entry_index));
+    molecule.SetAtomScale(ThumbnailAtomScale);
+    molecule.SetBondRadius(ThumbnailBondRadius);
+    ThumbnailScene->AddMesh(&molecule.AtomMesh);
+    ThumbnailScene->AddMesh(&molecule.BondMesh);
+
+    // Frame the molecule using the indexed bounds.
+    const glm::vec3 center = (entry.BoundsMin + entry.BoundsMax) / 2.f;
+    const float distance = std::max(glm::distance(entry.BoundsMin, entry.BoundsMax) * 1.5f, 1.f);
+    ThumbnailScene->CameraView = glm::lookAt(center + ThumbnailEyeDirection * distance, center, Up);
+
+    const auto bg = ImGui::GetStyleColorVec4(ImGuiCol_WindowBg);
+    ThumbnailScene->RenderCanvas(ThumbnailSize, ThumbnailSize, {bg.x, bg.y, bg.z, bg.w});
+    const auto [x, y] = SlotOrigin(slot);
+    ThumbnailScene->Canvas->BlitTo(AtlasFrameBufferId, x, y, ThumbnailSize, ThumbnailSize);
+
+    ThumbnailScene->RemoveMesh(&molecule.AtomMesh);
+    ThumbnailScene->RemoveMesh(&molecule.BondMesh);
+}
+
+int Gallery::RequestThumbnail(uint entry_index) {
+    if (auto found = SlotForEntry.find(entry_index); found != SlotForEntry.end()) {
+        Slots[found->second].LastUsedFrame = Frame;
+        return found->second;
+    }
+
+    const float elapsed_ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - FrameStartTime).count();
+    if (elapsed_ms > RenderBudgetMs) return -1;
+
+    const int slot = AcquireSlot();
+    if (slot == -1) return -1;
+
+    if (auto cached = CachedPixelsForEntry.find(entry_index); cached != CachedPixelsForEntry.end()) {
+        const auto [x, y] = SlotOrigin(slot);
+        glBindTexture(GL_TEXTURE_2D, AtlasTextureId);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, ThumbnailSize, ThumbnailSize, GL_RGB, GL_UNSIGNED_BYTE, cached->second->second.data());
+        CachedPixels.erase(cached->second);
+        CachedPixelsForEntry.erase(cached);
+    } else {
+        RenderThumbnail(entry_index, slot);
+    }
+    Slots[slot] = {int(entry_index), Frame};
+    SlotForEntry[entry_index] = slot;
+    return slot;
+}
+
+using namespace ImGui;
+
+std::optional<fs::path> Gallery::Render() {
+    Frame++;
+    FrameStartTime = std::chrono::steady_clock::now();
+    NumPendingThumbnails = 0;
+
+    Text("%zu molecules in %s", Index.Entries.size(), Index.Directory.c_str());
+    Separator();
+    if (Index.Entries.empty()) return {};
+
+    std::optional<fs::path> open_path;
+    BeginChild("Thumbnails");
+    const auto &style = GetStyle();
+    const float cell_width = ThumbnailSize + style.ItemSpacing.x;
+    const uint columns = std::max(1, int((GetContentRegionAvail().x + style.ItemSpacing.x) / cell_width));
+    const uint rows = (Index.Entries.size() + columns - 1) / columns;
+    const float row_height = ThumbnailSize + GetTextLineHeightWithSpacing() * 2 + style.ItemSpacing.y;
+
+    ImGuiListClipper clipper;
+    clipper.Begin(rows, row_height);
+    while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+            for (uint column = 0; column < columns; column++) {
+                const uint entry_index = row * columns + column;
+                if (entry_index >= Index.Entries.size()) break;
+
+                const auto &entry = Index.Entries[entry_index];
+                if (column > 0) SameLine();
+                PushID(entry_index);
+                BeginGroup();
+                const int slot = RequestThumbnail(entry_index);
+                if (slot >= 0) {
+                    const auto [x, y] = SlotOrigin(slot);
+                    const float s = float(ThumbnailSize) / AtlasSize, u = float(x) / AtlasSize, v = float(y) / AtlasSize;
+                    Image((void *)(intptr_t)AtlasTextureId, {float(ThumbnailSize), float(ThumbnailSize)}, {u, v + s}, {u + s, v});
+                } else {
+                    Dummy({float(ThumbnailSize), float(ThumbnailSize)}); // Not rendered yet. Retried next frame.
+                    NumPendingThumbnails++;
+                }
+                if (IsItemClicked()) SelectedEntryIndex = entry_index;
+                if (IsItemHovered() && IsMouseDoubleClicked(ImGuiMouseButton_Left)) open_path = Index.GetPath(entry_index);
+                if (IsItemHovered()) SetTooltip("%s\n%s: %u atoms, %u bonds", entry.FileName.c_str(), entry.Formula.c_str(), entry.NumAtoms, entry.NumBonds);
+                if (SelectedEntryIndex == int(entry_index)) {
+                    GetWindowDrawList()->AddRect(GetItemRectMin(), GetItemRectMax(), GetColorU32(ImGuiCol_ButtonActive), 0, 0, 2);
+                }
+                TextUnformatted(entry.FileName.c_str());
+                TextDisabled("%s", entry.Formula.c_str());
+                EndGroup();
+                PopID();
+            }
+        }
+    }
+    clipper.End();
+    EndChild();
+
+    return open_path;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+#include "DirectoryIndex.h"
+#include "GLHandle.h"
+#include "Memory.h"
+
+struct Scene;
+
+// Browse a directory of molecules as a grid of thumbnails.
+// Rows are virtualized with `ImGuiListClipper`, and listing only needs the directory index,
+// so molecule files are only ever loaded for thumbnails that are actually shown.
+// Thumbnails are rendered on demand by an offscreen scene, within a per-frame time budget, into a shared texture atlas.
+// Thumbnails evicted from the atlas are kept in a CPU-side LRU cache, so scrolling back re-uploads instead of re-rendering.
+struct Gallery {
+    Gallery(const fs::path &directory);
+    ~Gallery();
+
+    // Render the gallery into the current ImGui window.
+    // Returns the path of a molecule the user chose to open (by double-clicking its thumbnail).
+    std::optional<fs::path> Render();
+    // True if the last `Render` left visible thumbnails to render in later frames.
+    bool HasPendingThumbnails() const { return NumPendingThumbnails > 0; }
+
+    MemoryUsage GetMemoryUsage() const;
+
+    DirectoryIndex Index;
+
+    inline static const uint ThumbnailSize = 128, AtlasSize = 2048; // Pixels
+    inline static const uint AtlasSlotsPerSide = AtlasSize / ThumbnailSize, NumAtlasSlots = AtlasSlotsPerSide * AtlasSlotsPerSide;
+    inline static const uint MaxCachedThumbnails = 2048; // Evicted thumbnails kept on the CPU, at 48 KB (RGB) each.
+    inline static const float RenderBudgetMs = 4; // Max time per frame spent rendering new thumbnails.
+
+private:
+    struct AtlasSlot {
+        int EntryIndex{-1};
+        uint LastUsedFrame{0};
+    };
+
+    // Returns the atlas slot holding the entry's thumbnail, or -1 if it isn't available yet.
+    int RequestThumbnail(uint entry_index);
+    // Returns a free (or least recently used, evicted) atlas slot, or -1 if all slots are visible this frame.
+    int AcquireSlot();
+    void RenderThumbnail(uint entry_index, uint slot);
+
+    std::unique_ptr<::Scene> ThumbnailScene;
+    glm::vec3 ThumbnailEyeDirection;
+    GLTextureHandle AtlasTextureId;
+    GLFramebufferHandle AtlasFrameBufferId;
+    std::vector<AtlasSlot> Slots{NumAtlasSlots};
+    std::unordered_map<uint, uint> SlotForEntry;
+
+    // Most recently evicted thumbnails are at the front.
+    std::list<std::pair<uint, std::vector<uint8_t>>> CachedPixels;
+    std::unordered_map<uint, decltype(CachedPixels)::iterator> CachedPixelsForEntry;
+
+    uint Frame{0};
+    uint NumPendingThumbnails{0}; // Visible this frame, but not rendered yet.
+    std::chrono::steady_clock::time_point FrameStartTime;
+    int SelectedEntryIndex{-1};
+};
@@ -0,0 +1,120 @@
+#include "ImageExport.h"
+
+#include <algorithm>
+#include <format>
+#include <thread>
+
+#define IMGUI_DEFINE_MATH_OPERATORS
+#include "imgui.h"
+
+#include "Molecule.h"
+#include "Scene.h"
+
+using namespace ImGui;
+
+static const float PreviewIntervalSeconds = 0.25; // Max preview upload rate while rendering.
+
+ImageExport::~ImageExport() {
+    Tracer.reset(); // Stop the workers before anything else is destroyed.
+    LiveGpuMemory.GpuBytes[size_t(MemoryCategory::Framebuffers)] -= PreviewBytes;
+}
+
+MemoryUsage ImageExport::GetMemoryUsage() const {
+    MemoryUsage usage;
+    if (Tracer) usage.AddCpu(MemoryCategory::Framebuffers, uint64_t(Tracer->Config.Width) * Tracer->Config.Height * sizeof(glm::vec4));
+    usage.AddGpu(MemoryCategory::Framebuffers, PreviewBytes);
+    return usage;
+}
+
+void ImageExport::Start(const Scene &scene, const MoleculeChain &chain) {
+    RayTracer::Input input;
+    if (!chain.AddToRayTracer(input)) return;
+
+    input.Lights = scene.Lights;
+    input.AmbientColor = scene.AmbientColor;
+    input.DiffuseColor = scene.DiffusionColor;
+    input.SpecularColor = scene.SpecularColor;
+    input.Shininess = scene.Shininess;
+    input.CameraView = scene.CameraView;
+    input.fov = scene.fov;
+
+    Tracer.reset(); // Cancel any render in progress first.
+    // Leave a core for the UI.
+    Settings.NumThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    Tracer = std::make_unique<RayTracer>(std::move(input), Settings);
+    PreviewProgress = -1;
+}
+
+void ImageExport::UpdatePreview() {
+    const float progress = Tracer->GetProgress();
+    const auto now = std::chrono::steady_clock::now();
+    const bool done = Tracer->IsDone();
+    if (progress == PreviewProgress || (!done && std::chrono::duration<float>(now - PreviewTime).count() < PreviewIntervalSeconds)) return;
+
+    const auto &config = Tracer->Config;
+    const uint64_t bytes = uint64_t(config.Width) * config.Height * 4;
+    if (!PreviewTextureId) {
+        PreviewTextureId.Generate();
+        glBindTexture(GL_TEXTURE_2D, PreviewTextureId);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    }
+    glBindTexture(GL_TEXTURE_2D, PreviewTextureId);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, config.Width, config.Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, Tracer->GetImage().data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    LiveGpuMemory.GpuBytes[size_t(MemoryCategory::Framebuffers)] += bytes - PreviewBytes;
+    PreviewBytes = bytes;
+    PreviewProgress = progress;
+    PreviewTime = now;
+}
+
+bool ImageExport::Save(const fs::path &path) const {
+    return Tracer && WritePng(path, Tracer->GetImage(), Tracer->Config.Width, Tracer->Config.Height);
+}
+
+bool ImageExport::Render(const Scene &scene, const MoleculeChain *chain) {
+    SeparatorText("Settings");
+    const bool rendering = IsRendering();
+    if (rendering) BeginDisabled();
+    static const uint MinSize = 1, MaxSize = 8192, MinSamples = 1, MaxSamples = 4096;
+    SliderScalar("Width", ImGuiDataType_U32, &Settings.Width, &MinSize, &MaxSize, "%u", ImGuiSliderFlags_Logarithmic);
+    SliderScalar("Height", ImGuiDataType_U32, &Settings.Height, &MinSize, &MaxSize, "%u", ImGuiSliderFlags_Logarithmic);
+    SliderScalar("Samples per pixel", ImGuiDataType_U32, &Settings.Samples, &MinSamples, &MaxSamples, "%u", ImGuiSliderFlags_Logarithmic);
+    SliderFloat("Light size", &Settings.LightSize, 0, 4, "%.2f");
+    if (IsItemHovered()) SetTooltip("Radius each light is spread over, for soft shadows. 0 for hard shadows.");
+    SliderFloat("Occlusion distance", &Settings.OcclusionDistance, 0, 8, "%.2f");
+    if (IsItemHovered()) SetTooltip("How far ambient light is blocked by nearby atoms and bonds. 0 to disable ambient occlusion.");
+    if (rendering) EndDisabled();
+
+    const bool can_render = chain && chain->CanRayTrace();
+    if (!can_render) BeginDisabled();
+    if (Button(rendering ? "Restart" : "Render")) Start(scene, *chain);
+    if (!can_render) {
+        EndDisabled();
+        SameLine();
+        TextDisabled(chain ? "Not available in grid view." : "No molecule chain has been loaded.");
+    }
+    if (rendering) {
+        SameLine();
+        if (Button("Cancel")) Tracer->Cancel();
+    }
+    if (!Tracer) return false;
+
+    SeparatorText("Image");
+    const float elapsed = Tracer->GetElapsedSeconds(), progress = Tracer->GetProgress();
+    if (IsRendering()) {
+        const float remaining = progress > 0 ? elapsed * (1 - progress) / progress : 0;
+        ProgressBar(progress, {-FLT_MIN, 0}, std::format("{} of {} samples, {:.0f} s left", Tracer->GetCompletedSamples(), Tracer->Config.Samples, remaining).c_str());
+    } else {
+        Text("%u samples per pixel in %.1f s (%u threads)", Tracer->GetCompletedSamples(), elapsed, Tracer->Config.NumThreads);
+    }
+    const bool save = Button("Save PNG...");
+
+    UpdatePreview();
+    if (PreviewTextureId) {
+        const auto &config = Tracer->Config;
+        const float scale = std::min(GetContentRegionAvail().x / config.Width, 1.f);
+        Image((void *)(intptr_t)PreviewTextureId, {config.Width * scale, config.Height * scale});
+    }
+    return save;
+}
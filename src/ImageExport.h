@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+
+#include "GLHandle.h"
+#include "Memory.h"
+#include "RayTracer.h"
+
+struct Scene;
+struct MoleculeChain;
+
+// High-quality stills of the shown molecule, ray traced on the CPU (see `RayTracer`) with the scene's camera and lights.
+// Passes are previewed as they finish, and the image can be saved at any point.
+struct ImageExport {
+    ~ImageExport();
+
+    // Settings, progress and preview, into the current ImGui window.
+    // Returns true if the user asked to save the image (to a path chosen by the caller, see `Save`).
+    bool Render(const Scene &, const MoleculeChain *);
+    // Write the samples so far as a PNG. Returns false if the file couldn't be written.
+    bool Save(const fs::path &) const;
+    bool IsRendering() const { return Tracer && !Tracer->IsDone(); }
+
+    MemoryUsage GetMemoryUsage() const;
+
+private:
+    void Start(const Scene &, const MoleculeChain &);
+    void UpdatePreview();
+
+    RayTracer::Settings Settings;
+    std::unique_ptr<RayTracer> Tracer;
+
+    GLTextureHandle PreviewTextureId;
+    uint64_t PreviewBytes{0};
+    float PreviewProgress{-1}; // Progress of the tracer as of the last preview upload.
+    std::chrono::steady_clock::time_point PreviewTime;
+};
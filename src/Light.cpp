@@ -0,0 +1,25 @@
+#include "Light.h"
+
+#include <cmath>
+
+std::vector<Light> ThreePointLights() {
+    /**
+      Initialize light positions using a three-point lighting system:
+        1) Key light: The main light, positioned at a 45-degree angle from the subject.
+        2) Fill light: Positioned opposite the key light to fill the shadows. It's less intense than the key light.
+        3) Back light: Positioned behind and above the subject to create a rim of light around the subject, separating it from the background.
+      We consider the "subject" to be the origin.
+    */
+    std::vector<Light> lights(3);
+    static const float dist_factor = 8.0f;
+
+    // Key light.
+    // `std::cos`/`std::sin` rather than Apple's `__cospif`/`__sinpif`, since tools using this build on other platforms too.
+    const float key_light_angle = float(M_PI) / 4.f;
+    lights[0].Position = {dist_factor * std::cos(key_light_angle), 0, dist_factor * std::sin(key_light_angle), 1};
+    // Fill light, twice as far away to make it less intense.
+    lights[1].Position = {-dist_factor * std::cos(key_light_angle) * 2, 0, -dist_factor * std::sin(key_light_angle) * 2, 1};
+    // Back light.
+    lights[2].Position = {0, dist_factor * 1.5, -dist_factor, 1};
+    return lights;
+}
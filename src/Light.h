@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/vec4.hpp>
+
+// GL-free, so offline renderers (see `RayTracer`) can share the scene's lights.
+struct Light {
+    glm::vec4 Position{0.0f};
+    glm::vec4 Color{1.0f};
+    float Radius{0}; // Distance at which the light fades out completely. 0 for an unbounded light, with no falloff.
+
+    bool operator==(const Light &) const = default;
+};
+
+// The default lighting: key, fill and back lights around the origin.
+std::vector<Light> ThreePointLights();
@@ -0,0 +1,138 @@
+#include "Lights.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/common.hpp>
+
+using glm::vec2, glm::vec3, glm::vec4, glm::mat4, glm::uvec2;
+
+// Inclusive range of covered tiles.
+struct TileRect {
+    uint MinColumn, MinRow, MaxColumn, MaxRow;
+};
+
+LightTiles::LightTiles() {
+    LightBuffer.Generate();
+    TileBuffer.Generate();
+    IndexBuffer.Generate();
+    TileTexture.Generate();
+    IndexTexture.Generate();
+}
+
+MemoryUsage LightTiles::GetMemoryUsage() const {
+    MemoryUsage usage;
+    usage.AddCpu(MemoryCategory::Uniforms, Tiles.capacity() * sizeof(uvec2) + Indices.capacity() * sizeof(GLuint));
+    usage.AddGpu(MemoryCategory::Uniforms, LightBuffer.Bytes + TileBuffer.Bytes + IndexBuffer.Bytes);
+    return usage;
+}
+
+// Normalized device x/y bounds of a light's sphere of influence, or false if it's entirely off-screen.
+static bool ComputeScreenBounds(const Light &light, const mat4 &view, const mat4 &projection, float near, vec2 &min, vec2 &max) {
+    min = vec2(-1), max = vec2(1);
+    if (light.Radius <= 0) return true;
+
+    const vec3 center = vec3(light.Position) / light.Position.w;
+    const vec3 view_center = vec3(view * vec4(center, 1));
+    const float radius = light.Radius;
+    // The camera looks down -z.
+    if (view_center.z - radius > -near) return false; // Behind the camera.
+    if (view_center.z + radius > -near) return true; // Crosses the near plane, so may cover the whole screen.
+
+    // Project the corners of the sphere's view-space bounding box.
+    min = vec2(1), max = vec2(-1);
+    for (uint corner = 0; corner < 8; corner++) {
+        const vec3 offset{corner & 1 ? radius : -radius, corner & 2 ? radius : -radius, corner & 4 ? radius : -radius};
+        const vec4 clip = projection * vec4(view_center + offset, 1);
+        const vec2 ndc = vec2(clip) / clip.w;
+        min = glm::min(min, ndc);
+        max = glm::max(max, ndc);
+    }
+    if (min.x > 1 || min.y > 1 || max.x < -1 || max.y < -1) return false;
+
+    min = glm::max(min, vec2(-1));
+    max = glm::min(max, vec2(1));
+    return true;
+}
+
+void LightTiles::Update(const std::vector<Light> &lights, const mat4 &view, const mat4 &projection, float near, uint width, uint height, uint num_viewports) {
+    Profiler::CpuZone zone{"LightTiles::Update"};
+    const uint num_lights = std::min(uint(lights.size()), MaxLights);
+    std::vector<vec4> light_data;
+    light_data.reserve(num_lights * 2);
+    for (uint i = 0; i < num_lights; i++) {
+        light_data.push_back(lights[i].Position);
+        light_data.emplace_back(vec3(lights[i].Color), lights[i].Radius);
+    }
+    if (light_data.empty()) light_data.resize(2); // GL buffers can't be empty.
+    LightBuffer.SetData(light_data, GL_DYNAMIC_DRAW);
+
+    TileColumns = (width + TileSize - 1) / TileSize;
+    const uint tile_rows = (height + TileSize - 1) / TileSize;
+    const float viewport_width = float(std::max(width / std::max(num_viewports, 1u), 1u));
+
+    // Find the tiles covered by each light in each viewport, counting lights per tile.
+    std::vector<TileRect> rects;
+    std::vector<uint> rect_lights;
+    for (uint i = 0; i < num_lights; i++) {
+        vec2 min, max;
+        if (!ComputeScreenBounds(lights[i], view, projection, near, min, max)) continue;
+
+        const vec2 min_fraction = min * 0.5f + 0.5f, max_fraction = max * 0.5f + 0.5f;
+        for (uint viewport = 0; viewport < num_viewports; viewport++) {
+            const float x = viewport * viewport_width;
+            const auto to_column = [&](float fraction) { return std::min(uint(std::clamp(x + fraction * viewport_width, x, x + viewport_width - 1)) / TileSize, TileColumns - 1); };
+            const auto to_row = [&](float fraction) { return std::min(uint(std::max(fraction * height, 0.f)) / TileSize, tile_rows - 1); };
+            rects.push_back({to_column(min_fraction.x), to_row(min_fraction.y), to_column(max_fraction.x), to_row(max_fraction.y)});
+            rect_lights.push_back(i);
+        }
+    }
+
+    // Count, then fill, each tile's list.
+    // Tiles straddling two viewports can be covered by both of a light's rects, so lights are only added to a tile once.
+    Tiles.assign(TileColumns * tile_rows, uvec2{0});
+    std::vector<uint> tile_last_light(Tiles.size());
+    const auto for_each_tile_light = [&](auto &&add) {
+        std::fill(tile_last_light.begin(), tile_last_light.end(), MaxLights);
+        for (uint r = 0; r < rects.size(); r++) {
+            const auto &rect = rects[r];
+            for (uint row = rect.MinRow; row <= rect.MaxRow; row++) {
+                for (uint column = rect.MinColumn; column <= rect.MaxColumn; column++) {
+                    const uint tile = row * TileColumns + column;
+                    if (tile_last_light[tile] == rect_lights[r]) continue;
+                    tile_last_light[tile] = rect_lights[r];
+                    add(Tiles[tile], rect_lights[r]);
+                }
+            }
+        }
+    };
+    for_each_tile_light([](uvec2 &tile, uint) { tile.y++; });
+    uint offset = 0;
+    for (auto &tile : Tiles) {
+        tile.x = offset;
+        offset += tile.y;
+        tile.y = 0; // Recounted while filling.
+    }
+    Indices.resize(offset);
+    for_each_tile_light([this](uvec2 &tile, uint light) { Indices[tile.x + tile.y++] = light; });
+    NumTileLights = offset;
+    if (Indices.empty()) Indices.push_back(0);
+
+    TileBuffer.SetData(Tiles, GL_DYNAMIC_DRAW);
+    IndexBuffer.SetData(Indices, GL_DYNAMIC_DRAW);
+
+    glBindTexture(GL_TEXTURE_BUFFER, TileTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, TileBuffer.Id);
+    glBindTexture(GL_TEXTURE_BUFFER, IndexTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, IndexBuffer.Id);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightTiles::Bind(GLuint light_block_binding, uint tiles_unit, uint indices_unit) const {
+    glBindBufferBase(GL_UNIFORM_BUFFER, light_block_binding, LightBuffer.Id);
+    glActiveTexture(GL_TEXTURE0 + tiles_unit);
+    glBindTexture(GL_TEXTURE_BUFFER, TileTexture);
+    glActiveTexture(GL_TEXTURE0 + indices_unit);
+    glBindTexture(GL_TEXTURE_BUFFER, IndexTexture);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+#include <glm/vec2.hpp>
+
+#include "Light.h"
+#include "Mesh/Geometry.h"
+
+// Tiled forward lighting.
+// Each frame, lights are binned on the CPU into square screen tiles covered by their sphere of influence,
+// and the fragment shader only loops over the lights in its tile.
+// Bounded lights then cost only the pixels they reach, so scenes can have dozens of small lights.
+// Unbounded lights (like the default three-point rig) are in every tile.
+struct LightTiles {
+    LightTiles();
+
+    inline static const uint TileSize = 16; // In pixels.
+    inline static const uint MaxLights = 256; // Must match `max_num_lights` in fragment.glsl.
+
+    // Bin lights for a `width` x `height` canvas split into `num_viewports` equal-width columns sharing the camera,
+    // and upload the lights and tile lists. Lights past `MaxLights` are ignored.
+    void Update(const std::vector<Light> &, const glm::mat4 &view, const glm::mat4 &projection, float near, uint width, uint height, uint num_viewports);
+    // Bind the light block to its uniform block binding point, and the tile lists to the two texture units.
+    void Bind(GLuint light_block_binding, uint tiles_unit, uint indices_unit) const;
+
+    uint GetTileColumns() const { return TileColumns; }
+    uint GetNumTiles() const { return Tiles.size(); }
+    uint GetNumTileLights() const { return NumTileLights; } // Light entries in all tile lists, as of the last `Update`.
+
+    MemoryUsage GetMemoryUsage() const;
+
+private:
+    uint TileColumns{0}, NumTileLights{0};
+    std::vector<glm::uvec2> Tiles; // (offset into `Indices`, number of lights) per tile, row-major from the bottom-left.
+    std::vector<GLuint> Indices;
+
+    GLBuffer<glm::vec4, GL_UNIFORM_BUFFER> LightBuffer{MemoryCategory::Uniforms}; // (position, color with radius in alpha) per light.
+    GLBuffer<glm::uvec2, GL_TEXTURE_BUFFER> TileBuffer{MemoryCategory::Uniforms};
+    GLBuffer<GLuint, GL_TEXTURE_BUFFER> IndexBuffer{MemoryCategory::Uniforms};
+    GLTextureHandle TileTexture, IndexTexture;
+};
@@ -0,0 +1,71 @@
+#include "Memory.h"
+
+#include <format>
+
+#include "imgui.h"
+
+MemoryUsage &MemoryUsage::operator+=(const MemoryUsage &other) {
+    for (size_t i = 0; i < CpuBytes.size(); i++) {
+        CpuBytes[i] += other.CpuBytes[i];
+        GpuBytes[i] += other.GpuBytes[i];
+    }
+    return *this;
+}
+
+uint64_t MemoryUsage::TotalCpu() const {
+    uint64_t total = 0;
+    for (const auto bytes : CpuBytes) total += bytes;
+    return total;
+}
+uint64_t MemoryUsage::TotalGpu() const {
+    uint64_t total = 0;
+    for (const auto bytes : GpuBytes) total += bytes;
+    return total;
+}
+
+std::string MemoryUsage::ToJson() const {
+    std::string cpu, gpu;
+    for (size_t i = 0; i < CpuBytes.size(); i++) {
+        const char *separator = i == 0 ? "" : ", ";
+        cpu += std::format("{}\"{}\": {}", separator, MemoryCategoryNames[i], CpuBytes[i]);
+        gpu += std::format("{}\"{}\": {}", separator, MemoryCategoryNames[i], GpuBytes[i]);
+    }
+    return std::format("{{\"cpu\": {{{}}}, \"gpu\": {{{}}}}}", cpu, gpu);
+}
+
+std::string FormatBytes(uint64_t bytes) {
+    if (bytes < 1024) return std::format("{} B", bytes);
+    if (bytes < 1024 * 1024) return std::format("{:.1f} KB", bytes / 1024.0);
+    if (bytes < 1024 * 1024 * 1024) return std::format("{:.1f} MB", bytes / (1024.0 * 1024.0));
+    return std::format("{:.2f} GB", bytes / (1024.0 * 1024.0 * 1024.0));
+}
+
+using namespace ImGui;
+
+bool MemoryUsage::BeginTable(const char *id) {
+    if (!ImGui::BeginTable(id, 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) return false;
+
+    TableSetupColumn("");
+    TableSetupColumn("CPU", ImGuiTableColumnFlags_WidthFixed);
+    TableSetupColumn("GPU", ImGuiTableColumnFlags_WidthFixed);
+    TableHeadersRow();
+    return true;
+}
+
+void MemoryUsage::RenderTableRow(const char *label) const {
+    TableNextRow();
+    TableNextColumn();
+    TextUnformatted(label);
+    if (IsItemHovered()) {
+        std::string tooltip;
+        for (size_t i = 0; i < CpuBytes.size(); i++) {
+            if (CpuBytes[i] == 0 && GpuBytes[i] == 0) continue;
+            tooltip += std::format("{}{}: {} CPU, {} GPU", tooltip.empty() ? "" : "\n", MemoryCategoryNames[i], FormatBytes(CpuBytes[i]), FormatBytes(GpuBytes[i]));
+        }
+        if (!tooltip.empty()) SetTooltip("%s", tooltip.c_str());
+    }
+    TableNextColumn();
+    TextUnformatted(FormatBytes(TotalCpu()).c_str());
+    TableNextColumn();
+    TextUnformatted(FormatBytes(TotalGpu()).c_str());
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+enum class MemoryCategory {
+    Geometry, // Vertices, normals and indices.
+    Instances, // Per-instance transforms and colors.
+    Framebuffers, // Render targets, and textures or pixels read back from them.
+    Uniforms, // Shader inputs rewritten as the scene changes: uniform blocks and per-frame texture buffers (light tiles).
+    ParseBuffers, // Data kept from parsing molecule files (atom types, directory index entries).
+    Analysis, // Results derived from molecules (per-frame metrics, alignments), and frames queued to compute them.
+    Count,
+};
+
+inline const char *MemoryCategoryNames[]{"Geometry", "Instances", "Framebuffers", "Uniforms", "Parse buffers", "Analysis"};
+
+// CPU and GPU bytes by category.
+// Usage of an object (mesh, chain, ...) is computed on demand from its containers and GL buffers, with `GetMemoryUsage` methods.
+struct MemoryUsage {
+    std::array<uint64_t, size_t(MemoryCategory::Count)> CpuBytes{}, GpuBytes{};
+
+    void AddCpu(MemoryCategory category, uint64_t bytes) { CpuBytes[size_t(category)] += bytes; }
+    void AddGpu(MemoryCategory category, uint64_t bytes) { GpuBytes[size_t(category)] += bytes; }
+    MemoryUsage &operator+=(const MemoryUsage &);
+
+    uint64_t TotalCpu() const;
+    uint64_t TotalGpu() const;
+
+    std::string ToJson() const; // {"cpu": {<category>: bytes, ...}, "gpu": {...}}
+    // Single ImGui table row per usage (see `BeginTable`), with CPU/GPU totals and a per-category tooltip.
+    void RenderTableRow(const char *label) const;
+    static bool BeginTable(const char *id);
+};
+
+// Live totals of all GPU allocations (`GpuBytes` only), updated on every `GLBuffer` and `GLCanvas` allocation and free.
+// Only touched from the GL thread.
+// Anything here not covered by the `GetMemoryUsage` of a live object is leaked.
+inline MemoryUsage LiveGpuMemory;
+
+std::string FormatBytes(uint64_t bytes); // E.g. "1.5 MB"
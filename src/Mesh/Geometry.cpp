@@ -3,12 +3,18 @@
 #include <unordered_set>
 
 void Geometry::Generate() {
+    if (VertexBuffer.Id != 0) return; // Already generated by another mesh sharing this geometry.
+
     VertexBuffer.Generate();
     NormalBuffer.Generate();
     IndexBuffer.Generate();
+    if (!VertexCopies.empty()) CopyBuffer.Generate();
+    Dirty = true;
 }
 
 void Geometry::EnableVertexAttributes() const {
+    IndexBuffer.Bind(); // Element buffer binding is part of the vertex array state.
+
     VertexBuffer.Bind();
     static const GLuint VertexSlot = 0;
     glEnableVertexAttribArray(VertexSlot);
@@ -19,13 +25,19 @@ void Geometry::EnableVertexAttributes() const {
     glEnableVertexAttribArray(NormalSlot);
     glVertexAttribPointer(NormalSlot, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), 0);
 
-    Dirty = true;
+    // Without copies, the attribute array stays disabled, and the shader reads the default 0.
+    if (VertexCopies.empty()) return;
+    CopyBuffer.Bind();
+    static const GLuint CopySlot = 7;
+    glEnableVertexAttribArray(CopySlot);
+    glVertexAttribPointer(CopySlot, 1, GL_FLOAT, GL_FALSE, sizeof(float), 0);
 }
 
-void Geometry::Delete() const {
-    VertexBuffer.Delete();
-    NormalBuffer.Delete();
-    IndexBuffer.Delete();
+MemoryUsage Geometry::GetMemoryUsage() const {
+    MemoryUsage usage;
+    usage.AddCpu(MemoryCategory::Geometry, Vertices.capacity() * sizeof(glm::vec3) + Normals.capacity() * sizeof(glm::vec3) + Indices.capacity() * sizeof(uint) + VertexCopies.capacity() * sizeof(float));
+    usage.AddGpu(MemoryCategory::Geometry, VertexBuffer.Bytes + NormalBuffer.Bytes + IndexBuffer.Bytes + CopyBuffer.Bytes);
+    return usage;
 }
 
 void Geometry::BindData() const {
@@ -33,6 +45,7 @@ void Geometry::BindData() const {
         VertexBuffer.SetData(Vertices);
         NormalBuffer.SetData(Normals);
         IndexBuffer.SetData(Indices);
+        if (!VertexCopies.empty()) CopyBuffer.SetData(VertexCopies);
     }
     Dirty = false;
 }
@@ -5,21 +5,57 @@
 #include <GL/glew.h>
 #include <glm/mat4x4.hpp>
 
+#include "GLHandle.h"
+#include "Memory.h"
 #include "MeshBuffers.h"
+#include "Profiler.h"
+#include "Trace.h"
 
+// Owns its GL buffer, which is freed on destruction. Movable, so holders can be moved or swapped.
 template<typename DataType, GLenum Target>
 struct GLBuffer {
-    void Generate() { glGenBuffers(1, &Id); }
-    void Delete() const { glDeleteBuffers(1, &Id); }
+    GLBuffer(MemoryCategory category) : Category(category) {}
+    GLBuffer(GLBuffer &&other) noexcept : Category(other.Category), Id(std::move(other.Id)), Bytes(std::exchange(other.Bytes, 0)) {}
+    GLBuffer &operator=(GLBuffer &&other) noexcept {
+        if (this != &other) {
+            Delete();
+            Category = other.Category;
+            Id = std::move(other.Id);
+            Bytes = std::exchange(other.Bytes, 0);
+        }
+        return *this;
+    }
+    ~GLBuffer() { Delete(); }
+
+    void Generate() { Id.Generate(); }
+    void Delete() {
+        Id.Reset();
+        LiveGpuMemory.GpuBytes[size_t(Category)] -= Bytes;
+        Bytes = 0;
+    }
     void Bind() const { glBindBuffer(Target, Id); }
     void Unbind() const { glBindBuffer(Target, 0); }
 
     void SetData(const std::vector<DataType> &data, GLenum usage = GL_STATIC_DRAW) const {
+        Trace::Scope trace{"Buffer upload", "gpu"};
+        Bind();
+        const uint64_t bytes = data.size() * sizeof(DataType);
+        glBufferData(Target, bytes, data.data(), usage);
+        LiveGpuMemory.GpuBytes[size_t(Category)] += bytes - Bytes;
+        Bytes = bytes;
+        Profiler::AddUploadedBytes(bytes);
+    }
+
+    // Overwrite one element of the current allocation.
+    void SetSubData(uint index, const DataType &value) const {
         Bind();
-        glBufferData(Target, data.size() * sizeof(DataType), data.data(), usage);
+        glBufferSubData(Target, index * sizeof(DataType), sizeof(DataType), &value);
+        Profiler::AddUploadedBytes(sizeof(DataType));
     }
 
-    uint Id = 0;
+    MemoryCategory Category;
+    GLBufferHandle Id;
+    mutable uint64_t Bytes = 0; // Size of the current GL allocation.
 };
 
 inline static const glm::mat4 Identity(1.f);
@@ -28,16 +64,19 @@ inline static const glm::vec3 Origin{0.f}, Up{0.f, 1.f, 0.f};
 // todo use OpenMesh as the main mesh data structure, and derive all fields from it.
 struct Geometry : MeshBuffers {
     Geometry() : MeshBuffers() {}
-
+    Geometry(Geometry &&) = default;
+    Geometry &operator=(Geometry &&) = default;
     virtual ~Geometry() = default;
 
     void EnableVertexAttributes() const;
-    void Generate();
-    void Delete() const;
+    void Generate(); // No-op if already generated.
 
     void BindData() const; // Only rebinds the data if it has changed.
 
-    GLBuffer<glm::vec3, GL_ARRAY_BUFFER> VertexBuffer;
-    GLBuffer<glm::vec3, GL_ARRAY_BUFFER> NormalBuffer;
-    GLBuffer<uint, GL_ELEMENT_ARRAY_BUFFER> IndexBuffer;
+    MemoryUsage GetMemoryUsage() const;
+
+    GLBuffer<glm::vec3, GL_ARRAY_BUFFER> VertexBuffer{MemoryCategory::Geometry};
+    GLBuffer<glm::vec3, GL_ARRAY_BUFFER> NormalBuffer{MemoryCategory::Geometry};
+    GLBuffer<uint, GL_ELEMENT_ARRAY_BUFFER> IndexBuffer{MemoryCategory::Geometry};
+    GLBuffer<float, GL_ARRAY_BUFFER> CopyBuffer{MemoryCategory::Geometry}; // Only generated for geometry with `VertexCopies`.
 };
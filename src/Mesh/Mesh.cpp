@@ -1,25 +1,42 @@
 #include "Mesh.h"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 using glm::vec3, glm::vec4, glm::mat4;
 
+// Draw order attribute (see `transform_vertex.glsl`). Only enabled while sorted, and reads as 0 (instance order) otherwise.
+static const GLuint DrawIndexSlot = 8;
+
 void Mesh::Generate() {
     VertexArray.Generate();
     ColorBuffer.Generate();
     TransformBuffer.Generate();
-    Triangles.Generate();
+    DrawOrderBuffer.Generate();
+    Triangles->Generate();
     EnableVertexAttributes();
+
+    // Buffer textures track their buffer's data store, so instance uploads never need to re-attach them.
+    TransformTexture.Generate();
+    ColorTexture.Generate();
+    glBindTexture(GL_TEXTURE_BUFFER, TransformTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, TransformBuffer.Id);
+    glBindTexture(GL_TEXTURE_BUFFER, ColorTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, ColorBuffer.Id);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
 }
 
-void Mesh::Delete() const {
-    VertexArray.Delete();
-    TransformBuffer.Delete();
-    ColorBuffer.Delete();
-    Triangles.Delete();
+MemoryUsage Mesh::GetMemoryUsage() const {
+    MemoryUsage usage = Triangles.use_count() == 1 ? Triangles->GetMemoryUsage() : MemoryUsage{};
+    usage.AddCpu(MemoryCategory::Instances, Transforms.capacity() * sizeof(mat4) + Colors.capacity() * sizeof(vec4) + DrawOrder.capacity() * sizeof(float));
+    usage.AddGpu(MemoryCategory::Instances, TransformBuffer.Bytes + ColorBuffer.Bytes + DrawOrderBuffer.Bytes);
+    return usage;
 }
 
 void Mesh::EnableVertexAttributes() const {
     VertexArray.Bind();
-    Triangles.EnableVertexAttributes();
+    Triangles->EnableVertexAttributes();
 
     ColorBuffer.Bind();
     static const GLuint ColorSlot = 2;
@@ -35,31 +52,104 @@ void Mesh::EnableVertexAttributes() const {
         glVertexAttribPointer(TransformSlot + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (GLvoid *)(i * sizeof(glm::vec4)));
         glVertexAttribDivisor(TransformSlot + i, 1); // Attribute is updated once per instance.
     }
+
+    DrawOrderBuffer.Bind();
+    glVertexAttribPointer(DrawIndexSlot, 1, GL_FLOAT, GL_FALSE, sizeof(float), 0);
+    glVertexAttribDivisor(DrawIndexSlot, 1);
     VertexArray.Unbind();
 }
 
 void Mesh::BindData() const {
+    Profiler::CpuZone zone{"Mesh::BindData"};
     VertexArray.Bind();
-    Triangles.BindData();
+    Triangles->BindData();
 
     if (Dirty) {
         TransformBuffer.SetData(Transforms);
         ColorBuffer.SetData(Colors);
+        const auto instance_colors_end = Colors.begin() + std::min(Colors.size(), Transforms.size());
+        TranslucentInstances = std::count_if(Colors.begin(), instance_colors_end, [](const vec4 &color) { return color.a < 1; });
+        const uint copies = Triangles->NumCopies();
+        DrawnCopies = 1;
+        for (uint i = 0; i < Transforms.size() && DrawnCopies < copies; i++) {
+            DrawnCopies = std::max(DrawnCopies, std::min(uint(std::ceil(Transforms[i][0][3])), copies));
+        }
+    } else {
+        // Color updates keep alpha, so the translucent instance count is unchanged.
+        for (const uint instance : ColorUpdates) ColorBuffer.SetSubData(instance, Colors[instance]);
     }
     Dirty = false;
+    ColorUpdates.clear();
+
+    // Instance data stays in instance order, so re-sorting only uploads the order itself.
+    const bool sorted = IsSorted();
+    if (sorted && DrawOrderDirty) DrawOrderBuffer.SetData(DrawOrder, GL_DYNAMIC_DRAW);
+    if (sorted != DrawOrderEnabled) {
+        if (sorted) glEnableVertexAttribArray(DrawIndexSlot);
+        else glDisableVertexAttribArray(DrawIndexSlot);
+        DrawOrderEnabled = sorted;
+    }
+    DrawOrderDirty = false;
 
     VertexArray.Unbind();
 }
 
-void Mesh::Render() const {
-    if (Transforms.empty()) return;
+void Mesh::SortFrontToBack(const vec3 &eye) {
+    Profiler::CpuZone zone{"Mesh::SortFrontToBack"};
+    const uint n = Transforms.size();
+    if (n < 2) return;
+
+    std::vector<float> distances(n);
+    float min_distance = std::numeric_limits<float>::max(), max_distance = 0;
+    for (uint i = 0; i < n; i++) {
+        const vec3 to_instance = GetPosition(i) - eye;
+        distances[i] = glm::dot(to_instance, to_instance);
+        min_distance = std::min(min_distance, distances[i]);
+        max_distance = std::max(max_distance, distances[i]);
+    }
 
+    // Coarse, linear-time ordering: counting sort into distance buckets, keeping instance order within each bucket.
+    static const uint NumBuckets = 64;
+    const float bucket_scale = max_distance > min_distance ? (NumBuckets - 1) / (max_distance - min_distance) : 0;
+    std::vector<uint> bucket_offsets(NumBuckets + 1, 0);
+    for (const float distance : distances) bucket_offsets[uint((distance - min_distance) * bucket_scale) + 1]++;
+    for (uint b = 1; b <= NumBuckets; b++) bucket_offsets[b] += bucket_offsets[b - 1];
+    DrawOrder.resize(n);
+    for (uint i = 0; i < n; i++) DrawOrder[bucket_offsets[uint((distances[i] - min_distance) * bucket_scale)]++] = float(i + 1);
+    DrawOrderDirty = true;
+}
+
+void Mesh::ClearDrawOrder() {
+    if (DrawOrder.empty()) return;
+
+    DrawOrder.clear();
+    DrawOrderDirty = true;
+}
+
+void Mesh::Render() {
+    if (Transforms.empty()) {
+        TranslucentInstances = 0;
+        Dirty = false;
+        ColorUpdates.clear(); // Nothing to draw, and adding instances marks the mesh dirty again.
+        return;
+    }
+
+    Trace::Scope trace{"Draw", "draw"};
+    if (VertexArray.Id == 0) Generate();
     BindData(); // Only rebinds the data if it has changed.
     VertexArray.Bind();
+    if (DrawOrderEnabled) {
+        glActiveTexture(GL_TEXTURE0 + InstanceTransformsUnit);
+        glBindTexture(GL_TEXTURE_BUFFER, TransformTexture);
+        glActiveTexture(GL_TEXTURE0 + InstanceColorsUnit);
+        glBindTexture(GL_TEXTURE_BUFFER, ColorTexture);
+        glActiveTexture(GL_TEXTURE0);
+    }
 
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
-    uint num_indices = Triangles.Indices.size();
+    const uint num_indices = Triangles->Indices.size() / Triangles->NumCopies() * DrawnCopies;
+    Profiler::AddDrawCall(uint64_t(num_indices / 3) * Transforms.size());
     if (Transforms.size() == 1) {
         glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_INT, 0);
     } else {
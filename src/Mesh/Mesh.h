@@ -2,33 +2,56 @@
 
 #include "Geometry.h"
 
+#include <memory>
+
 #include <glm/gtx/quaternion.hpp>
 
 struct GLVertexArray {
-    void Generate() { glGenVertexArrays(1, &Id); }
-    void Delete() const { glDeleteVertexArrays(1, &Id); }
+    void Generate() { Id.Generate(); }
     void Bind() const { glBindVertexArray(Id); }
     void Unbind() const { glBindVertexArray(0); }
 
-    uint Id = 0;
+    GLVertexArrayHandle Id;
 };
 
 struct Mesh {
-    Mesh(Geometry &&triangles) : Triangles(std::move(triangles)) {}
+    Mesh(Geometry &&triangles) : Triangles(std::make_shared<Geometry>(std::move(triangles))) {}
+    // Share geometry (and its GL buffers) with other meshes. Each mesh still has its own instances.
+    Mesh(std::shared_ptr<Geometry> triangles) : Triangles(std::move(triangles)) {}
+    // GL objects are owned, and freed on destruction (shared geometry is freed with its last mesh).
+    // Moving transfers them, so meshes can be built elsewhere and swapped in.
+    Mesh(Mesh &&) = default;
+    Mesh &operator=(Mesh &&) = default;
     virtual ~Mesh() {}
 
     const glm::mat4 &GetTransform(uint instance = 0) const { return Transforms[instance]; }
 
+    // GL objects are generated on first `Render`, so meshes can be built (e.g. by a benchmark or worker thread) without a GL context.
     void Generate();
-    void Delete() const;
     void EnableVertexAttributes() const;
 
-    void Render() const;
+    void Render();
+    // True if the mesh has changed since it was last rendered.
+    bool IsDirty() const { return Dirty || DrawOrderDirty || !ColorUpdates.empty() || (!Transforms.empty() && Triangles->Dirty); }
 
     uint NumInstances() const { return Transforms.size(); }
+    // Instances with a color alpha below one, as of the last `Render`.
+    uint NumTranslucentInstances() const { return TranslucentInstances; }
+
+    // Draw instances roughly nearest-first from `eye`, so the depth test rejects more hidden fragments before shading.
+    // Only a per-instance draw order is uploaded (see `DrawIndexSlot`). Instance data and indices are unaffected.
+    void SortFrontToBack(const glm::vec3 &eye);
+    void ClearDrawOrder(); // Draw in instance order.
+
+    // Sorted meshes draw the instance at each position of their draw order, read from buffer textures over their instance data,
+    // bound to these units while drawing (see `transform_vertex.glsl`).
+    inline static const uint InstanceTransformsUnit = 4, InstanceColorsUnit = 5;
+
+    // Instance data, plus the geometry only if no other mesh shares it (shared geometry is accounted for by its owner).
+    MemoryUsage GetMemoryUsage() const;
 
     std::pair<glm::vec3, glm::vec3> ComputeBounds() const {
-        auto [min, max] = Triangles.ComputeBounds();
+        auto [min, max] = Triangles->ComputeBounds();
         for (uint instance = 0; instance < NumInstances(); instance++) {
             glm::vec3 position = GetPosition(instance);
             min.x = std::min(min.x, position.x);
@@ -102,10 +125,17 @@ struct Mesh {
         Transforms.clear();
         Dirty = true;
     }
+    const glm::vec4 &GetColor(uint instance) const { return Colors[instance]; }
     void SetColor(uint instance, const glm::vec4 &color) {
         Colors[instance] = color;
         Dirty = true;
     }
+    // Like `SetColor`, but only uploads this instance's color, rather than all instance data (e.g. for highlighting).
+    // Must keep the color's alpha.
+    void UpdateColor(uint instance, const glm::vec4 &color) {
+        Colors[instance] = color;
+        if (!Dirty) ColorUpdates.push_back(instance);
+    }
     void SetColor(const glm::vec4 &color) {
         Colors.clear();
         Colors.resize(Transforms.size(), color);
@@ -121,16 +151,29 @@ struct Mesh {
         Dirty = true;
     }
 
-    Geometry Triangles;
+    std::shared_ptr<Geometry> Triangles;
 
 private:
     std::vector<glm::vec4> Colors{{1, 1, 1, 1}};
     std::vector<glm::mat4> Transforms{glm::mat4{1}};
 
     GLVertexArray VertexArray;
-    GLBuffer<glm::vec4, GL_ARRAY_BUFFER> ColorBuffer;
-    GLBuffer<glm::mat4, GL_ARRAY_BUFFER> TransformBuffer;
+    GLBuffer<glm::vec4, GL_ARRAY_BUFFER> ColorBuffer{MemoryCategory::Instances};
+    GLBuffer<glm::mat4, GL_ARRAY_BUFFER> TransformBuffer{MemoryCategory::Instances};
     mutable bool Dirty{true};
-
+    mutable uint TranslucentInstances{0};
+    // Leading geometry copies any instance draws (its bond order, see `transform_vertex.glsl`), as of the last instance upload.
+    // Later copies would only collapse to points, so their indices aren't drawn.
+    mutable uint DrawnCopies{1};
+    mutable std::vector<uint> ColorUpdates; // Instances whose color changed since the last full upload.
+
+    // Instance index + 1 for each draw position, as floats for the vertex attribute (exact up to 2^24 instances).
+    // Ignored unless it covers all instances.
+    std::vector<float> DrawOrder;
+    mutable bool DrawOrderDirty{false}, DrawOrderEnabled{false};
+    GLBuffer<float, GL_ARRAY_BUFFER> DrawOrderBuffer{MemoryCategory::Instances};
+    GLTextureHandle TransformTexture, ColorTexture; // Over `TransformBuffer` and `ColorBuffer`.
+
+    bool IsSorted() const { return !DrawOrder.empty() && DrawOrder.size() == Transforms.size(); }
     void BindData() const;
 };
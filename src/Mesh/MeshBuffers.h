@@ -9,12 +9,17 @@ namespace fs = std::filesystem;
 
 struct MeshBuffers {
     MeshBuffers() {}
+    MeshBuffers(const MeshBuffers &) = default;
+    MeshBuffers(MeshBuffers &&) = default;
+    MeshBuffers &operator=(const MeshBuffers &) = default;
+    MeshBuffers &operator=(MeshBuffers &&) = default;
     virtual ~MeshBuffers() = default;
 
     void Clear() {
         Vertices.clear();
         Normals.clear();
         Indices.clear();
+        VertexCopies.clear();
         Dirty = true;
     }
 
@@ -41,4 +46,10 @@ struct MeshBuffers {
     std::vector<glm::vec3> Vertices;
     std::vector<uint> Indices;
     std::vector<glm::vec3> Normals;
+    // Optional. For geometry made of several copies of a shape, the copy each vertex belongs to,
+    // so the vertex shader can expand one instance into several shapes (see `Cylinder`). Empty for a single copy.
+    std::vector<float> VertexCopies;
+
+    // Copies are stored one after another, each with the same number of indices.
+    uint NumCopies() const { return VertexCopies.empty() ? 1 : uint(VertexCopies.back()) + 1; }
 };
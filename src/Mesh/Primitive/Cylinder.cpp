@@ -1,6 +1,6 @@
 #include "Cylinder.h"
 
-Cylinder::Cylinder(float radius, float height, uint slices) : Geometry() {
+Cylinder::Cylinder(float radius, float height, uint slices, uint copies) : Geometry() {
     // Top cap.
     for (uint i = 0; i < slices; i++) {
         const float __a = 2.f * (float(i) / slices);
@@ -27,4 +27,20 @@ Cylinder::Cylinder(float radius, float height, uint slices) : Geometry() {
     }
 
     for (const auto &vertex : Vertices) Normals.push_back(glm::normalize(glm::vec3{vertex.x, 0, vertex.z}));
+    if (copies <= 1) return;
+
+    const uint num_vertices = Vertices.size(), num_indices = Indices.size();
+    VertexCopies.reserve(num_vertices * copies);
+    for (uint copy = 0; copy < copies; copy++) {
+        for (uint i = 0; i < num_vertices; i++) {
+            if (copy > 0) {
+                Vertices.push_back(Vertices[i]);
+                Normals.push_back(Normals[i]);
+            }
+            VertexCopies.push_back(float(copy));
+        }
+        if (copy > 0) {
+            for (uint i = 0; i < num_indices; i++) Indices.push_back(Indices[i] + copy * num_vertices);
+        }
+    }
 }
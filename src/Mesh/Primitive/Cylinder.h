@@ -2,6 +2,8 @@
 
 #include "Mesh/Geometry.h"
 
+// Centered on the origin, along the y axis.
+// With `copies > 1`, the vertices and indices are repeated, tagged with their copy in `VertexCopies` (e.g. for multi-order bonds).
 struct Cylinder : Geometry {
-    Cylinder(float radius = 0.1, float height = 1, uint slices = 32);
+    Cylinder(float radius = 0.1, float height = 1, uint slices = 32, uint copies = 1);
 };
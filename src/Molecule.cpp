@@ -1,8 +1,9 @@
 #include "Molecule.h"
 
-#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <format>
 #include <iostream>
-#include <sstream>
 
 #define IMGUI_DEFINE_MATH_OPERATORS
 #include "imgui.h"
@@ -10,80 +11,79 @@
 
 #include "DatasetConfig.h"
 #include "Mesh/Primitive/Sphere.h"
+#include "MoleculePrimitives.h"
+#include "Trace.h"
+#include "WorkerPool.h"
 
 static const QM9WithH DatasetConfig;
 
 Molecule::Molecule(const fs::path &xyz_file_path) : XyzFilePath(xyz_file_path) {
-    std::ifstream xyz_file(xyz_file_path);
-    if (!xyz_file.is_open()) {
-        std::cerr << "Failed to open " << xyz_file_path << std::endl;
-        return;
-    }
+    Trace::Scope trace{"Load molecule", "load"};
+    auto data = ReadXyzFile(xyz_file_path);
+    if (!data) return;
 
-    std::string line;
-    // First line has the number of molecules.
-    std::getline(xyz_file, line);
-    const uint expected_num_atoms = std::stoi(line);
-    // Second line is empty.
-    std::getline(xyz_file, line);
+    Data = std::move(*data);
+    Init();
+}
+
+Molecule::Molecule(MoleculeData &&data, const fs::path &name) : XyzFilePath(name), Data(std::move(data)) {
+    Init();
+}
+
+void Molecule::Init() {
+    if (Data.Bonds.empty()) Data.Bonds = FindBonds(Data);
 
-    AtomMesh.Generate();
     AtomMesh.ClearInstances();
-    AtomTypes.clear();
-    uint atom_index = 0;
-    while (std::getline(xyz_file, line)) {
-        std::istringstream iss(line);
-        std::string atom_name; // 'H', 'C', 'N', 'O', 'F'
-        glm::vec3 position;
-        iss >> atom_name >> position.x >> position.y >> position.z;
-
-        const uint atom_type = DatasetConfig.AtomEncoder.at(atom_name);
-        AtomTypes.emplace_back(atom_type);
+    for (uint atom_index = 0; atom_index < Data.NumAtoms(); atom_index++) {
+        glm::mat4 transform = glm::scale(glm::translate(Identity, GetPlacedPosition(atom_index)), glm::vec3{GetAtomRadius(atom_index)});
+        SetElements(transform, Data.Types[atom_index]);
         AtomMesh.AddInstance();
-        AtomMesh.SetPosition(atom_index, position);
-        AtomMesh.SetScale(atom_index, GetAtomRadius(atom_index));
-        AtomMesh.SetColor(atom_index, DatasetConfig.ColorForAtom.at(atom_type));
-        atom_index++;
-    }
-
-    const uint num_atoms = AtomMesh.NumInstances();
-    if (num_atoms != expected_num_atoms) {
-        std::cerr << "Expected " << expected_num_atoms << " atoms, but found " << AtomMesh.NumInstances() << std::endl;
+        AtomMesh.SetTransform(atom_index, transform);
+        AtomMesh.SetColor(atom_index, GetAtomColor(atom_index));
     }
 
-    BondMesh.Generate();
+    BondSides = FindBondSides(Data);
     BondMesh.ClearInstances();
-    uint bond_index = 0;
-    for (uint i = 0; i < num_atoms; i++) {
-        for (uint j = 0; j < i; j++) {
-            const auto p1 = AtomMesh.GetPosition(i);
-            const auto p2 = AtomMesh.GetPosition(j);
-            const auto dist = glm::distance(p1, p2);
-            const auto bond_order = GetBondOrder(
-                DatasetConfig.AtomDecoder[AtomTypes[i]],
-                DatasetConfig.AtomDecoder[AtomTypes[j]],
-                dist
-            );
-            if (bond_order > 0) {
-                const auto midpoint = (p1 + p2) / 2.0f;
-                const auto direction = glm::normalize(p2 - p1);
-                // `quatLookAt` assumes the forward direction is -Z, so we need to rotate the result by 90 degrees.
-                const glm::quat rotation = glm::quatLookAt(direction, Up) * glm::angleAxis(float(M_PI / 2), glm::vec3{1, 0, 0});
-                const glm::mat4 transform = glm::scale(glm::translate(Identity, midpoint) * glm::mat4_cast(rotation), {1, dist, 1});
-                BondMesh.AddInstance();
-                BondMesh.SetTransform(bond_index, transform);
-                bond_index++;
-            }
-        }
-    }
+    for (uint bond_index = 0; bond_index < Data.Bonds.size(); bond_index++) BondMesh.AddInstance();
+    SetBondRadius(BondRadius);
+}
+
+glm::mat4 Molecule::BondTransform(const glm::vec3 &p1, const glm::vec3 &p2, float radius, uint order, const glm::vec3 &side) {
+    const auto dist = glm::distance(p1, p2);
+    const auto midpoint = (p1 + p2) / 2.0f;
+    // The cylinder's y axis spans the bond. Its x axis is the side direction, along which multi-order bond copies are spread.
+    const auto y = glm::normalize(p2 - p1);
+    const auto x = side == glm::vec3{0} ? BondNormal(y) : side;
+    const auto z = glm::cross(x, y);
+    return {
+        glm::vec4{x * radius, float(order)}, // Bond order in the metadata row (see `transform_vertex.glsl`).
+        glm::vec4{y * dist, 0},
+        glm::vec4{z * radius, 0},
+        glm::vec4{midpoint, 1},
+    };
+}
+
+// Element type + 1 of each atom, in base 64, so 0 means no atom.
+void Molecule::SetElements(glm::mat4 &transform, uint8_t type) { transform[2][3] = float(type + 1); }
+void Molecule::SetElements(glm::mat4 &transform, uint8_t type_a, uint8_t type_b) { transform[2][3] = float(type_a + 1 + (type_b + 1) * 64); }
+
+glm::vec4 Molecule::GetAtomColor(uint atom_index) const { return DatasetConfig.ColorForAtom.at(Data.Types[atom_index]); }
+
+MemoryUsage Molecule::GetMemoryUsage() const {
+    MemoryUsage usage = AtomMesh.GetMemoryUsage();
+    usage += BondMesh.GetMemoryUsage();
+    usage.AddCpu(MemoryCategory::ParseBuffers, Data.GetAllocatedBytes());
+    usage.AddCpu(MemoryCategory::Instances, BondSides.capacity() * sizeof(glm::vec3));
+    return usage;
 }
 
-Molecule::~Molecule() {
-    AtomMesh.Delete();
-    BondMesh.Delete();
+MemoryUsage Molecule::GetSharedGeometryMemoryUsage() {
+    MemoryUsage usage = AtomGeometry->GetMemoryUsage();
+    usage += BondGeometry->GetMemoryUsage();
+    return usage;
 }
 
-float Molecule::GetAtomRadius(uint atom_index) const { return DatasetConfig.RadiusForAtom[AtomTypes[atom_index]]; }
+float Molecule::GetAtomRadius(uint atom_index) const { return DatasetConfig.RadiusForAtom[Data.Types[atom_index]]; }
 
 void Molecule::SetAtomScale(float scale) {
     for (uint atom_index = 0; atom_index < AtomMesh.NumInstances(); atom_index++) {
@@ -92,47 +92,125 @@ void Molecule::SetAtomScale(float scale) {
 }
 
 void Molecule::SetBondRadius(float radius) {
-    for (uint bond_index = 0; bond_index < BondMesh.NumInstances(); bond_index++) {
-        // Each bond may have arbitrary translation, rotation and y-scaling applied.
-        glm::vec3 scale, translation, skew;
-        glm::vec4 perspective;
-        glm::quat rotation;
-        if (glm::decompose(BondMesh.GetTransform(bond_index), scale, rotation, translation, skew, perspective)) {
-            scale.x = scale.z = radius;
-            BondMesh.SetTransform(bond_index, glm::scale(glm::translate(Identity, translation) * glm::mat4_cast(rotation), scale));
-        }
+    BondRadius = radius;
+    for (uint bond_index = 0; bond_index < Data.Bonds.size(); bond_index++) {
+        const auto &bond = Data.Bonds[bond_index];
+        glm::mat4 transform = BondTransform(GetPlacedPosition(bond.A), GetPlacedPosition(bond.B), radius, bond.Order, Placement.Rotation * BondSides[bond_index]);
+        SetElements(transform, Data.Types[bond.A], Data.Types[bond.B]);
+        BondMesh.SetTransform(bond_index, transform);
     }
 }
 
-MoleculeChain::MoleculeChain(const fs::path &xyz_files_path, ::Scene *scene) : Scene(scene) {
-    if (!fs::is_directory(xyz_files_path)) {
-        Molecules.emplace_back(xyz_files_path);
-    } else {
-        std::vector<fs::path> paths;
-        for (const auto &entry : fs::directory_iterator(xyz_files_path)) {
-            const auto &path = entry.path();
-            if (path.extension() == ".txt") paths.push_back(path);
-        }
-        std::sort(paths.begin(), paths.end()); // Alphabetical order.
+void Molecule::SetPlacement(const RigidTransform &placement) {
+    if (placement == Placement) return;
 
-        // `Molecule`'s move semantics don't currently work with OpenGL state well, so use `reserve` to avoid reallocations.
-        Molecules.reserve(paths.size());
-        for (const auto &path : paths) Molecules.emplace_back(path);
+    Placement = placement;
+    for (uint atom_index = 0; atom_index < AtomMesh.NumInstances(); atom_index++) AtomMesh.SetPosition(atom_index, GetPlacedPosition(atom_index));
+    SetBondRadius(BondRadius);
+}
 
-        if (Molecules.empty()) {
+MoleculeChain::MoleculeChain(const fs::path &xyz_files_path, ::Scene *scene, uint viewport) : Scene(scene), Viewport(viewport) {
+    Trace::Scope trace{"Load chain", "load"};
+    if (!fs::is_directory(xyz_files_path)) {
+        Analysis.Add(Molecules.emplace_back(std::in_place, xyz_files_path)->Data);
+    } else {
+        // The index lists the directory's molecule files in alphabetical order, and only parses files it hasn't seen before.
+        // It also has every file's metrics, so only the frames that get shown are parsed again (see `LoadMolecule`).
+        Index = DirectoryIndex::Open(xyz_files_path);
+        if (Index->Entries.empty()) {
             std::cerr << "No .txt files found in directory: " << xyz_files_path << std::endl;
             return;
         }
+
+        Molecules.resize(Index->Entries.size());
+        for (const auto &entry : Index->Entries) Analysis.Add(entry.GetMetrics());
     }
 
     SetMoleculeIndex(Molecules.size() - 1); // Default to the final molecule in the chain.
 }
 
+MoleculeChain::MoleculeChain(::Scene *scene) : Scene(scene) {}
+
 MoleculeChain::~MoleculeChain() {
+    if (Realignment) Realignment->Cancelled = true; // The worker stops at its next frame.
+    if (Grid) {
+        Scene->RemoveMesh(&Grid->AtomMesh);
+        Scene->RemoveMesh(&Grid->BondMesh);
+        Scene->GridColumns = Scene->GridRows = 1;
+        Scene->GridSpacing = 0;
+    }
     for (auto &molecule : Molecules) {
-        Scene->RemoveMesh(&molecule.AtomMesh);
-        Scene->RemoveMesh(&molecule.BondMesh);
+        if (!molecule) continue;
+        Scene->RemoveMesh(&molecule->AtomMesh);
+        Scene->RemoveMesh(&molecule->BondMesh);
+    }
+}
+
+void MoleculeChain::Append(MoleculeData &&data, const fs::path &name) {
+    const bool follow = Molecules.empty() || (!AnimateChain && MoleculeIndex == int(Molecules.size() - 1));
+    // If appending reallocates, the scene would be left pointing at the shown molecule's old meshes.
+    const bool reshow = !Grid && !Molecules.empty() && Molecules.size() == Molecules.capacity();
+    if (reshow) ShowMeshes(false);
+    Analysis.Add(Molecules.emplace_back(std::in_place, std::move(data), name)->Data);
+    if (Grid) SetGridView(true);
+    else if (follow) SetMoleculeIndex(Molecules.size() - 1);
+    else if (reshow) ShowMeshes(true);
+}
+
+std::string MoleculeChain::GetName() const {
+    if (Index) return Index->Directory.filename().string();
+    if (Molecules.size() == 1) return Molecules[0]->XyzFilePath.filename().string();
+    return "Stream";
+}
+
+MemoryUsage MoleculeChain::MemoryReport::Total() const {
+    MemoryUsage total = AtomMeshes;
+    total += BondMeshes;
+    total += GridMeshes;
+    total += ParseBuffers;
+    total += Analysis;
+    return total;
+}
+
+MoleculeChain::MemoryReport MoleculeChain::GetMemoryReport() const {
+    MemoryReport report;
+    for (const auto &molecule : Molecules) {
+        if (!molecule) continue;
+        report.AtomMeshes += molecule->AtomMesh.GetMemoryUsage();
+        report.BondMeshes += molecule->BondMesh.GetMemoryUsage();
+        report.ParseBuffers.AddCpu(MemoryCategory::ParseBuffers, molecule->Data.GetAllocatedBytes());
     }
+    if (Grid) {
+        report.GridMeshes += Grid->AtomMesh.GetMemoryUsage();
+        report.GridMeshes += Grid->BondMesh.GetMemoryUsage();
+    }
+    if (Index) report.ParseBuffers += Index->GetMemoryUsage();
+    report.Analysis = Analysis.GetMemoryUsage();
+    report.Analysis.AddCpu(MemoryCategory::Analysis, Alignment.GetAllocatedBytes());
+    if (Realignment) {
+        report.Analysis.AddCpu(MemoryCategory::Analysis, Realignment->Frames.capacity() * sizeof(std::optional<MoleculeData>));
+        for (const auto &frame : Realignment->Frames) {
+            if (frame) report.Analysis.AddCpu(MemoryCategory::Analysis, frame->GetAllocatedBytes());
+        }
+    }
+    report.Analysis.AddCpu(MemoryCategory::Analysis, Plots.Metrics.capacity() * sizeof(std::optional<FrameMetrics>) +
+                               (Plots.Bonds.capacity() + Plots.StablePercent.capacity() + Plots.LargestFragment.capacity() + Plots.RadiusOfGyration.capacity()) * sizeof(float));
+    return report;
+}
+
+void MoleculeChain::SyncTo(const MoleculeChain &leader) {
+    if (Molecules.empty() || leader.Molecules.empty()) return;
+
+    const bool settings_changed = AtomScale != leader.AtomScale || BondRadius != leader.BondRadius || ShowBonds != leader.ShowBonds ||
+        AlignFrames != leader.AlignFrames;
+    AtomScale = leader.AtomScale;
+    BondRadius = leader.BondRadius;
+    ShowBonds = leader.ShowBonds;
+    AlignFrames = leader.AlignFrames;
+    const int index = leader.Molecules.size() == 1 ?
+        Molecules.size() - 1 :
+        std::lround(float(leader.MoleculeIndex) * (Molecules.size() - 1) / (leader.Molecules.size() - 1));
+    if (settings_changed || index != MoleculeIndex) SetMoleculeIndex(index);
 }
 
 using namespace ImGui;
@@ -145,21 +223,70 @@ void MoleculeChain::RenderConfig() {
 
     MoleculeIndex = std::clamp(MoleculeIndex, 0, int(Molecules.size() - 1));
 
-    std::string file_name = Molecules[MoleculeIndex].XyzFilePath.filename().string();
+    std::string file_name = Molecules[MoleculeIndex]->XyzFilePath.filename().string();
     Text("Current molecule:\n\t%s", file_name.c_str());
+    if (Index && MoleculeIndex < int(Index->Entries.size())) {
+        const auto &entry = Index->Entries[MoleculeIndex];
+        Text("\t%s: %u atoms, %u bonds", entry.Formula.c_str(), entry.NumAtoms, entry.NumBonds);
+    }
 
-    if (Checkbox("Show bonds", &ShowBonds)) SetMoleculeIndex(MoleculeIndex);
+    if (Checkbox("Show bonds", &ShowBonds)) {
+        if (Grid) SetGridView(true);
+        else SetMoleculeIndex(MoleculeIndex);
+    }
     if (!ShowBonds) BeginDisabled();
     if (SliderFloat("Bond radius", &BondRadius, .01f, 4.f, "%.3f", ImGuiSliderFlags_Logarithmic)) {
-        Molecules[MoleculeIndex].SetBondRadius(BondRadius);
+        if (Grid) SetGridView(true);
+        else Molecules[MoleculeIndex]->SetBondRadius(BondRadius);
     }
     if (!ShowBonds) EndDisabled();
     if (SliderFloat("Atom scale", &AtomScale, .01f, 4.f, "%.3f", ImGuiSliderFlags_Logarithmic)) {
-        Molecules[MoleculeIndex].SetAtomScale(AtomScale);
+        if (Grid) SetGridView(true);
+        else Molecules[MoleculeIndex]->SetAtomScale(AtomScale);
     }
 
+    // Shared by every molecule in the scene, and applied by the shaders, so no instances change.
+    SeparatorText("Elements");
+    auto &elements = Scene->Elements;
+    for (uint type = 0; type < DatasetConfig.AtomDecoder.size() && type < ElementMask::MaxElements; type++) {
+        PushID(type);
+        const uint bit = 1u << type;
+        bool show = !(elements.Hidden & bit);
+        if (Checkbox(DatasetConfig.AtomDecoder[type].c_str(), &show)) elements.Hidden ^= bit;
+        SameLine(GetFontSize() * 4);
+        CheckboxFlags("Highlight", &elements.Highlighted, bit);
+        PopID();
+    }
+    Separator();
+
+    if (Molecules.size() > 1) {
+        bool grid_view = bool(Grid);
+        if (Checkbox("Grid view", &grid_view)) SetGridView(grid_view);
+        if (Grid) {
+            SameLine();
+            TextDisabled("(%u x %u)", Grid->Columns, Grid->Rows);
+        }
+    }
+
+    if (Grid) BeginDisabled();
     Checkbox("Animate chain", &AnimateChain);
     SliderFloat("Animation speed", &AnimationSpeed, 0.00001f, 0.01f);
+    if (Molecules.size() > 1) {
+        if (Checkbox("Align frames", &AlignFrames)) {
+            CameraFitRadius = -1;
+            SetMoleculeIndex(MoleculeIndex);
+        }
+        if (IsItemHovered()) SetTooltip("Rigidly align every frame onto the final frame (Kabsch), for a steady view during playback.");
+        if (AlignFrames) {
+            SameLine();
+            const float rmsd = MoleculeIndex < int(Alignment.Frames.size()) ? Alignment.Frames[MoleculeIndex].Rmsd : -1;
+            if (rmsd >= 0 && Alignment.Reference == Molecules.size() - 1) TextDisabled("RMSD to final: %.3f", rmsd);
+            else if (rmsd >= 0) TextDisabled("RMSD to frame %u: %.3f", Alignment.Reference, rmsd);
+            else if (IsAligning()) TextDisabled("Aligning...");
+            else TextDisabled("Not aligned");
+            if (Checkbox("Fit camera to whole chain", &FitWholeChain)) SetMoleculeIndex(MoleculeIndex);
+        }
+    }
 
     if (Molecules.size() > 1) {
         int new_molecule_index = MoleculeIndex;
@@ -167,6 +294,11 @@ void MoleculeChain::RenderConfig() {
             AnimateChain = false;
             SetMoleculeIndex(new_molecule_index);
         }
+        RenderAnalysis();
+    }
+    if (Grid) {
+        EndDisabled();
+        return;
     }
 
     if (AnimateChain) {
@@ -176,17 +308,304 @@ void MoleculeChain::RenderConfig() {
     }
 }
 
+// One metric over all frames, with the shown frame marked. Returns the clicked frame, if any.
+static std::optional<uint> PlotFrames(const char *id, const std::vector<float> &values, uint frame, const std::string &overlay) {
+    static const float Height = 40;
+    PlotLines(id, values.data(), values.size(), 0, overlay.c_str(), FLT_MAX, FLT_MAX, {GetContentRegionAvail().x, Height});
+    if (values.size() < 2) return {};
+
+    // Values span the plot's frame, inside its padding.
+    const auto &padding = GetStyle().FramePadding;
+    const ImVec2 min = GetItemRectMin() + padding, max = GetItemRectMax() - padding;
+    const float x = min.x + (max.x - min.x) * frame / (values.size() - 1);
+    GetWindowDrawList()->AddLine({x, min.y}, {x, max.y}, GetColorU32(ImGuiCol_PlotLinesHovered));
+    if (!IsItemClicked()) return {};
+
+    const float t = std::clamp((GetMousePos().x - min.x) / (max.x - min.x), 0.f, 1.f);
+    return uint(std::lround(t * (values.size() - 1)));
+}
+
+void MoleculeChain::RenderAnalysis() {
+    // Frames not analyzed yet are plotted as zero.
+    const uint version = Analysis.GetVersion(), num_frames = Analysis.NumFrames();
+    if (version != Plots.Version || num_frames != Plots.NumFrames) {
+        Plots.Version = version;
+        Plots.NumFrames = num_frames;
+        Plots.Metrics = Analysis.GetMetrics();
+        Plots.Bonds.assign(num_frames, 0);
+        Plots.StablePercent.assign(num_frames, 0);
+        Plots.LargestFragment.assign(num_frames, 0);
+        Plots.RadiusOfGyration.assign(num_frames, 0);
+        for (uint frame = 0; frame < Plots.Metrics.size() && frame < num_frames; frame++) {
+            const auto &metrics = Plots.Metrics[frame];
+            if (!metrics) continue;
+
+            Plots.Bonds[frame] = metrics->NumBonds;
+            Plots.StablePercent[frame] = metrics->NumAtoms > 0 ? 100.f * metrics->NumStableAtoms / metrics->NumAtoms : 0;
+            Plots.LargestFragment[frame] = metrics->LargestFragment;
+            Plots.RadiusOfGyration[frame] = metrics->RadiusOfGyration;
+        }
+    }
+    if (Plots.Metrics.empty()) return;
+
+    SeparatorText("Analysis");
+    if (Analysis.IsAnalyzing()) TextDisabled("Analyzing frames (%u of %u)...", Analysis.NumAnalyzed(), num_frames);
+
+    const uint frame = std::min(uint(MoleculeIndex), uint(Plots.Metrics.size() - 1));
+    const auto &current = Plots.Metrics[frame];
+    const auto overlay = [&](const char *name, const std::string &value) { return std::format("{}: {}", name, current ? value : "..."); };
+    std::optional<uint> clicked;
+    const auto plot = [&](const char *id, const std::vector<float> &values, const std::string &overlay) {
+        if (auto clicked_frame = PlotFrames(id, values, frame, overlay)) clicked = clicked_frame;
+    };
+    plot("##Bonds", Plots.Bonds, overlay("Bonds", current ? std::to_string(current->NumBonds) : ""));
+    plot("##Stable", Plots.StablePercent, overlay("Stable atoms", current ? std::format("{}/{}{}", current->NumStableAtoms, current->NumAtoms, current->IsStable() ? " (stable)" : "") : ""));
+    if (IsItemHovered()) SetTooltip("Atoms whose bond orders sum to their element's allowed valence, in percent.");
+    plot("##Fragment", Plots.LargestFragment, overlay("Largest fragment", current ? std::format("{} atoms", current->LargestFragment) : ""));
+    plot("##Gyration", Plots.RadiusOfGyration, overlay("Radius of gyration", current ? std::format("{:.2f}", current->RadiusOfGyration) : ""));
+    TextDisabled("Click a plot to show that frame.");
+
+    if (clicked && int(*clicked) != MoleculeIndex) {
+        AnimateChain = false;
+        SetMoleculeIndex(*clicked);
+    }
+}
+
 void MoleculeChain::SetMoleculeIndex(int index) {
     if (index < 0 || index >= int(Molecules.size())) return;
 
-    Scene->RemoveMesh(&Molecules[MoleculeIndex].AtomMesh);
-    Scene->RemoveMesh(&Molecules[MoleculeIndex].BondMesh);
+    Profiler::CpuZone zone{"MoleculeChain::SetMoleculeIndex"};
+
+    Select(std::nullopt);
+    ShowMeshes(false);
     MoleculeIndex = index;
-    auto &molecule = Molecules[MoleculeIndex];
+    auto &molecule = LoadMolecule(MoleculeIndex);
+    if (AlignFrames) UpdateAlignment();
+    molecule.SetPlacement(AlignFrames ? GetAlignedPlacement(MoleculeIndex) : RigidTransform{});
     molecule.SetAtomScale(AtomScale);
     molecule.SetBondRadius(BondRadius);
-    auto [bounds_min, bounds_max] = molecule.AtomMesh.ComputeBounds();
-    Scene->AddMesh(&molecule.AtomMesh);
-    if (ShowBonds) Scene->AddMesh(&molecule.BondMesh);
-    Scene->SetCameraDistance(glm::distance(bounds_min, bounds_max) * 2);
+    ShowMeshes(true);
+    FitCamera();
+}
+
+void MoleculeChain::FitCamera() {
+    if (Viewport != 0) return;
+
+    if (!AlignFrames) {
+        auto [bounds_min, bounds_max] = Molecules[MoleculeIndex]->Data.ComputeBounds();
+        Scene->SetCameraDistance(glm::distance(bounds_min, bounds_max) * 2);
+        return;
+    }
+    // Aligned frames share a bounding sphere, so the camera only moves when it grows.
+    const float radius = FitWholeChain ? std::max(Alignment.Radius, GetFrameAlignment(MoleculeIndex).Radius) : GetFrameAlignment(Molecules.size() - 1).Radius;
+    if (radius != CameraFitRadius) {
+        Scene->SetCameraDistance(radius * 4);
+        CameraFitRadius = radius;
+    }
+}
+
+void MoleculeChain::Update() {
+    if (Realignment && Realignment->Done) {
+        Alignment = std::move(Realignment->Result);
+        Realignment.reset();
+        if (AlignFrames && !Grid && !Molecules.empty()) {
+            Molecules[MoleculeIndex]->SetPlacement(GetAlignedPlacement(MoleculeIndex));
+            FitCamera();
+        }
+    }
+    if (AlignFrames) UpdateAlignment();
+}
+
+void MoleculeChain::UpdateAlignment() {
+    if (Molecules.empty() || Realignment) return;
+
+    const uint final_index = Molecules.size() - 1;
+    const bool realign = !Streaming && (Alignment.Frames.empty() ? Molecules.size() > 1 : Alignment.Reference != final_index);
+    if (realign) {
+        Profiler::CpuZone zone{"Start chain realignment"};
+        // Loaded frames are copied, since appending can move the molecules while the worker reads them.
+        // The rest are read by the worker, so realigning never parses the whole chain up front.
+        auto realignment = std::make_shared<PendingRealignment>();
+        realignment->Frames.reserve(Molecules.size());
+        for (const auto &molecule : Molecules) {
+            if (molecule) realignment->Frames.push_back(MoleculeData{molecule->Data.Types, molecule->Data.X, molecule->Data.Y, molecule->Data.Z, {}});
+            else realignment->Frames.emplace_back();
+        }
+        if (Index) {
+            for (uint i = 0; i < Molecules.size(); i++) realignment->Paths.push_back(Molecules[i] ? fs::path{} : Index->GetPath(i));
+        }
+        WorkerPool::Get().Submit([realignment] {
+            Trace::Scope trace{"Align chain", "load"};
+            const auto &frames = realignment->Frames;
+            const auto read_frame = [&](uint i) {
+                if (frames[i]) return *frames[i];
+                auto read = i < realignment->Paths.size() ? ReadXyzFile(realignment->Paths[i]) : std::nullopt;
+                return read ? std::move(*read) : MoleculeData{};
+            };
+            const uint final_index = frames.size() - 1;
+            const auto reference = read_frame(final_index);
+            auto result = StartAlignment(reference, final_index);
+            for (uint i = 0; i < final_index; i++) {
+                if (realignment->Cancelled) return;
+                result.Add(read_frame(i), reference);
+            }
+            result.Add(reference, reference);
+            realignment->Result = std::move(result);
+            realignment->Done = true;
+        });
+        if (Realignment) Realignment->Cancelled = true; // Superseded.
+        Realignment = std::move(realignment);
+        return;
+    }
+
+    // Frames appended since (e.g. streamed), each aligned once onto the same reference.
+    Profiler::CpuZone zone{"MoleculeChain::UpdateAlignment"};
+    if (Alignment.Frames.empty()) Alignment = StartAlignment(LoadMolecule(final_index).Data, final_index);
+    const auto &reference = LoadMolecule(Alignment.Reference).Data;
+    while (Alignment.Frames.size() < Molecules.size()) Alignment.Add(LoadMolecule(Alignment.Frames.size()).Data, reference);
+}
+
+FrameAlignment MoleculeChain::GetFrameAlignment(uint index) {
+    if (index < Alignment.Frames.size()) return Alignment.Frames[index];
+    // Before the first alignment, onto the final frame.
+    return AlignFrame(LoadMolecule(index).Data, LoadMolecule(Alignment.Frames.empty() ? Molecules.size() - 1 : Alignment.Reference).Data);
+}
+
+RigidTransform MoleculeChain::GetAlignedPlacement(uint index) {
+    auto placement = GetFrameAlignment(index).Transform;
+    placement.Translation -= Alignment.Frames.empty() ? ComputeCentroid(LoadMolecule(Molecules.size() - 1).Data) : Alignment.Center;
+    return placement;
+}
+
+Molecule &MoleculeChain::LoadMolecule(uint index) {
+    auto &molecule = Molecules[index];
+    if (!molecule) molecule.emplace(Index->GetPath(index)); // Only directory chains have unloaded molecules.
+    return *molecule;
+}
+
+void MoleculeChain::ShowMeshes(bool show) {
+    if (!Molecules[MoleculeIndex]) return; // Nothing shown yet.
+
+    auto &molecule = *Molecules[MoleculeIndex];
+    if (!show) {
+        Scene->RemoveMesh(&molecule.AtomMesh);
+        Scene->RemoveMesh(&molecule.BondMesh);
+        return;
+    }
+    Scene->AddMesh(&molecule.AtomMesh, Viewport);
+    if (ShowBonds) Scene->AddMesh(&molecule.BondMesh, Viewport);
+}
+
+void MoleculeChain::SetGridView(bool grid_view) {
+    if (!Molecules.empty()) Select(std::nullopt);
+    if (Grid) {
+        Scene->RemoveMesh(&Grid->AtomMesh);
+        Scene->RemoveMesh(&Grid->BondMesh);
+        Grid.reset();
+    }
+    if (Molecules.empty()) return;
+
+    ShowMeshes(false);
+    if (!grid_view) {
+        Scene->GridColumns = Scene->GridRows = 1;
+        Scene->GridSpacing = 0;
+        SetMoleculeIndex(MoleculeIndex);
+        return;
+    }
+
+    std::vector<const Molecule *> molecules;
+    molecules.reserve(Molecules.size());
+    for (uint i = 0; i < Molecules.size(); i++) molecules.push_back(&LoadMolecule(i));
+    Grid = std::make_unique<MoleculeGrid>(molecules, AtomScale, BondRadius);
+    Scene->AddMesh(&Grid->AtomMesh);
+    if (ShowBonds) Scene->AddMesh(&Grid->BondMesh);
+    Scene->GridColumns = Grid->Columns;
+    Scene->GridRows = Grid->Rows;
+    Scene->GridSpacing = Grid->Spacing;
+    Scene->SetCameraDistance(Grid->Spacing * std::max(Grid->Columns, Grid->Rows) * 1.5f);
+    CameraFitRadius = -1; // Refit when leaving grid view.
+}
+
+void MoleculeChain::Select(std::optional<PickedItem> item) {
+    if (item == Selection) return;
+
+    auto &molecule = *Molecules[MoleculeIndex];
+    const auto set_highlight = [&](const PickedItem &picked, bool highlight) {
+        if (picked.IsBond) {
+            const glm::vec4 color{1};
+            molecule.BondMesh.UpdateColor(picked.Index, highlight ? Highlight(color) : color);
+        } else {
+            const auto color = molecule.GetAtomColor(picked.Index);
+            molecule.AtomMesh.UpdateColor(picked.Index, highlight ? Highlight(color) : color);
+        }
+    };
+    if (Selection) set_highlight(*Selection, false);
+    Selection = item;
+    if (Selection) set_highlight(*Selection, true);
+}
+
+void MoleculeChain::UpdatePicking() {
+    if (Molecules.empty() || Grid || !Scene->MouseRay || Scene->MouseRay->Viewport != Viewport) return;
+
+    const auto &molecule = *Molecules[MoleculeIndex];
+    const BvhKey key{MoleculeIndex, AtomScale, BondRadius, ShowBonds, Scene->Elements.Hidden};
+    if (key != BvhBuiltFor) {
+        Profiler::CpuZone zone{"Picking BVH update"};
+        auto primitives = GetMoleculePrimitives(molecule.Data, AtomScale, BondRadius, ShowBonds, Scene->Elements);
+        if (!Bvh.Refit(primitives)) Bvh.Build(primitives);
+        BvhBuiltFor = key;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    // Primitives are in the molecule's own coordinates, so the ray is moved into them.
+    const auto &placement = molecule.GetPlacement();
+    const auto &world_ray = Scene->MouseRay->WorldRay;
+    const auto hit = Bvh.Intersect({placement.ApplyInverse(world_ray.Origin), glm::transpose(placement.Rotation) * world_ray.Direction});
+    const float pick_us = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    std::optional<PickedItem> picked;
+    if (hit) picked = hit->Id < molecule.Data.NumAtoms() ? PickedItem{false, hit->Id} : PickedItem{true, hit->Id - molecule.Data.NumAtoms()};
+    if (picked) RenderPickedTooltip(*picked, pick_us);
+    if (Scene->MouseRay->Clicked) Select(picked);
+}
+
+bool MoleculeChain::AddToRayTracer(RayTracer::Input &input) const {
+    if (!CanRayTrace()) return false;
+
+    const auto &molecule = *Molecules[MoleculeIndex];
+    const size_t first = input.Primitives.size();
+    input.AddMolecule(molecule.Data, AtomScale, BondRadius, ShowBonds, Scene->Elements);
+    const auto &placement = molecule.GetPlacement();
+    for (size_t i = first; i < input.Primitives.size(); i++) {
+        auto &primitive = input.Primitives[i];
+        primitive.A = placement.Apply(primitive.A);
+        primitive.B = placement.Apply(primitive.B);
+    }
+    return true;
+}
+
+static const char *BondOrderNames[]{"", "single", "double", "triple"};
+
+void MoleculeChain::RenderPickedTooltip(const PickedItem &item, float pick_us) const {
+    const auto &data = Molecules[MoleculeIndex]->Data;
+    const auto atom_label = [&](uint atom_index) { return std::format("{}{}", DatasetConfig.AtomDecoder.at(data.Types[atom_index]), atom_index); };
+    BeginTooltip();
+    if (item.IsBond) {
+        const auto &bond = data.Bonds[item.Index];
+        Text("Bond %u: %s-%s", item.Index, atom_label(bond.B).c_str(), atom_label(bond.A).c_str());
+        Text("%s, %.3f", BondOrderNames[std::min<uint>(bond.Order, 3)], glm::distance(data.GetPosition(bond.A), data.GetPosition(bond.B)));
+    } else {
+        const auto position = data.GetPosition(item.Index);
+        Text("Atom %u: %s", item.Index, DatasetConfig.AtomDecoder.at(data.Types[item.Index]).c_str());
+        Text("Position: (%.3f, %.3f, %.3f)", position.x, position.y, position.z);
+        std::string bonds;
+        for (const auto &bond : data.Bonds) {
+            if (bond.A != item.Index && bond.B != item.Index) continue;
+            if (!bonds.empty()) bonds += ", ";
+            bonds += std::format("{} ({})", atom_label(bond.A == item.Index ? bond.B : bond.A), BondOrderNames[std::min<uint>(bond.Order, 3)]);
+        }
+        Text("Bonds: %s", bonds.empty() ? "none" : bonds.c_str());
+    }
+    TextDisabled("Picked in %.1f us (%u primitives). Click to select.", pick_us, Bvh.NumPrimitives());
+    EndTooltip();
 }
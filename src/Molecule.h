@@ -1,7 +1,17 @@
 #pragma once
 
+#include <atomic>
 #include <filesystem>
+#include <memory>
+#include <vector>
 
+#include "ChainAlignment.h"
+#include "ChainAnalysis.h"
+#include "DirectoryIndex.h"
+#include "MoleculeData.h"
+#include "MoleculeGrid.h"
+#include "Picking.h"
+#include "RayTracer.h"
 #include "Mesh/Primitive/Cylinder.h"
 #include "Mesh/Primitive/Sphere.h"
 
@@ -9,33 +19,166 @@
 
 namespace fs = std::filesystem;
 
+// Renders a `MoleculeData` as sphere (atom) and cylinder (bond) mesh instances, built from the data.
 struct Molecule {
     Molecule(const fs::path &xyz_file_path);
-    ~Molecule();
+    // `name` is shown in place of the file path. Bonds are found if the data doesn't have any yet.
+    Molecule(MoleculeData &&, const fs::path &name);
 
     float GetAtomRadius(uint atom_index) const;
     void SetAtomScale(float scale);
     void SetBondRadius(float scale);
+    // Draw the molecule with its atom positions transformed (e.g. aligned with the rest of its chain). Identity by default.
+    void SetPlacement(const RigidTransform &);
+    const RigidTransform &GetPlacement() const { return Placement; }
+    glm::vec3 GetPlacedPosition(uint atom_index) const { return Placement.Apply(Data.GetPosition(atom_index)); }
 
-    Mesh AtomMesh{Sphere{}}; // Single sphere mesh with an instance per atom.
-    Mesh BondMesh{Cylinder{}}; // Single cylinder mesh with an instance per bond.
+    // Excludes the shared atom and bond geometry (see `GetSharedGeometryMemoryUsage`).
+    MemoryUsage GetMemoryUsage() const;
+    static MemoryUsage GetSharedGeometryMemoryUsage();
+
+    // Transform of the shared bond cylinder, spanning two atom positions.
+    // The bond order is stored in the transform's metadata row, and its copies are spread along the unit `side` (see `FindBondSides`).
+    static glm::mat4 BondTransform(const glm::vec3 &p1, const glm::vec3 &p2, float radius, uint order = 1, const glm::vec3 &side = glm::vec3{0});
+    // Tag an atom or bond instance transform with its element types, for `Scene::Elements` masking (see `transform_vertex.glsl`).
+    static void SetElements(glm::mat4 &transform, uint8_t type);
+    static void SetElements(glm::mat4 &transform, uint8_t type_a, uint8_t type_b);
+
+    glm::vec4 GetAtomColor(uint atom_index) const; // Unhighlighted.
+
+    // All molecules share the same sphere and cylinder geometry buffers.
+    inline static const std::shared_ptr<Geometry> AtomGeometry = std::make_shared<Geometry>(Sphere{}), BondGeometry = std::make_shared<Geometry>(Cylinder{0.1, 1, 32, 3});
+
+    Mesh AtomMesh{AtomGeometry}; // Single sphere mesh with an instance per atom.
+    Mesh BondMesh{BondGeometry}; // Single cylinder mesh with an instance per bond. Its three copies are for double and triple bonds.
 
     fs::path XyzFilePath;
+    MoleculeData Data;
+    std::vector<glm::vec3> BondSides; // Per bond, see `FindBondSides`.
+
+private:
+    void Init();
 
-    std::vector<uint> AtomTypes;
+    RigidTransform Placement;
+    float BondRadius{1};
 };
 
 struct MoleculeChain {
-    MoleculeChain(const fs::path &xyz_files_path, ::Scene *);
+    // Molecules are shown in the given scene viewport. Only the chain in viewport 0 moves the camera.
+    MoleculeChain(const fs::path &xyz_files_path, ::Scene *, uint viewport = 0);
+    MoleculeChain(::Scene *); // Empty chain, e.g. to be filled by a `FrameStream`.
     ~MoleculeChain();
 
     void RenderConfig();
 
-    std::vector<Molecule> Molecules;
+    // Hover tooltip and click selection for the shown molecule, from the scene's mouse ray.
+    // Call inside the scene window, after `Scene::Render`. Not available in grid view.
+    void UpdatePicking();
+
+    // Add the shown molecule, with the current display settings, to an offline render (see `ImageExport`). Not available in grid view.
+    bool CanRayTrace() const { return !Molecules.empty() && !Grid; }
+    bool AddToRayTracer(RayTracer::Input &) const; // Returns false if `!CanRayTrace()`.
+
+    std::string GetName() const;
+    bool IsAnimating() const { return AnimateChain && !Grid; }
+    bool IsAnalyzing() const { return Analysis.IsAnalyzing(); }
+    bool IsAligning() const { return bool(Realignment); }
+
+    // Call every frame. Applies a finished whole-chain realignment, and starts one if the reference frame is out of date.
+    void Update();
+
+    // Memory used by the chain, by kind of owner. Excludes the geometry shared by all molecules.
+    struct MemoryReport {
+        MemoryUsage AtomMeshes, BondMeshes, GridMeshes, ParseBuffers, Analysis;
+        MemoryUsage Total() const;
+    };
+    MemoryReport GetMemoryReport() const;
+
+    // Follow another chain's display settings and frame.
+    // Frames are mapped proportionally, so chains of different lengths stay in step and their final frames line up.
+    void SyncTo(const MoleculeChain &);
+
+    // Add a molecule to the end of the chain.
+    // If the last molecule is currently shown (and the chain isn't animating), the new molecule is shown instead.
+    void Append(MoleculeData &&, const fs::path &name);
+    // While streaming, appended frames are aligned onto a fixed reference frame, each once, as they arrive.
+    // When streaming stops, the whole chain is realigned onto its final frame.
+    void SetStreaming(bool streaming) { Streaming = streaming; }
+
+    // Show the molecule at `index` (ignored if out of range), and fit the camera to it if this chain is in viewport 0.
+    void SetMoleculeIndex(int index);
+
+    // Molecules own their GL objects and are movable, so they can be built elsewhere and moved in.
+    // Appending may relocate them, though, so the scene's mesh pointers are refreshed whenever it does (see `Append`).
+    // Frames of a directory chain are only parsed when first shown (or for grid view), so opening one only reads its index.
+    // The shown molecule is always loaded.
+    std::vector<std::optional<Molecule>> Molecules;
+    std::optional<DirectoryIndex> Index; // Only for chains loaded from a directory. Entries correspond to `Molecules`.
     ::Scene *Scene;
+    const uint Viewport{0};
 
 private:
-    void SetMoleculeIndex(int index);
+    Molecule &LoadMolecule(uint index); // Parsed from its file if it isn't loaded yet.
+    void SetGridView(bool); // Also rebuilds the grid when already in grid view.
+    void UpdateAlignment(); // Align frames added since the last alignment, or start realigning the whole chain.
+    FrameAlignment GetFrameAlignment(uint index); // Aligned on demand if it isn't yet.
+    void FitCamera(); // To the shown molecule, or the aligned chain's extent. Only for viewport 0.
+    RigidTransform GetAlignedPlacement(uint index); // Aligned onto the reference frame, with the chain centered on the origin.
+    void ShowMeshes(bool show); // Add or remove the current molecule's meshes to/from the scene.
+
+    std::unique_ptr<MoleculeGrid> Grid; // Set when showing all molecules side by side.
+
+    // Per-frame validity metrics, plotted under the molecule slider. Every frame is added as it's loaded or appended.
+    ChainAnalysis Analysis;
+    // Plotted values, copied from `Analysis` whenever it has new results.
+    struct AnalysisPlots {
+        uint Version{0}, NumFrames{0};
+        std::vector<std::optional<FrameMetrics>> Metrics;
+        std::vector<float> Bonds, StablePercent, LargestFragment, RadiusOfGyration;
+    };
+    AnalysisPlots Plots;
+    void RenderAnalysis();
+
+    // Frames rigidly aligned onto a reference frame, so playback doesn't tumble and the camera doesn't refit on every switch.
+    // The reference is the final frame, except while streaming, when it stays fixed so each new frame is only aligned once.
+    // Aligning the whole chain onto a new reference runs on the worker pool, on a copy of its atoms, and is swapped in by `Update`.
+    // Until then, frames not in `Alignment` are aligned on demand when shown.
+    ChainAlignment Alignment;
+    struct PendingRealignment {
+        std::vector<std::optional<MoleculeData>> Frames; // Atom types and positions of loaded frames.
+        std::vector<fs::path> Paths; // Per frame. Frames that aren't loaded are read from these by the worker, one at a time.
+        ChainAlignment Result;
+        std::atomic<bool> Done{false};
+        std::atomic<bool> Cancelled{false}; // Set when the chain no longer wants the result, e.g. when it's closed.
+    };
+    std::shared_ptr<PendingRealignment> Realignment;
+    bool Streaming{false};
+    bool AlignFrames{true};
+    bool FitWholeChain{false}; // Fit the camera to every aligned frame rather than the final one (early frames are much more spread out).
+    float CameraFitRadius{-1}; // Radius the camera was last fit to, when aligned.
+
+    // Selected atom or bond of the shown molecule, highlighted by tinting its instance color.
+    struct PickedItem {
+        bool IsBond;
+        uint Index;
+
+        bool operator==(const PickedItem &) const = default;
+    };
+    std::optional<PickedItem> Selection;
+    void Select(std::optional<PickedItem>);
+    void RenderPickedTooltip(const PickedItem &, float pick_us) const;
+
+    // Rebuilt when the shown molecule's primitive count changes, and refit when only their positions do.
+    PickingBvh Bvh;
+    struct BvhKey {
+        int MoleculeIndex{-1};
+        float AtomScale{0}, BondRadius{0};
+        bool ShowBonds{false};
+        uint HiddenElements{0}; // Hidden atoms and bonds are left out.
+
+        bool operator==(const BvhKey &) const = default;
+    };
+    BvhKey BvhBuiltFor;
 
     int MoleculeIndex{0};
     float AtomScale{0.5}, BondRadius{1.2};
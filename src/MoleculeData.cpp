@@ -0,0 +1,219 @@
+#include "MoleculeData.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include "DatasetConfig.h"
+#include "Trace.h"
+
+static const QM9WithH DatasetConfig;
+
+void MoleculeData::Reserve(uint num_atoms) {
+    Types.reserve(num_atoms);
+    X.reserve(num_atoms);
+    Y.reserve(num_atoms);
+    Z.reserve(num_atoms);
+}
+
+void MoleculeData::AddAtom(uint8_t type, const glm::vec3 &position) {
+    Types.push_back(type);
+    X.push_back(position.x);
+    Y.push_back(position.y);
+    Z.push_back(position.z);
+}
+
+std::pair<glm::vec3, glm::vec3> MoleculeData::ComputeBounds() const {
+    if (Types.empty()) return {glm::vec3{0}, glm::vec3{0}};
+
+    glm::vec3 min = GetPosition(0), max = min;
+    for (uint i = 1; i < NumAtoms(); i++) {
+        min = {std::min(min.x, X[i]), std::min(min.y, Y[i]), std::min(min.z, Z[i])};
+        max = {std::max(max.x, X[i]), std::max(max.y, Y[i]), std::max(max.z, Z[i])};
+    }
+    return {min, max};
+}
+
+uint64_t MoleculeData::GetAllocatedBytes() const {
+    return Types.capacity() * sizeof(uint8_t) + (X.capacity() + Y.capacity() + Z.capacity()) * sizeof(float) + Bonds.capacity() * sizeof(Bond);
+}
+
+// Reject obviously corrupt atom counts before reserving for them.
+static const uint MaxXyzAtoms = 1 << 20;
+
+std::optional<MoleculeData> ReadXyzFile(const fs::path &xyz_file_path) {
+    Trace::Scope trace{"Parse XYZ", "load"};
+    std::ifstream xyz_file(xyz_file_path);
+    if (!xyz_file.is_open()) {
+        std::cerr << "Failed to open " << xyz_file_path << std::endl;
+        return {};
+    }
+
+    const auto fail = [&](uint line_number, const std::string &message) -> std::optional<MoleculeData> {
+        std::cerr << xyz_file_path.string() << ":" << line_number << ": " << message << std::endl;
+        return {};
+    };
+
+    std::string line;
+    // First line has the number of atoms.
+    std::getline(xyz_file, line);
+    std::istringstream header(line);
+    int64_t expected_num_atoms;
+    if (!(header >> expected_num_atoms) || !(header >> std::ws).eof()) return fail(1, "Expected an atom count, but found \"" + line + "\"");
+    if (expected_num_atoms < 0 || expected_num_atoms > MaxXyzAtoms) return fail(1, "Invalid atom count " + std::to_string(expected_num_atoms));
+    // Second line is empty.
+    std::getline(xyz_file, line);
+
+    MoleculeData molecule;
+    molecule.Reserve(expected_num_atoms);
+    for (uint line_number = 3; std::getline(xyz_file, line); line_number++) {
+        std::istringstream iss(line);
+        std::string atom_name; // 'H', 'C', 'N', 'O', 'F'
+        if (!(iss >> atom_name)) continue; // Blank line.
+
+        glm::vec3 position;
+        if (!(iss >> position.x >> position.y >> position.z)) return fail(line_number, "Expected an element and three coordinates");
+        const auto type = DatasetConfig.AtomEncoder.find(atom_name);
+        if (type == DatasetConfig.AtomEncoder.end()) return fail(line_number, "Unknown element \"" + atom_name + "\"");
+        molecule.AddAtom(type->second, position);
+    }
+
+    if (molecule.NumAtoms() != expected_num_atoms) {
+        std::cerr << "Expected " << expected_num_atoms << " atoms, but found " << molecule.NumAtoms() << std::endl;
+    }
+    return molecule;
+}
+
+// Squared distance thresholds (in Å²) below which a pair of atom types forms a bond of at least each order,
+// precomputed from the `GetBondOrder` tables so bond detection needs no string lookups.
+// A threshold of 0 means the pair never forms a bond of that order.
+struct BondThresholds {
+    BondThresholds() {
+        static const float Margin1 = 10, Margin2 = 5, Margin3 = 3; // Same as `GetBondOrder`
+        const auto &decoder = DatasetConfig.AtomDecoder;
+        NumTypes = decoder.size();
+        for (auto *thresholds : {&Single, &Double, &Triple}) thresholds->resize(NumTypes * NumTypes, 0);
+        for (uint a = 0; a < NumTypes; a++) {
+            for (uint b = 0; b < NumTypes; b++) {
+                const auto Set = [&](std::vector<float> &thresholds, const auto &lengths, float margin) {
+                    if (auto found = lengths.find(decoder[a]); found != lengths.end()) {
+                        if (auto length = found->second.find(decoder[b]); length != found->second.end()) {
+                            const float max_distance = (length->second + margin) / 100.f;
+                            thresholds[a * NumTypes + b] = max_distance * max_distance;
+                        }
+                    }
+                };
+                Set(Single, Bonds1, Margin1);
+                Set(Double, Bonds2, Margin2);
+                Set(Triple, Bonds3, Margin3);
+            }
+        }
+    }
+
+    uint NumTypes;
+    std::vector<float> Single, Double, Triple; // Indexed by `type_a * NumTypes + type_b`.
+};
+
+std::vector<Bond> FindBonds(const MoleculeData &molecule) {
+    Trace::Scope trace{"Find bonds", "load"};
+    static const BondThresholds Thresholds;
+
+    std::vector<Bond> bonds;
+    const auto &types = molecule.Types;
+    const float *x = molecule.X.data(), *y = molecule.Y.data(), *z = molecule.Z.data();
+    for (uint i = 0; i < molecule.NumAtoms(); i++) {
+        const uint row = types[i] * Thresholds.NumTypes;
+        for (uint j = 0; j < i; j++) {
+            const float dx = x[i] - x[j], dy = y[i] - y[j], dz = z[i] - z[j];
+            const float distance_squared = dx * dx + dy * dy + dz * dz;
+            const uint pair = row + types[j];
+            if (distance_squared >= Thresholds.Single[pair]) continue;
+
+            const uint8_t order = distance_squared < Thresholds.Double[pair] ? (distance_squared < Thresholds.Triple[pair] ? 3 : 2) : 1;
+            bonds.push_back({i, j, order});
+        }
+    }
+    return bonds;
+}
+
+glm::vec4 Highlight(const glm::vec4 &color) {
+    static const glm::vec3 HighlightColor{1, 0.8, 0};
+    return {glm::mix(glm::vec3(color), HighlightColor, 0.7f), color.a};
+}
+
+glm::vec3 BondNormal(const glm::vec3 &axis) {
+    return glm::normalize(glm::cross(axis, std::abs(axis.y) < 0.99f ? glm::vec3{0, 1, 0} : glm::vec3{1, 0, 0}));
+}
+
+std::vector<glm::vec3> FindBondSides(const MoleculeData &molecule) {
+    const auto &bonds = molecule.Bonds;
+    std::vector<glm::vec3> sides(bonds.size(), glm::vec3{0});
+    if (std::none_of(bonds.begin(), bonds.end(), [](const Bond &bond) { return bond.Order > 1; })) return sides;
+
+    // Bonds of each atom, in `atom_bonds[atom_offsets[atom]..atom_offsets[atom + 1])`.
+    std::vector<uint> atom_offsets(molecule.NumAtoms() + 1, 0), atom_bonds(bonds.size() * 2);
+    for (const auto &bond : bonds) {
+        atom_offsets[bond.A + 1]++;
+        atom_offsets[bond.B + 1]++;
+    }
+    for (uint atom = 0; atom < molecule.NumAtoms(); atom++) atom_offsets[atom + 1] += atom_offsets[atom];
+    std::vector<uint> atom_fill(atom_offsets.begin(), atom_offsets.end() - 1);
+    for (uint bond_index = 0; bond_index < bonds.size(); bond_index++) {
+        atom_bonds[atom_fill[bonds[bond_index].A]++] = bond_index;
+        atom_bonds[atom_fill[bonds[bond_index].B]++] = bond_index;
+    }
+
+    for (uint bond_index = 0; bond_index < bonds.size(); bond_index++) {
+        const auto &bond = bonds[bond_index];
+        if (bond.Order < 2) continue;
+
+        const auto axis = glm::normalize(molecule.GetPosition(bond.B) - molecule.GetPosition(bond.A));
+        glm::vec3 side{0};
+        for (const uint atom : {bond.A, bond.B}) {
+            const uint other_atom = atom == bond.A ? bond.B : bond.A;
+            for (uint i = atom_offsets[atom]; i < atom_offsets[atom + 1] && glm::length(side) < 1e-4f; i++) {
+                const auto &neighbor = bonds[atom_bonds[i]];
+                const uint neighbor_atom = neighbor.A == atom ? neighbor.B : neighbor.A;
+                if (neighbor_atom == other_atom) continue;
+
+                const auto to_neighbor = molecule.GetPosition(neighbor_atom) - molecule.GetPosition(atom);
+                side = to_neighbor - axis * glm::dot(to_neighbor, axis); // Collinear neighbors leave this near zero.
+            }
+        }
+        sides[bond_index] = glm::normalize(glm::length(side) < 1e-4f ? BondNormal(axis) : side);
+    }
+    return sides;
+}
+
+std::string ChemicalFormula(const std::vector<uint8_t> &types) {
+    std::vector<uint> counts(DatasetConfig.AtomDecoder.size(), 0);
+    for (const uint8_t type : types) counts[type]++;
+
+    // Hill system: carbon first, then hydrogen, then everything else alphabetically.
+    // If there is no carbon, all elements (including hydrogen) are alphabetical.
+    std::vector<uint> order(counts.size());
+    for (uint type = 0; type < order.size(); type++) order[type] = type;
+    const uint carbon = DatasetConfig.AtomEncoder.at("C"), hydrogen = DatasetConfig.AtomEncoder.at("H");
+    const bool has_carbon = counts[carbon] > 0;
+    std::sort(order.begin(), order.end(), [&](uint a, uint b) {
+        if (has_carbon) {
+            for (const uint first : {carbon, hydrogen}) {
+                if (a == first || b == first) return a == first && b != first;
+            }
+        }
+        return DatasetConfig.AtomDecoder[a] < DatasetConfig.AtomDecoder[b];
+    });
+
+    std::string formula;
+    for (const uint type : order) {
+        if (counts[type] == 0) continue;
+        formula += DatasetConfig.AtomDecoder[type];
+        if (counts[type] > 1) formula += std::to_string(counts[type]);
+    }
+    return formula;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+namespace fs = std::filesystem;
+
+using uint = unsigned int;
+
+struct Bond {
+    uint A, B; // Atom indices, with `A > B`.
+    uint8_t Order; // 1: single, 2: double, 3: triple
+};
+
+// A molecule's atoms and bonds, independent of any OpenGL state, so it can be loaded and analyzed headless or on worker threads.
+// Rendering (`Molecule`) builds its mesh instances from this.
+// Positions are stored as separate x/y/z arrays, so kernels over positions read contiguous floats.
+// Atom types are indices into `QM9WithH::AtomDecoder`.
+struct MoleculeData {
+    std::vector<uint8_t> Types;
+    std::vector<float> X, Y, Z;
+    std::vector<Bond> Bonds; // Empty until filled by `FindBonds`.
+
+    uint NumAtoms() const { return Types.size(); }
+    glm::vec3 GetPosition(uint atom_index) const { return {X[atom_index], Y[atom_index], Z[atom_index]}; }
+
+    void Reserve(uint num_atoms);
+    void AddAtom(uint8_t type, const glm::vec3 &position);
+
+    std::pair<glm::vec3, glm::vec3> ComputeBounds() const; // [min, max] of atom positions. Both zero if there are no atoms.
+    uint64_t GetAllocatedBytes() const;
+};
+
+// Per-element bitmasks, with bit `i` for atom type `i`. Applied in the shaders (see `transform_vertex.glsl`), so changing them needs no instance updates.
+struct ElementMask {
+    inline static const uint MaxElements = 32;
+
+    uint Hidden{0}; // Hidden atoms, and bonds to them.
+    uint Highlighted{0};
+
+    bool IsHidden(uint8_t type) const { return type < MaxElements && (Hidden & (1u << type)); }
+    bool IsHighlighted(uint8_t type) const { return type < MaxElements && (Highlighted & (1u << type)); }
+
+    bool operator==(const ElementMask &) const = default;
+};
+
+// Mix toward the highlight color, keeping alpha. Must match `highlight_color` in `transform_vertex.glsl`.
+glm::vec4 Highlight(const glm::vec4 &color);
+
+// Reads atom types and positions. Bonds are not computed.
+// Returns `std::nullopt` (and reports why, with the line number) if the file can't be opened or is malformed, rather than throwing.
+std::optional<MoleculeData> ReadXyzFile(const fs::path &);
+
+// Hill notation, e.g. "C7H10N2O".
+std::string ChemicalFormula(const std::vector<uint8_t> &types);
+
+// All bonded atom pairs, ordered by `A`, then `B`. Same results as `GetBondOrder` for every pair, using a per-type-pair threshold table.
+std::vector<Bond> FindBonds(const MoleculeData &);
+
+// Double and triple bonds are drawn as thinner parallel cylinders, spread along a side direction (see `FindBondSides`).
+// Must match `transform_vertex.glsl`.
+inline const float MultiBondThickness = 0.5; // Cylinder radius, relative to a single bond's.
+inline const float MultiBondSpacing = 1.2; // Distance between cylinder axes, relative to a single bond's radius.
+
+// Any unit direction perpendicular to the (unit) bond axis.
+glm::vec3 BondNormal(const glm::vec3 &axis);
+
+// Per bond, the unit direction perpendicular to the bond that multi-order bond cylinders are spread along.
+// Toward a neighboring bond's far atom when there is one, so the cylinders lie in that bond's plane. Zero for single bonds.
+std::vector<glm::vec3> FindBondSides(const MoleculeData &);
@@ -0,0 +1,48 @@
+#include "MoleculeGrid.h"
+
+#include <cmath>
+
+#include "Molecule.h"
+
+// Stores `cell` in the transform's metadata row (see `transform_vertex.glsl`). 0 is reserved for untagged instances.
+static void SetGridCell(glm::mat4 &transform, uint cell) { transform[1][3] = float(cell + 1); }
+
+MoleculeGrid::MoleculeGrid(const std::vector<const Molecule *> &molecules, float atom_scale, float bond_radius)
+    : AtomMesh(Molecule::AtomGeometry), BondMesh(Molecule::BondGeometry) {
+    AtomMesh.ClearInstances();
+    BondMesh.ClearInstances();
+    if (molecules.empty()) return;
+
+    // Roughly square layout.
+    Columns = std::ceil(std::sqrt(float(molecules.size())));
+    Rows = (molecules.size() + Columns - 1) / Columns;
+
+    float max_extent = 0;
+    for (uint cell = 0; cell < molecules.size(); cell++) {
+        const auto &molecule = *molecules[cell];
+        const auto &data = molecule.Data;
+        const auto [bounds_min, bounds_max] = data.ComputeBounds();
+        max_extent = std::max(max_extent, glm::distance(bounds_min, bounds_max));
+        const glm::vec3 center = (bounds_min + bounds_max) / 2.f;
+
+        for (uint atom_index = 0; atom_index < data.NumAtoms(); atom_index++) {
+            glm::mat4 transform = glm::scale(glm::translate(Identity, data.GetPosition(atom_index) - center), glm::vec3{molecule.GetAtomRadius(atom_index) * atom_scale});
+            SetGridCell(transform, cell);
+            Molecule::SetElements(transform, data.Types[atom_index]);
+            const uint instance = AtomMesh.NumInstances();
+            AtomMesh.AddInstance();
+            AtomMesh.SetTransform(instance, transform);
+            AtomMesh.SetColor(instance, molecule.AtomMesh.GetColor(atom_index));
+        }
+        for (uint bond_index = 0; bond_index < data.Bonds.size(); bond_index++) {
+            const auto &bond = data.Bonds[bond_index];
+            glm::mat4 transform = Molecule::BondTransform(data.GetPosition(bond.A) - center, data.GetPosition(bond.B) - center, bond_radius, bond.Order, molecule.BondSides[bond_index]);
+            SetGridCell(transform, cell);
+            Molecule::SetElements(transform, data.Types[bond.A], data.Types[bond.B]);
+            const uint instance = BondMesh.NumInstances();
+            BondMesh.AddInstance();
+            BondMesh.SetTransform(instance, transform);
+        }
+    }
+    Spacing = max_extent * 1.1f;
+}
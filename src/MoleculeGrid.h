@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+
+#include "Mesh/Mesh.h"
+
+struct Molecule;
+
+// Tiles many molecules side by side, packed into one shared atom mesh and one shared bond mesh,
+// so the whole grid draws in two instanced draw calls regardless of the number of molecules.
+// Each instance is tagged with its molecule's grid cell, and the vertex shader applies the cell offset
+// (see `transform_vertex.glsl` and `Scene::GridColumns`), so instances are stored relative to their molecule's center.
+struct MoleculeGrid {
+    MoleculeGrid(const std::vector<const Molecule *> &, float atom_scale, float bond_radius);
+
+    Mesh AtomMesh, BondMesh;
+    uint Columns{1}, Rows{1};
+    float Spacing{0}; // Distance between neighboring cell centers.
+};
@@ -0,0 +1,28 @@
+#include "MoleculePrimitives.h"
+
+#include "DatasetConfig.h"
+
+static const QM9WithH DatasetConfig;
+
+std::vector<PickingBvh::Primitive> GetMoleculePrimitives(const MoleculeData &data, float atom_scale, float bond_radius, bool bonds, const ElementMask &mask) {
+    std::vector<PickingBvh::Primitive> primitives;
+    primitives.reserve(data.NumAtoms() + (bonds ? data.Bonds.size() : 0));
+    for (uint atom_index = 0; atom_index < data.NumAtoms(); atom_index++) {
+        if (mask.IsHidden(data.Types[atom_index])) continue;
+
+        const auto position = data.GetPosition(atom_index);
+        primitives.push_back({position, position, DatasetConfig.RadiusForAtom[data.Types[atom_index]] * atom_scale, atom_index});
+    }
+    if (bonds) {
+        // The shared bond cylinder has radius 0.1 before scaling (see `Molecule::BondGeometry`).
+        // Multi-order bonds are picked with one capsule around all of their parallel cylinders.
+        for (uint bond_index = 0; bond_index < data.Bonds.size(); bond_index++) {
+            const auto &bond = data.Bonds[bond_index];
+            if (mask.IsHidden(data.Types[bond.A]) || mask.IsHidden(data.Types[bond.B])) continue;
+
+            const float extent = bond.Order > 1 ? (bond.Order - 1) * 0.5f * MultiBondSpacing + MultiBondThickness : 1;
+            primitives.push_back({data.GetPosition(bond.A), data.GetPosition(bond.B), 0.1f * bond_radius * extent, data.NumAtoms() + bond_index});
+        }
+    }
+    return primitives;
+}
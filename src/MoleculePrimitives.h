@@ -0,0 +1,11 @@
+#pragma once
+
+#include <vector>
+
+#include "MoleculeData.h"
+#include "Picking.h"
+
+// Atom spheres and (optionally) bond capsules, as drawn by `Molecule` with the given settings.
+// Atom primitive ids are atom indices, and bond ids are `NumAtoms() + bond index`.
+// Atoms hidden by `mask`, and bonds to them, are left out.
+std::vector<PickingBvh::Primitive> GetMoleculePrimitives(const MoleculeData &, float atom_scale, float bond_radius, bool bonds, const ElementMask &mask = {});
@@ -0,0 +1,294 @@
+#include "Picking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+#include "Simd.h"
+
+using glm::vec3;
+
+static const uint MaxLeafSize = 4;
+
+static void GetBounds(const PickingBvh::Primitive &primitive, vec3 &min, vec3 &max) {
+    min = glm::min(primitive.A, primitive.B) - primitive.Radius;
+    max = glm::max(primitive.A, primitive.B) + primitive.Radius;
+}
+
+void PickingBvh::Clear() {
+    Nodes.clear();
+    Primitives.clear();
+    PrimitiveOrder.clear();
+}
+
+void PickingBvh::Build(const std::vector<Primitive> &primitives) {
+    Clear();
+    if (primitives.empty()) return;
+
+    Primitives = primitives;
+    PrimitiveOrder.resize(primitives.size());
+    std::iota(PrimitiveOrder.begin(), PrimitiveOrder.end(), 0);
+    std::vector<vec3> centroids(primitives.size());
+    for (uint i = 0; i < primitives.size(); i++) centroids[i] = (primitives[i].A + primitives[i].B) * 0.5f;
+
+    Nodes.reserve(2 * primitives.size() / MaxLeafSize + 1);
+    BuildNode(0, primitives.size(), centroids);
+}
+
+uint PickingBvh::BuildNode(uint begin, uint end, std::vector<vec3> &centroids) {
+    const uint node_index = Nodes.size();
+    Nodes.push_back({vec3{std::numeric_limits<float>::max()}, vec3{std::numeric_limits<float>::lowest()}, begin, end - begin});
+
+    vec3 centroid_min{std::numeric_limits<float>::max()}, centroid_max{std::numeric_limits<float>::lowest()};
+    for (uint i = begin; i < end; i++) {
+        vec3 min, max;
+        GetBounds(Primitives[i], min, max);
+        Nodes[node_index].Min = glm::min(Nodes[node_index].Min, min);
+        Nodes[node_index].Max = glm::max(Nodes[node_index].Max, max);
+        centroid_min = glm::min(centroid_min, centroids[i]);
+        centroid_max = glm::max(centroid_max, centroids[i]);
+    }
+    if (end - begin <= MaxLeafSize) return node_index;
+
+    const vec3 extent = centroid_max - centroid_min;
+    const uint axis = extent.x > extent.y && extent.x > extent.z ? 0 : (extent.y > extent.z ? 1 : 2);
+    const float split = (centroid_min[axis] + centroid_max[axis]) * 0.5f;
+    // Primitives, their input order and centroids are permuted together.
+    uint mid = begin;
+    for (uint i = begin; i < end; i++) {
+        if (centroids[i][axis] < split) {
+            std::swap(Primitives[i], Primitives[mid]);
+            std::swap(PrimitiveOrder[i], PrimitiveOrder[mid]);
+            std::swap(centroids[i], centroids[mid]);
+            mid++;
+        }
+    }
+    if (mid == begin || mid == end) mid = (begin + end) / 2; // All centroids coincide along the axis.
+
+    Nodes[node_index].Count = 0;
+    BuildNode(begin, mid, centroids);
+    const uint second_child = BuildNode(mid, end, centroids);
+    Nodes[node_index].Index = second_child;
+    return node_index;
+}
+
+bool PickingBvh::Refit(const std::vector<Primitive> &primitives) {
+    if (primitives.size() != Primitives.size() || Nodes.empty()) return false;
+
+    for (uint i = 0; i < Primitives.size(); i++) Primitives[i] = primitives[PrimitiveOrder[i]];
+    // Children follow their parents, so a reverse pass sees children first.
+    for (uint node_index = Nodes.size(); node_index-- > 0;) {
+        auto &node = Nodes[node_index];
+        if (node.Count > 0) {
+            node.Min = vec3{std::numeric_limits<float>::max()};
+            node.Max = vec3{std::numeric_limits<float>::lowest()};
+            for (uint i = node.Index; i < node.Index + node.Count; i++) {
+                vec3 min, max;
+                GetBounds(Primitives[i], min, max);
+                node.Min = glm::min(node.Min, min);
+                node.Max = glm::max(node.Max, max);
+            }
+        } else {
+            const auto &first = Nodes[node_index + 1], &second = Nodes[node.Index];
+            node.Min = glm::min(first.Min, second.Min);
+            node.Max = glm::max(first.Max, second.Max);
+        }
+    }
+    return true;
+}
+
+// Distance to the box along the ray, or infinity if it's missed (or entirely behind the origin, or beyond `max_distance`).
+static float IntersectBox(const vec3 &min, const vec3 &max, const Ray &ray, const vec3 &inverse_direction, float max_distance) {
+    const vec3 t1 = (min - ray.Origin) * inverse_direction, t2 = (max - ray.Origin) * inverse_direction;
+    const vec3 t_min = glm::min(t1, t2), t_max = glm::max(t1, t2);
+    const float near = std::max({t_min.x, t_min.y, t_min.z, 0.f}), far = std::min({t_max.x, t_max.y, t_max.z, max_distance});
+    return near <= far ? near : std::numeric_limits<float>::infinity();
+}
+
+// Distances along the ray where it enters and leaves the sphere, or false if it misses.
+static bool IntersectSphere(const vec3 &center, float radius, const Ray &ray, float &t_enter, float &t_leave) {
+    const vec3 oc = ray.Origin - center;
+    const float b = glm::dot(oc, ray.Direction), c = glm::dot(oc, oc) - radius * radius;
+    const float h = b * b - c;
+    if (h < 0) return false;
+    const float sqrt_h = std::sqrt(h);
+    t_enter = -b - sqrt_h;
+    t_leave = -b + sqrt_h;
+    return true;
+}
+
+static float NearestRoot(float t_enter, float t_leave, float min_distance) {
+    return t_enter >= min_distance ? t_enter : (t_leave >= min_distance ? t_leave : -1);
+}
+
+// Nearest distance along the ray of at least `min_distance`, or a negative value if missed.
+static float IntersectSphere(const vec3 &center, float radius, const Ray &ray, float min_distance) {
+    float t_enter, t_leave;
+    if (!IntersectSphere(center, radius, ray, t_enter, t_leave)) return -1;
+    return NearestRoot(t_enter, t_leave, min_distance);
+}
+
+// Capsule intersection based on https://iquilezles.org/articles/intersectors, extended to also find where the ray leaves.
+static float IntersectCapsule(const vec3 &a, const vec3 &b, float radius, const Ray &ray, float min_distance) {
+    const vec3 ba = b - a, oa = ray.Origin - a;
+    const float baba = glm::dot(ba, ba), bard = glm::dot(ba, ray.Direction), baoa = glm::dot(ba, oa);
+    const float rdoa = glm::dot(ray.Direction, oa), oaoa = glm::dot(oa, oa);
+    // Projection of the hit point onto the axis, scaled by `baba`: in (0, baba) on the body, and beyond it on a cap.
+    const auto axis_position = [&](float t) { return baoa + t * bard; };
+
+    float nearest = std::numeric_limits<float>::infinity();
+    const auto consider = [&](float t, bool valid) {
+        if (valid && t >= min_distance) nearest = std::min(nearest, t);
+    };
+    const float k2 = baba - bard * bard;
+    // Rays parallel to the axis can only enter and leave through the caps.
+    if (k2 >= 1e-8f * baba) {
+        const float k1 = baba * rdoa - baoa * bard, k0 = baba * oaoa - baoa * baoa - radius * radius * baba;
+        const float h = k1 * k1 - k2 * k0;
+        if (h < 0) return -1; // Misses the infinite cylinder, so misses the caps too.
+        const float sqrt_h = std::sqrt(h);
+        for (const float t : {(-k1 - sqrt_h) / k2, (-k1 + sqrt_h) / k2}) {
+            const float y = axis_position(t);
+            consider(t, y > 0 && y < baba);
+        }
+    }
+    float t_enter, t_leave;
+    if (IntersectSphere(a, radius, ray, t_enter, t_leave)) {
+        for (const float t : {t_enter, t_leave}) consider(t, axis_position(t) <= 0);
+    }
+    if (IntersectSphere(b, radius, ray, t_enter, t_leave)) {
+        for (const float t : {t_enter, t_leave}) consider(t, axis_position(t) >= baba);
+    }
+    return std::isfinite(nearest) ? nearest : -1;
+}
+
+// Nearest distance along the ray of at least `min_distance`, or a negative value if missed.
+static float IntersectPrimitive(const PickingBvh::Primitive &primitive, const Ray &ray, float min_distance) {
+    return primitive.A == primitive.B ?
+        IntersectSphere(primitive.A, primitive.Radius, ray, min_distance) :
+        IntersectCapsule(primitive.A, primitive.B, primitive.Radius, ray, min_distance);
+}
+
+std::optional<PickingBvh::Hit> PickingBvh::Intersect(const Ray &ray, float min_distance) const {
+    return Traverse<false>(ray, min_distance, std::numeric_limits<float>::max());
+}
+
+bool PickingBvh::Occluded(const Ray &ray, float max_distance) const {
+    return Traverse<true>(ray, 0, max_distance).has_value();
+}
+
+template<bool AnyHit> std::optional<PickingBvh::Hit> PickingBvh::Traverse(const Ray &ray, float min_distance, float max_distance) const {
+    if (Nodes.empty()) return {};
+
+    const vec3 inverse_direction = 1.f / ray.Direction;
+    std::optional<Hit> nearest;
+    float nearest_distance = max_distance;
+
+    uint stack[64];
+    uint stack_size = 0;
+    if (IntersectBox(Nodes[0].Min, Nodes[0].Max, ray, inverse_direction, nearest_distance) < nearest_distance) stack[stack_size++] = 0;
+    while (stack_size > 0) {
+        const auto &node = Nodes[stack[--stack_size]];
+        if (node.Count > 0) {
+            for (uint i = node.Index; i < node.Index + node.Count; i++) {
+                const float t = IntersectPrimitive(Primitives[i], ray, min_distance);
+                if (t >= 0 && t < nearest_distance) {
+                    nearest_distance = t;
+                    nearest = Hit{Primitives[i].Id, t};
+                    if constexpr (AnyHit) return nearest;
+                }
+            }
+            continue;
+        }
+
+        // Visit the nearer child first (pushed last), and skip children beyond the nearest hit so far.
+        const uint first_index = &node - Nodes.data() + 1, second_index = node.Index;
+        const float first_t = IntersectBox(Nodes[first_index].Min, Nodes[first_index].Max, ray, inverse_direction, nearest_distance);
+        const float second_t = IntersectBox(Nodes[second_index].Min, Nodes[second_index].Max, ray, inverse_direction, nearest_distance);
+        const bool first_nearer = first_t <= second_t;
+        const float far_t = first_nearer ? second_t : first_t, near_t = first_nearer ? first_t : second_t;
+        if (std::isfinite(far_t) && stack_size < 64) stack[stack_size++] = first_nearer ? second_index : first_index;
+        if (std::isfinite(near_t) && stack_size < 64) stack[stack_size++] = first_nearer ? first_index : second_index;
+    }
+    return nearest;
+}
+
+std::array<std::optional<PickingBvh::Hit>, 4> PickingBvh::IntersectPacket(const std::array<Ray, 4> &rays) const {
+    std::array<std::optional<Hit>, 4> hits;
+    if (Nodes.empty()) return hits;
+
+    // Ray origins and inverse directions, one lane per ray.
+    Float4 origin[3], inverse_direction[3];
+    for (uint axis = 0; axis < 3; axis++) {
+        float origins[4], inverse_directions[4];
+        for (uint lane = 0; lane < 4; lane++) {
+            origins[lane] = rays[lane].Origin[axis];
+            inverse_directions[lane] = 1.f / rays[lane].Direction[axis];
+        }
+        origin[axis] = Float4::Load(origins);
+        inverse_direction[axis] = Float4::Load(inverse_directions);
+    }
+    float nearest_distances[4];
+    std::fill_n(nearest_distances, 4, std::numeric_limits<float>::max());
+
+    // Lanes (as bits) whose ray hits the node's box before its nearest hit so far, and the nearest entry distance among them.
+    const auto intersect_box = [&](const Node &node, float &near_t) {
+        Float4 near{0.f}, far = Float4::Load(nearest_distances);
+        for (uint axis = 0; axis < 3; axis++) {
+            const Float4 t1 = (Float4{node.Min[axis]} - origin[axis]) * inverse_direction[axis];
+            const Float4 t2 = (Float4{node.Max[axis]} - origin[axis]) * inverse_direction[axis];
+            near = Max(near, Min(t1, t2));
+            far = Min(far, Max(t1, t2));
+        }
+        const int lanes = (near <= far).Bits();
+        float nears[4];
+        near.Store(nears);
+        near_t = std::numeric_limits<float>::infinity();
+        for (uint lane = 0; lane < 4; lane++) {
+            if (lanes & (1 << lane)) near_t = std::min(near_t, nears[lane]);
+        }
+        return lanes;
+    };
+
+    struct Entry {
+        uint Node;
+        int Lanes; // Lanes that hit the node's box when it was pushed.
+    };
+    Entry stack[64];
+    uint stack_size = 0;
+    float root_t;
+    if (const int lanes = intersect_box(Nodes[0], root_t)) stack[stack_size++] = {0, lanes};
+    while (stack_size > 0) {
+        const auto [node_index, lanes] = stack[--stack_size];
+        const auto &node = Nodes[node_index];
+        if (node.Count > 0) {
+            for (uint lane = 0; lane < 4; lane++) {
+                if (!(lanes & (1 << lane))) continue;
+
+                for (uint i = node.Index; i < node.Index + node.Count; i++) {
+                    const float t = IntersectPrimitive(Primitives[i], rays[lane], 0);
+                    if (t >= 0 && t < nearest_distances[lane]) {
+                        nearest_distances[lane] = t;
+                        hits[lane] = Hit{Primitives[i].Id, t};
+                    }
+                }
+            }
+            continue;
+        }
+
+        // As in `Traverse`, visit the nearer child first, by the nearest entry among the packet's rays.
+        const uint first_index = node_index + 1, second_index = node.Index;
+        float first_t, second_t;
+        const int first_lanes = intersect_box(Nodes[first_index], first_t), second_lanes = intersect_box(Nodes[second_index], second_t);
+        const bool first_nearer = first_t <= second_t;
+        const Entry near{first_nearer ? first_index : second_index, first_nearer ? first_lanes : second_lanes};
+        const Entry far{first_nearer ? second_index : first_index, first_nearer ? second_lanes : first_lanes};
+        if (far.Lanes && stack_size < 64) stack[stack_size++] = far;
+        if (near.Lanes && stack_size < 64) stack[stack_size++] = near;
+    }
+    return hits;
+}
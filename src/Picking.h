@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <optional>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+struct Ray {
+    glm::vec3 Origin, Direction; // `Direction` is normalized.
+};
+
+// Bounding volume hierarchy over spheres and capsules, for picking atoms and bonds with mouse rays.
+// GL-free and independent of molecules (see `GetMoleculePrimitives`), and cheap enough to rebuild whenever the picked molecule changes.
+// Built top-down, splitting each node at the centroid midpoint of its longest axis.
+// `Refit` only recomputes node bounds, for primitives that moved but kept their order (e.g. between frames of a diffusion chain).
+struct PickingBvh {
+    struct Primitive {
+        glm::vec3 A, B; // Segment ends of a capsule, or the center of a sphere (`A == B`).
+        float Radius;
+        uint Id; // Returned in hits.
+    };
+
+    struct Hit {
+        uint Id;
+        float Distance; // Along the ray.
+    };
+
+    void Build(const std::vector<Primitive> &);
+    // Returns false without changing anything if the number of primitives differs from the last `Build`.
+    bool Refit(const std::vector<Primitive> &);
+    void Clear();
+
+    // Nearest hit at least `min_distance` along the ray.
+    // Surfaces are hit where the ray enters and where it leaves, so a ray can continue through a hit primitive by passing its hit distance.
+    std::optional<Hit> Intersect(const Ray &, float min_distance = 0) const;
+    // True if anything is hit closer than `max_distance` (e.g. for shadow rays). Stops at the first hit found.
+    bool Occluded(const Ray &, float max_distance) const;
+    // Nearest hits of four rays, traversed together: each node's bounds are tested against all four rays at once (see `Float4`),
+    // and the packet descends wherever any of its rays does. Same hits as `Intersect` per ray, and faster for coherent rays
+    // (e.g. camera rays through neighboring pixels), which mostly visit the same nodes.
+    std::array<std::optional<Hit>, 4> IntersectPacket(const std::array<Ray, 4> &) const;
+
+    uint NumPrimitives() const { return Primitives.size(); }
+
+private:
+    // Nodes are stored depth-first, so an interior node's first child directly follows it.
+    struct Node {
+        glm::vec3 Min, Max;
+        uint Index; // First primitive for leaves, second child for interior nodes.
+        uint Count; // Number of primitives for leaves, 0 for interior nodes.
+    };
+
+    std::vector<Node> Nodes;
+    std::vector<Primitive> Primitives; // In leaf order.
+    std::vector<uint> PrimitiveOrder; // Input index of each primitive in `Primitives`, for `Refit`.
+
+    uint BuildNode(uint begin, uint end, std::vector<glm::vec3> &centroids);
+    template<bool AnyHit> std::optional<Hit> Traverse(const Ray &, float min_distance, float max_distance) const;
+};
@@ -0,0 +1,216 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <deque>
+#include <format>
+
+#include <GL/glew.h>
+
+#define IMGUI_DEFINE_MATH_OPERATORS
+#include "imgui.h"
+
+#include "Trace.h"
+
+struct PendingGpuQuery {
+    uint Id;
+    const char *Name;
+    GLenum Target; // `GL_TIME_ELAPSED` or `GL_SAMPLES_PASSED`.
+};
+
+static std::deque<PendingGpuQuery> PendingGpuQueries; // In issue order.
+// Query objects take the type of their first use, so they're only reused for the same target.
+static std::vector<uint> FreeTimerQueries, FreeSamplesQueries;
+static bool GpuZoneActive = false, SamplesZoneActive = false;
+
+static uint AcquireQuery(std::vector<uint> &free_queries) {
+    if (free_queries.empty()) {
+        uint id;
+        glGenQueries(1, &id);
+        return id;
+    }
+    const uint id = free_queries.back();
+    free_queries.pop_back();
+    return id;
+}
+
+static bool TimerQueriesSupported() {
+    static const bool supported = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+    return supported;
+}
+
+Profiler::ZoneStats &Profiler::GetZone(const char *name, bool gpu) {
+    for (auto &zone : Zones) {
+        if (zone.Name == name && zone.Gpu == gpu) return zone;
+    }
+    return Zones.emplace_back(ZoneStats{name, gpu});
+}
+
+Profiler::CountStats &Profiler::GetSamplesZone(const char *name) {
+    for (auto &zone : SamplesZones) {
+        if (zone.Name == name) return zone;
+    }
+    return SamplesZones.emplace_back(CountStats{name});
+}
+
+void Profiler::CpuZone::End() {
+    if (!Name) return;
+
+    const auto end = Clock::now();
+    if (Trace::IsEnabled()) Trace::Record(Name, "frame", Start, end);
+
+    auto &zone = GetZone(Name, false);
+    const double ms = std::chrono::duration<double, std::milli>(end - Start).count();
+    zone.FrameMs += ms;
+    zone.FrameCalls++;
+    zone.Latest = {float(ms), zone.Latest.Count + 1};
+    Name = nullptr;
+}
+
+Profiler::GpuZone::GpuZone(const char *name) : Name(name) {
+    if (GpuZoneActive || !TimerQueriesSupported()) return;
+
+    QueryId = AcquireQuery(FreeTimerQueries);
+    glBeginQuery(GL_TIME_ELAPSED, QueryId);
+    GpuZoneActive = true;
+}
+
+void Profiler::GpuZone::End() {
+    if (QueryId == 0) return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    GpuZoneActive = false;
+    PendingGpuQueries.push_back({QueryId, Name, GL_TIME_ELAPSED});
+    QueryId = 0;
+}
+
+Profiler::SamplesZone::SamplesZone(const char *name) : Name(name) {
+    if (SamplesZoneActive) return;
+
+    QueryId = AcquireQuery(FreeSamplesQueries);
+    glBeginQuery(GL_SAMPLES_PASSED, QueryId);
+    SamplesZoneActive = true;
+}
+
+void Profiler::SamplesZone::End() {
+    if (QueryId == 0) return;
+
+    glEndQuery(GL_SAMPLES_PASSED);
+    SamplesZoneActive = false;
+    PendingGpuQueries.push_back({QueryId, Name, GL_SAMPLES_PASSED});
+    QueryId = 0;
+}
+
+void Profiler::ReadGpuQueries() {
+    // Results become available in issue order, so stop at the first one that isn't ready, rather than waiting on it.
+    while (!PendingGpuQueries.empty()) {
+        const auto [id, name, target] = PendingGpuQueries.front();
+        GLint available = 0;
+        glGetQueryObjectiv(id, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break;
+
+        GLuint64 result = 0;
+        glGetQueryObjectui64v(id, GL_QUERY_RESULT, &result);
+        if (target == GL_SAMPLES_PASSED) {
+            auto &zone = GetSamplesZone(name);
+            zone.Latest = {result, zone.Latest.Count + 1};
+            FreeSamplesQueries.push_back(id);
+        } else {
+            auto &zone = GetZone(name, true);
+            zone.FrameMs += result / 1e6;
+            zone.FrameCalls++;
+            zone.Latest = {float(result / 1e6), zone.Latest.Count + 1};
+            FreeTimerQueries.push_back(id);
+        }
+        PendingGpuQueries.pop_front();
+    }
+}
+
+Profiler::ZoneSample Profiler::GetLatestSample(const char *name, bool gpu) {
+    for (const auto &zone : Zones) {
+        if (zone.Name == name && zone.Gpu == gpu) return zone.Latest;
+    }
+    return {};
+}
+
+Profiler::CountSample Profiler::GetLatestSamplesPassed(const char *name) {
+    for (const auto &zone : SamplesZones) {
+        if (zone.Name == name) return zone.Latest;
+    }
+    return {};
+}
+
+void Profiler::BeginFrame() {
+    FrameStart = Clock::now();
+    ReadGpuQueries();
+}
+
+void Profiler::EndFrame() {
+    const uint i = FrameIndex % HistorySize;
+    FrameMsHistory[i] = std::chrono::duration<float, std::milli>(Clock::now() - FrameStart).count();
+    UploadedKbHistory[i] = FrameUploadedBytes / 1024.f;
+    for (auto &zone : Zones) {
+        zone.HistoryMs[i] = zone.FrameMs;
+        zone.FrameMs = 0;
+        zone.FrameCalls = 0;
+    }
+    LastFrameCounters = {FrameDrawCalls, FrameTriangles, FrameUploadedBytes};
+    FrameUploadedBytes = FrameDrawCalls = FrameTriangles = 0;
+    FrameIndex++;
+}
+
+using namespace ImGui;
+
+// Mean of the most recent `count` history entries.
+static float RecentMean(const std::vector<float> &history, uint64_t frame_index, uint count) {
+    count = std::min<uint64_t>({count, frame_index, history.size()});
+    if (count == 0) return 0;
+
+    float sum = 0;
+    for (uint i = 1; i <= count; i++) sum += history[(frame_index - i) % history.size()];
+    return sum / count;
+}
+
+static void PlotHistory(const char *label, const std::vector<float> &history, uint64_t frame_index, const char *overlay, float height = 60) {
+    // Plot oldest to newest, by offsetting into the ring buffer.
+    PlotLines(label, history.data(), history.size(), frame_index % history.size(), overlay, 0, FLT_MAX, {GetContentRegionAvail().x, height});
+}
+
+void Profiler::RenderWindow() {
+    static const uint AverageFrames = 60;
+
+    const float frame_ms = RecentMean(FrameMsHistory, FrameIndex, AverageFrames);
+    std::string overlay = std::format("Frame: {:.2f} ms ({:.0f} FPS)", frame_ms, frame_ms > 0 ? 1000 / frame_ms : 0);
+    PlotHistory("##FrameTime", FrameMsHistory, FrameIndex, overlay.c_str());
+
+    const float uploaded_kb = RecentMean(UploadedKbHistory, FrameIndex, AverageFrames);
+    overlay = std::format("Uploaded: {:.1f} KB/frame", uploaded_kb);
+    PlotHistory("##Uploaded", UploadedKbHistory, FrameIndex, overlay.c_str(), 40);
+    Text("Last frame: %llu draw calls, %llu triangles", (unsigned long long)LastFrameCounters.DrawCalls, (unsigned long long)LastFrameCounters.Triangles);
+
+    if (!TimerQueriesSupported()) TextDisabled("GPU timer queries are not supported by this driver.");
+
+    SeparatorText(std::format("Zones (mean of last {} frames)", AverageFrames).c_str());
+    if (BeginTable("Zones", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+        TableSetupColumn("Zone");
+        TableSetupColumn("ms/frame", ImGuiTableColumnFlags_WidthFixed);
+        TableSetupColumn("History", ImGuiTableColumnFlags_WidthStretch);
+        TableHeadersRow();
+        for (const auto &zone : Zones) {
+            PushID(&zone);
+            TableNextRow();
+            TableNextColumn();
+            Text("%s %s", zone.Gpu ? "GPU" : "CPU", zone.Name);
+            TableNextColumn();
+            Text("%.3f", RecentMean(zone.HistoryMs, FrameIndex, AverageFrames));
+            TableNextColumn();
+            PlotHistory("##History", zone.HistoryMs, FrameIndex, nullptr, GetTextLineHeight());
+            PopID();
+        }
+        EndTable();
+    }
+    if (!SamplesZones.empty()) {
+        SeparatorText("Samples passing depth (latest)");
+        for (const auto &zone : SamplesZones) Text("%s: %llu", zone.Name, (unsigned long long)zone.Latest.Value);
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+using uint = unsigned int;
+
+// Frame profiler with cheap CPU scoped zones, `GL_TIME_ELAPSED` GPU pass timings (read back asynchronously, a few frames late),
+// and per-frame upload accounting. Rolling per-frame histories are shown by `RenderWindow`.
+// Zones must be created on the main (GL) thread, and zone names must be string literals, since they are compared by pointer.
+struct Profiler {
+    using Clock = std::chrono::steady_clock;
+
+    inline static const uint HistorySize = 240; // Frames
+
+    // Times everything between its construction and destruction (or an explicit `End`). Nested zones are allowed.
+    struct CpuZone {
+        CpuZone(const char *name) : Name(name), Start(Clock::now()) {}
+        ~CpuZone() { End(); }
+
+        void End();
+
+    private:
+        const char *Name;
+        Clock::time_point Start;
+    };
+
+    // Times the GPU work of all GL commands issued during its lifetime.
+    // GL timer queries can't nest, so a zone created while another is active is ignored.
+    struct GpuZone {
+        GpuZone(const char *name);
+        ~GpuZone() { End(); }
+
+        void End();
+
+    private:
+        const char *Name;
+        uint QueryId{0};
+    };
+
+    // Counts the samples passing the depth test for all GL commands issued during its lifetime
+    // (shaded fragments, times the sample count with multisampling). Like GPU zones, these can't nest.
+    struct SamplesZone {
+        SamplesZone(const char *name);
+        ~SamplesZone() { End(); }
+
+        void End();
+
+    private:
+        const char *Name;
+        uint QueryId{0};
+    };
+
+    static void BeginFrame();
+    static void EndFrame();
+
+    static void AddUploadedBytes(uint64_t bytes) { FrameUploadedBytes += bytes; }
+    static void AddDrawCall(uint64_t triangles) {
+        FrameDrawCalls++;
+        FrameTriangles += triangles;
+    }
+
+    // Totals for the most recently ended frame.
+    struct FrameCounters {
+        uint64_t DrawCalls{0}, Triangles{0}, UploadedBytes{0};
+    };
+    static const FrameCounters &GetLastFrameCounters() { return LastFrameCounters; }
+
+    // Most recent single measurement of a zone, and the number of measurements so far (to tell new ones apart).
+    struct ZoneSample {
+        float Ms{0};
+        uint64_t Count{0};
+    };
+    static ZoneSample GetLatestSample(const char *name, bool gpu);
+
+    struct CountSample {
+        uint64_t Value{0}, Count{0};
+    };
+    static CountSample GetLatestSamplesPassed(const char *name);
+
+    static void RenderWindow(); // Render into the current ImGui window.
+
+private:
+    struct ZoneStats {
+        const char *Name;
+        bool Gpu;
+        double FrameMs{0};
+        uint FrameCalls{0};
+        ZoneSample Latest;
+        std::vector<float> HistoryMs = std::vector<float>(HistorySize, 0);
+    };
+
+    struct CountStats {
+        const char *Name;
+        CountSample Latest;
+    };
+
+    static ZoneStats &GetZone(const char *name, bool gpu);
+    static CountStats &GetSamplesZone(const char *name);
+    static void ReadGpuQueries(); // Non-blocking.
+
+    inline static std::vector<ZoneStats> Zones;
+    inline static std::vector<CountStats> SamplesZones;
+    inline static std::vector<float> FrameMsHistory = std::vector<float>(HistorySize, 0), UploadedKbHistory = std::vector<float>(HistorySize, 0);
+    inline static uint64_t FrameIndex{0}, FrameUploadedBytes{0}, FrameDrawCalls{0}, FrameTriangles{0};
+    inline static FrameCounters LastFrameCounters;
+    inline static Clock::time_point FrameStart;
+};
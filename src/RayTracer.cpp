@@ -0,0 +1,346 @@
+#include "RayTracer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <limits>
+
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "DatasetConfig.h"
+#include "MoleculePrimitives.h"
+#include "Trace.h"
+
+using glm::vec3, glm::vec4, glm::mat4;
+
+static const QM9WithH DatasetConfig;
+static const uint MaxLayers = 8; // Translucent surfaces a camera ray can pass through.
+static const float RayOffset = 1e-3; // Secondary rays start this far off the surface, to avoid hitting it again.
+
+void RayTracer::Input::AddMolecule(const MoleculeData &data, float atom_scale, float bond_radius, bool bonds, const ElementMask &mask) {
+    for (const auto &primitive : GetMoleculePrimitives(data, atom_scale, bond_radius, false, mask)) {
+        const auto type = data.Types[primitive.Id];
+        const auto &color = DatasetConfig.ColorForAtom.at(type);
+        Primitives.push_back({primitive.A, primitive.B, primitive.Radius, uint(Primitives.size())});
+        Colors.push_back(mask.IsHighlighted(type) ? Highlight(color) : color);
+    }
+    if (!bonds) return;
+
+    // One capsule per cylinder `transform_vertex.glsl` draws, with multi-order bonds spread along their sides.
+    const auto sides = FindBondSides(data);
+    const float radius = 0.1f * bond_radius; // See `GetMoleculePrimitives`.
+    for (uint bond_index = 0; bond_index < data.Bonds.size(); bond_index++) {
+        const auto &bond = data.Bonds[bond_index];
+        if (mask.IsHidden(data.Types[bond.A]) || mask.IsHidden(data.Types[bond.B])) continue;
+
+        const vec3 a = data.GetPosition(bond.A), b = data.GetPosition(bond.B);
+        if (bond.Order <= 1) {
+            Primitives.push_back({a, b, radius, uint(Primitives.size())});
+            Colors.push_back(vec4{1});
+            continue;
+        }
+        for (uint copy = 0; copy < bond.Order; copy++) {
+            const vec3 offset = sides[bond_index] * ((copy - (bond.Order - 1) * 0.5f) * MultiBondSpacing * radius);
+            Primitives.push_back({a + offset, b + offset, radius * MultiBondThickness, uint(Primitives.size())});
+            Colors.push_back(vec4{1});
+        }
+    }
+}
+
+// Small, fast generator, seeded per pixel and pass.
+struct Random {
+    Random(uint x, uint y, uint pass) : State(Hash(x ^ Hash(y ^ Hash(pass)))) {}
+
+    float Next() { // In [0, 1).
+        State = Hash(State);
+        return float(State >> 8) / float(1u << 24);
+    }
+
+private:
+    uint State;
+
+    // PCG hash, from Jarzynski & Olano, "Hash Functions for GPU Rendering" (2020).
+    static uint Hash(uint value) {
+        const uint state = value * 747796405u + 2891336453u;
+        const uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        return (word >> 22u) ^ word;
+    }
+};
+
+static vec3 RandomInUnitSphere(Random &random) {
+    const float z = random.Next() * 2 - 1, angle = random.Next() * 2 * float(M_PI);
+    const float r = std::sqrt(std::max(1 - z * z, 0.f));
+    return vec3{r * std::cos(angle), r * std::sin(angle), z} * std::cbrt(random.Next());
+}
+
+// Cosine-weighted direction in the hemisphere around `normal`.
+static vec3 RandomInHemisphere(const vec3 &normal, Random &random) {
+    const vec3 tangent = glm::normalize(glm::cross(std::abs(normal.x) > 0.5f ? vec3{0, 1, 0} : vec3{1, 0, 0}, normal));
+    const vec3 bitangent = glm::cross(normal, tangent);
+    const float r = std::sqrt(random.Next()), angle = random.Next() * 2 * float(M_PI);
+    return glm::normalize(tangent * (r * std::cos(angle)) + bitangent * (r * std::sin(angle)) + normal * std::sqrt(std::max(1 - r * r, 0.f)));
+}
+
+static vec3 ComputeNormal(const PickingBvh::Primitive &primitive, const vec3 &position) {
+    if (primitive.A == primitive.B) return glm::normalize(position - primitive.A);
+
+    const vec3 ab = primitive.B - primitive.A;
+    const float t = std::clamp(glm::dot(position - primitive.A, ab) / glm::dot(ab, ab), 0.f, 1.f);
+    return glm::normalize(position - (primitive.A + ab * t));
+}
+
+// Same falloff as `attenuation` in fragment.glsl.
+static float Attenuation(float distance, float radius) {
+    if (radius <= 0) return 1;
+    const float ratio = distance / radius;
+    const float window = std::clamp(1 - ratio * ratio * ratio * ratio, 0.f, 1.f);
+    return window * window / (1 + distance * distance);
+}
+
+RayTracer::RayTracer(Input &&input, const Settings &settings) : Config(settings), In(std::move(input)) {
+    Bvh.Build(In.Primitives);
+
+    const mat4 projection = glm::perspective(glm::radians(In.fov), float(Config.Width) / float(std::max(Config.Height, 1u)), 0.1f, 1000.f);
+    InverseViewProjection = glm::inverse(projection * In.CameraView);
+
+    TileColumns = (Config.Width + TileSize - 1) / TileSize;
+    NumTiles = std::max(TileColumns * ((Config.Height + TileSize - 1) / TileSize), 1u);
+    Accumulation.assign(size_t(Config.Width) * Config.Height, vec4{0});
+    TileSamples.assign(NumTiles, 0);
+    TileMutexes = std::make_unique<std::mutex[]>(NumTiles);
+
+    StartTime = std::chrono::steady_clock::now();
+    const uint num_threads = Config.NumThreads > 0 ? Config.NumThreads : std::max(std::thread::hardware_concurrency(), 1u);
+    ActiveWorkers = num_threads;
+    for (uint i = 0; i < num_threads; i++) Workers.emplace_back(&RayTracer::Work, this);
+}
+
+RayTracer::~RayTracer() { Cancel(); }
+
+void RayTracer::Cancel() {
+    Cancelled = true;
+    Wait();
+}
+
+void RayTracer::Wait() {
+    for (auto &worker : Workers) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+float RayTracer::GetProgress() const {
+    const uint total = NumTiles * Config.Samples;
+    return total == 0 ? 1 : float(CompletedWork.load()) / float(total);
+}
+
+float RayTracer::GetElapsedSeconds() const {
+    const int64_t finished_ns = FinishedNs.load();
+    if (finished_ns >= 0) return finished_ns / 1e9f;
+    return std::chrono::duration<float>(std::chrono::steady_clock::now() - StartTime).count();
+}
+
+void RayTracer::Work() {
+    Trace::SetThreadName("Ray tracer");
+    std::vector<vec4> samples(TileSize * TileSize);
+    const uint total = NumTiles * Config.Samples;
+    for (uint work; !Cancelled && (work = NextWork++) < total;) {
+        RenderTile(work % NumTiles, work / NumTiles, samples);
+        CompletedWork++;
+    }
+    if (--ActiveWorkers == 0) {
+        FinishedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - StartTime).count();
+    }
+}
+
+void RayTracer::RenderTile(uint tile, uint pass, std::vector<vec4> &samples) {
+    Trace::Scope trace{"Ray trace tile", "render"};
+    const uint x0 = (tile % TileColumns) * TileSize, y0 = (tile / TileColumns) * TileSize;
+    const uint x1 = std::min(x0 + TileSize, Config.Width), y1 = std::min(y0 + TileSize, Config.Height);
+    // Whole quads, then any last column and row at the image edge.
+    const uint quads_x1 = x0 + (x1 - x0) / 2 * 2, quads_y1 = y0 + (y1 - y0) / 2 * 2;
+    for (uint y = y0; y < quads_y1; y += 2) {
+        for (uint x = x0; x < quads_x1; x += 2) {
+            const auto quad = TracePixelQuad(x, y, pass);
+            for (uint i = 0; i < 4; i++) samples[(y + i / 2 - y0) * TileSize + (x + i % 2 - x0)] = quad[i];
+        }
+    }
+    for (uint y = y0; y < y1; y++) {
+        for (uint x = y < quads_y1 ? quads_x1 : x0; x < x1; x++) samples[(y - y0) * TileSize + (x - x0)] = TracePixel(x, y, pass);
+    }
+
+    // Trace without the lock, and only hold it to add the samples.
+    std::lock_guard lock{TileMutexes[tile]};
+    for (uint y = y0; y < y1; y++) {
+        for (uint x = x0; x < x1; x++) Accumulation[size_t(y) * Config.Width + x] += samples[(y - y0) * TileSize + (x - x0)];
+    }
+    TileSamples[tile]++;
+}
+
+// Through a random point in the pixel, for anti-aliasing. Rows are top-first, and normalized device y points up.
+static Ray GetCameraRay(const mat4 &inverse_view_projection, uint width, uint height, uint x, uint y, Random &random) {
+    const float ndc_x = (x + random.Next()) / width * 2 - 1, ndc_y = 1 - (y + random.Next()) / height * 2;
+    const vec4 near = inverse_view_projection * vec4{ndc_x, ndc_y, -1, 1}, far = inverse_view_projection * vec4{ndc_x, ndc_y, 1, 1};
+    const vec3 origin = vec3(near) / near.w;
+    return {origin, glm::normalize(vec3(far) / far.w - origin)};
+}
+
+// Premultiplied color along a camera ray, given its first hit, composited over the background.
+static vec4 Shade(const RayTracer::Input &in, const RayTracer::Settings &config, const PickingBvh &bvh, const Ray &ray, std::optional<PickingBvh::Hit> hit, Random &random) {
+    vec3 color{0};
+    float transmittance = 1;
+    float min_distance = 0;
+    for (uint layer = 0; layer < MaxLayers && transmittance > 1.f / 255.f; layer++) {
+        if (layer > 0) hit = bvh.Intersect(ray, min_distance);
+        if (!hit) break;
+
+        min_distance = hit->Distance + RayOffset;
+        const vec3 position = ray.Origin + ray.Direction * hit->Distance;
+        const vec3 normal = ComputeNormal(in.Primitives[hit->Id], position);
+        if (glm::dot(normal, ray.Direction) > 0) continue; // Leaving a translucent primitive.
+
+        // Ambient light, occluded by anything within `OcclusionDistance` in a cosine-weighted direction.
+        const vec3 surface = position + normal * RayOffset;
+        float ambient_visibility = 1;
+        if (config.OcclusionDistance > 0 && bvh.Occluded({surface, RandomInHemisphere(normal, random)}, config.OcclusionDistance)) ambient_visibility = 0;
+        vec3 lighting = vec3(in.AmbientColor) * ambient_visibility;
+        for (const auto &light : in.Lights) {
+            const bool directional = light.Position.w == 0;
+            const vec3 light_position = directional ? vec3{0} : vec3(light.Position) / light.Position.w + RandomInUnitSphere(random) * config.LightSize;
+            const vec3 to_light = directional ? vec3(light.Position) : light_position - surface;
+            const float distance = glm::length(to_light);
+            if (distance <= 0) continue;
+
+            const vec3 direction = to_light / distance;
+            const float lambert = glm::dot(normal, direction);
+            if (lambert <= 0) continue;
+
+            const float attenuation = directional ? 1 : Attenuation(distance, light.Radius);
+            if (attenuation <= 0 || bvh.Occluded({surface, direction}, directional ? std::numeric_limits<float>::max() : distance)) continue;
+
+            const vec3 half_vector = glm::normalize(direction - ray.Direction);
+            const float phong = std::pow(std::max(glm::dot(normal, half_vector), 0.f), in.Shininess);
+            lighting += (vec3(in.DiffuseColor) * lambert + vec3(in.SpecularColor) * phong) * vec3(light.Color) * attenuation;
+        }
+
+        const vec4 &surface_color = in.Colors[hit->Id];
+        const float alpha = std::clamp(surface_color.a, 0.f, 1.f);
+        color += transmittance * alpha * lighting * vec3(surface_color);
+        transmittance *= 1 - alpha;
+    }
+
+    const float background_alpha = transmittance * in.BackgroundColor.a;
+    return {color + vec3(in.BackgroundColor) * background_alpha, 1 - transmittance + background_alpha};
+}
+
+vec4 RayTracer::TracePixel(uint x, uint y, uint pass) const {
+    Random random{x, y, pass};
+    const Ray ray = GetCameraRay(InverseViewProjection, Config.Width, Config.Height, x, y, random);
+    return Shade(In, Config, Bvh, ray, Bvh.Intersect(ray), random);
+}
+
+std::array<vec4, 4> RayTracer::TracePixelQuad(uint x, uint y, uint pass) const {
+    std::array<Random, 4> randoms{Random{x, y, pass}, Random{x + 1, y, pass}, Random{x, y + 1, pass}, Random{x + 1, y + 1, pass}};
+    std::array<Ray, 4> rays;
+    for (uint i = 0; i < 4; i++) rays[i] = GetCameraRay(InverseViewProjection, Config.Width, Config.Height, x + i % 2, y + i / 2, randoms[i]);
+    const auto hits = Bvh.IntersectPacket(rays);
+    std::array<vec4, 4> samples;
+    for (uint i = 0; i < 4; i++) samples[i] = Shade(In, Config, Bvh, rays[i], hits[i], randoms[i]);
+    return samples;
+}
+
+std::vector<uint8_t> RayTracer::GetImage() const {
+    std::vector<uint8_t> rgba(size_t(Config.Width) * Config.Height * 4, 0);
+    const auto to_byte = [](float value) { return uint8_t(std::clamp(value, 0.f, 1.f) * 255.f + 0.5f); };
+    for (uint tile = 0; tile < NumTiles; tile++) {
+        const uint x0 = (tile % TileColumns) * TileSize, y0 = (tile / TileColumns) * TileSize;
+        const uint x1 = std::min(x0 + TileSize, Config.Width), y1 = std::min(y0 + TileSize, Config.Height);
+        std::lock_guard lock{TileMutexes[tile]};
+        if (TileSamples[tile] == 0) continue;
+
+        const float scale = 1.f / TileSamples[tile];
+        for (uint y = y0; y < y1; y++) {
+            for (uint x = x0; x < x1; x++) {
+                const size_t i = size_t(y) * Config.Width + x;
+                const vec4 average = Accumulation[i] * scale;
+                const vec3 straight = average.a > 0 ? vec3(average) / average.a : vec3{0};
+                for (uint c = 0; c < 3; c++) rgba[i * 4 + c] = to_byte(straight[c]);
+                rgba[i * 4 + 3] = to_byte(average.a);
+            }
+        }
+    }
+    return rgba;
+}
+
+static uint Crc32(const uint8_t *data, size_t size, uint crc = 0) {
+    static const auto Table = [] {
+        std::array<uint, 256> table;
+        for (uint i = 0; i < 256; i++) {
+            uint c = i;
+            for (uint k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        return table;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) crc = Table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void AppendBigEndian(std::vector<uint8_t> &bytes, uint value) {
+    for (int shift = 24; shift >= 0; shift -= 8) bytes.push_back(uint8_t(value >> shift));
+}
+
+bool WritePng(const fs::path &path, const std::vector<uint8_t> &rgba, uint width, uint height) {
+    if (rgba.size() != size_t(width) * height * 4) return false;
+
+    // Each row is prefixed with its filter type (0: none).
+    std::vector<uint8_t> raw;
+    raw.reserve(size_t(width * 4 + 1) * height);
+    for (uint y = 0; y < height; y++) {
+        raw.push_back(0);
+        raw.insert(raw.end(), rgba.begin() + size_t(y) * width * 4, rgba.begin() + size_t(y + 1) * width * 4);
+    }
+
+    // zlib stream of stored deflate blocks.
+    std::vector<uint8_t> zlib{0x78, 0x01};
+    static const size_t MaxBlockSize = 65535;
+    size_t offset = 0;
+    do {
+        const uint16_t size = std::min(MaxBlockSize, raw.size() - offset), inverse_size = ~size;
+        zlib.push_back(offset + size == raw.size() ? 1 : 0); // Final block flag.
+        zlib.insert(zlib.end(), {uint8_t(size), uint8_t(size >> 8), uint8_t(inverse_size), uint8_t(inverse_size >> 8)});
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+        offset += size;
+    } while (offset < raw.size());
+    uint a = 1, b = 0; // Adler-32
+    for (const uint8_t byte : raw) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    AppendBigEndian(zlib, (b << 16) | a);
+
+    std::ofstream file{path, std::ios::binary};
+    if (!file) return false;
+
+    static const uint8_t Signature[]{0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    file.write((const char *)Signature, sizeof(Signature));
+    const auto write_chunk = [&file](const char *type, const std::vector<uint8_t> &data) {
+        std::vector<uint8_t> chunk;
+        AppendBigEndian(chunk, data.size());
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+        AppendBigEndian(chunk, Crc32(chunk.data() + 4, chunk.size() - 4));
+        file.write((const char *)chunk.data(), chunk.size());
+    };
+    std::vector<uint8_t> header;
+    AppendBigEndian(header, width);
+    AppendBigEndian(header, height);
+    header.insert(header.end(), {8, 6, 0, 0, 0}); // 8-bit RGBA, default compression, filtering and no interlacing.
+    write_chunk("IHDR", header);
+    write_chunk("IDAT", zlib);
+    write_chunk("IEND", {});
+    return bool(file);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/mat4x4.hpp>
+
+#include "Light.h"
+#include "MoleculeData.h"
+#include "Picking.h"
+
+namespace fs = std::filesystem;
+
+// Offline CPU renderer for high-quality stills, with soft shadows and ambient occlusion.
+// GL-free, so it runs on machines without a GPU (see `tool/RenderStill.cpp`) as well as in the app (_File->Export high-quality image_).
+// Rays are intersected with analytic spheres and capsules in a `PickingBvh`, and shaded like `fragment.glsl`,
+// with each light sampled over a small sphere (soft shadows), and ambient light occluded by nearby surfaces (one ray per sample).
+// Rendering is progressive: each pass adds one jittered sample per pixel, so the image can be shown (and saved) at any point.
+// Camera rays of 2x2 pixel quads are traced as packets (see `PickingBvh::IntersectPacket`), and all other rays one at a time.
+// Worker threads take (pass, tile) work items from a shared counter, so faster threads take more tiles.
+// Samples are seeded by pixel and pass, so the result is the same for any number of threads.
+struct RayTracer {
+    // Everything shown. Defaults match `Scene`.
+    struct Input {
+        std::vector<PickingBvh::Primitive> Primitives; // Ids must be indices into `Primitives`.
+        std::vector<glm::vec4> Colors; // Per primitive. Translucent primitives are blended over what's behind them.
+        std::vector<Light> Lights;
+        glm::vec4 AmbientColor{0.4, 0.4, 0.4, 1}, DiffuseColor{0.5, 0.5, 0.5, 1}, SpecularColor{0, 0, 0, 1};
+        float Shininess{10};
+        glm::vec4 BackgroundColor{0}; // Transparent by default. Saved images keep the alpha channel.
+        glm::mat4 CameraView{1};
+        float fov{50}; // Vertical, in degrees.
+
+        // Atom spheres colored by element, and white bond capsules (one per cylinder of multi-order bonds), as `Molecule` draws them.
+        // Elements are hidden and highlighted as the scene's shaders do.
+        void AddMolecule(const MoleculeData &, float atom_scale, float bond_radius, bool bonds, const ElementMask & = {});
+    };
+
+    struct Settings {
+        uint Width{1920}, Height{1080};
+        uint Samples{64}; // Per pixel. Each progressive pass adds one.
+        uint NumThreads{0}; // 0 for one per hardware thread.
+        float LightSize{0.5}; // Radius of the sphere each point light is sampled over. 0 for hard shadows.
+        float OcclusionDistance{1.5}; // Max length of ambient occlusion rays. 0 disables ambient occlusion.
+    };
+
+    inline static const uint TileSize = 16; // In pixels.
+
+    // Starts rendering on worker threads right away.
+    RayTracer(Input &&, const Settings &);
+    ~RayTracer(); // Cancels any remaining passes.
+
+    void Cancel(); // Returns after the workers have stopped. Samples so far are kept.
+    void Wait(); // Block until all passes are done (or cancelled).
+
+    bool IsDone() const { return ActiveWorkers.load() == 0; }
+    float GetProgress() const; // Fraction of all (pass, tile) work items done.
+    uint GetCompletedSamples() const { return CompletedWork.load() / NumTiles; } // Per pixel, in every tile.
+    float GetElapsedSeconds() const;
+
+    // Straight-alpha RGBA8 pixels, top row first, averaging the samples so far.
+    std::vector<uint8_t> GetImage() const;
+
+    const Settings Config;
+
+private:
+    void Work();
+    void RenderTile(uint tile, uint pass, std::vector<glm::vec4> &samples);
+    glm::vec4 TracePixel(uint x, uint y, uint pass) const; // Premultiplied color, composited over the background.
+    // Same samples as `TracePixel` for the 2x2 pixels from (x, y), row by row, with their camera rays traced as one packet.
+    std::array<glm::vec4, 4> TracePixelQuad(uint x, uint y, uint pass) const;
+
+    Input In;
+    PickingBvh Bvh;
+    glm::mat4 InverseViewProjection;
+
+    uint TileColumns, NumTiles;
+    // Sum of premultiplied samples per pixel, and the number of passes added to each tile.
+    // Each tile has its own lock, since a tile's next pass can finish while a slower thread is still adding its previous one.
+    std::vector<glm::vec4> Accumulation;
+    std::vector<uint> TileSamples;
+    std::unique_ptr<std::mutex[]> TileMutexes;
+
+    std::atomic<uint> NextWork{0}, CompletedWork{0}, ActiveWorkers{0};
+    std::atomic<bool> Cancelled{false};
+    std::chrono::steady_clock::time_point StartTime;
+    std::atomic<int64_t> FinishedNs{-1};
+    std::vector<std::thread> Workers;
+};
+
+// Uncompressed (stored) PNG, so no compression library is needed. Returns false if the file couldn't be written.
+bool WritePng(const fs::path &, const std::vector<uint8_t> &rgba, uint width, uint height);
@@ -1,6 +1,9 @@
 #include "Scene.h"
 
+#include <algorithm>
+#include <cmath>
 #include <format>
+#include <optional>
 #include <string>
 
 #include "GLCanvas.h"
@@ -9,36 +12,48 @@
 
 namespace UniformName {
 inline static const std::string
-    NumLights = "num_lights",
+    TileSize = "tile_size",
+    TileColumns = "tile_columns",
+    TileLights = "tile_lights",
+    LightIndices = "light_indices",
     AmbientColor = "ambient_color",
     DiffuseColor = "diffuse_color",
     SpecularColor = "specular_color",
     ShininessFactor = "shininess_factor",
     Projection = "projection",
     CameraView = "camera_view",
-    FlatShading = "flat_shading";
+    GridColumns = "grid_columns",
+    GridRows = "grid_rows",
+    GridSpacing = "grid_spacing",
+    InstanceTransforms = "instance_transforms",
+    InstanceColors = "instance_colors",
+    FlatShading = "flat_shading",
+    TransparencyPass = "transparency_pass";
 } // namespace UniformName
 
+// Named once, since profiler zones are looked up by name pointer.
+static const char *ScenePassZone = "Scene pass", *DepthPrePassZone = "Depth pre-pass";
+
+// Frames without changes before restoring full resolution.
+static const uint FramesToSettle = 8;
+
+static const float NearPlane = 0.1f;
+// Re-sort instances front to back when the eye moves by this fraction of the camera distance.
+static const float ResortDistance = 0.25f;
+// Texture units for the light tile lists. Units 0 and 1 are used by canvas post-process passes, and 4 and 5 by sorted meshes.
+static const uint TileLightsUnit = 2, LightIndicesUnit = 3;
+// Uniform block binding points, the same in every program.
+static const GLuint LightBlockBinding = 0, ElementMaskBlockBinding = 1;
+
+static void BindUniformBlock(const ShaderProgram &program, const char *name, GLuint binding) {
+    const GLuint index = glGetUniformBlockIndex(program.Id, name);
+    if (index != GL_INVALID_INDEX) glUniformBlockBinding(program.Id, index, binding);
+}
+
 Scene::Scene() {
     Canvas = std::make_unique<GLCanvas>();
 
-    /**
-      Initialize light positions using a three-point lighting system:
-        1) Key light: The main light, positioned at a 45-degree angle from the subject.
-        2) Fill light: Positioned opposite the key light to fill the shadows. It's less intense than the key light.
-        3) Back light: Positioned behind and above the subject to create a rim of light around the subject, separating it from the background.
-      We consider the "subject" to be the origin.
-    */
-    for (int _ = 0; _ < 3; _++) Lights.push_back({});
-    static const float dist_factor = 8.0f;
-
-    // Key light.
-    float key_light__angle = 1.f / 4.f; // Multiplied by pi.
-    Lights[0].Position = {dist_factor * __cospif(key_light__angle), 0, dist_factor * __sinpif(key_light__angle), 1};
-    // Fill light, twice as far away to make it less intense.
-    Lights[1].Position = {-dist_factor * __cospif(key_light__angle) * 2, 0, -dist_factor * __sinpif(key_light__angle) * 2, 1};
-    // Back light.
-    Lights[2].Position = {0, dist_factor * 1.5, -dist_factor, 1};
+    Lights = ThreePointLights();
 
     /**
       Initialize a right-handed coordinate system, with:
@@ -56,39 +71,51 @@ Scene::Scene() {
     namespace un = UniformName;
     static const fs::path ShaderDir = fs::path("res") / "shaders";
     static const Shader
-        TransformVertexShader{GL_VERTEX_SHADER, ShaderDir / "transform_vertex.glsl", {un::Projection, un::CameraView}},
-        FragmentShader{GL_FRAGMENT_SHADER, ShaderDir / "fragment.glsl", {un::NumLights, un::AmbientColor, un::DiffuseColor, un::SpecularColor, un::ShininessFactor, un::FlatShading}};
+        TransformVertexShader{GL_VERTEX_SHADER, ShaderDir / "transform_vertex.glsl", {un::Projection, un::CameraView, un::GridColumns, un::GridRows, un::GridSpacing, un::InstanceTransforms, un::InstanceColors}},
+        FragmentShader{GL_FRAGMENT_SHADER, ShaderDir / "fragment.glsl", {un::TileSize, un::TileColumns, un::TileLights, un::LightIndices, un::AmbientColor, un::DiffuseColor, un::SpecularColor, un::ShininessFactor, un::FlatShading, un::TransparencyPass}},
+        DepthFragmentShader{GL_FRAGMENT_SHADER, ShaderDir / "depth_fragment.glsl", {un::TransparencyPass}};
 
     MainShaderProgram = std::make_unique<ShaderProgram>(std::vector<const Shader *>{&TransformVertexShader, &FragmentShader});
+    DepthShaderProgram = std::make_unique<ShaderProgram>(std::vector<const Shader *>{&TransformVertexShader, &DepthFragmentShader});
+
+    for (const auto *program : {MainShaderProgram.get(), DepthShaderProgram.get()}) {
+        BindUniformBlock(*program, "LightBlock", LightBlockBinding);
+        BindUniformBlock(*program, "ElementMaskBlock", ElementMaskBlockBinding);
+    }
+    ElementMaskBuffer.Generate();
 
     CurrShaderProgram = MainShaderProgram.get();
     CurrShaderProgram->Use();
-
-    glGenBuffers(1, &LightBufferId);
-    glBindBuffer(GL_UNIFORM_BUFFER, LightBufferId);
-    glBufferData(GL_UNIFORM_BUFFER, sizeof(Light) * Lights.size(), Lights.data(), GL_STATIC_DRAW);
-
-    GLuint light_block_index = glGetUniformBlockIndex(CurrShaderProgram->Id, "LightBlock");
-    glBindBufferBase(GL_UNIFORM_BUFFER, light_block_index, LightBufferId);
 }
 
-Scene::~Scene() {
-    glDeleteBuffers(1, &LightBufferId);
+Scene::~Scene() = default;
+
+MemoryUsage Scene::GetMemoryUsage() const {
+    MemoryUsage usage = Canvas->GetMemoryUsage();
+    usage += Tiling.GetMemoryUsage();
+    usage.AddGpu(MemoryCategory::Uniforms, ElementMaskBuffer.Bytes);
+    for (const auto &[_, light_point] : LightPoints) usage += light_point->GetMemoryUsage();
+    return usage;
 }
 
-void Scene::AddMesh(Mesh *mesh) {
+void Scene::AddMesh(Mesh *mesh, uint viewport) {
     if (!mesh) return;
-    if (std::find(Meshes.begin(), Meshes.end(), mesh) != Meshes.end()) return;
+    if (viewport >= ViewportMeshes.size()) SetNumViewports(viewport + 1);
+
+    auto &meshes = ViewportMeshes[viewport];
+    if (std::find(meshes.begin(), meshes.end(), mesh) != meshes.end()) return;
 
-    Meshes.push_back(mesh);
+    meshes.push_back(mesh);
 }
 
 void Scene::RemoveMesh(const Mesh *mesh) {
     if (!mesh) return;
 
-    Meshes.erase(std::remove(Meshes.begin(), Meshes.end(), mesh), Meshes.end());
+    for (auto &meshes : ViewportMeshes) meshes.erase(std::remove(meshes.begin(), meshes.end(), mesh), meshes.end());
 }
 
+void Scene::SetNumViewports(uint num_viewports) { ViewportMeshes.resize(std::max(num_viewports, 1u)); }
+
 void Scene::SetCameraDistance(float distance) {
     // Extract the eye position from inverse camera view matrix and update the camera view based on the new distance.
     const glm::vec3 eye = glm::inverse(CameraView)[3];
@@ -96,31 +123,119 @@ void Scene::SetCameraDistance(float distance) {
     CameraDistance = distance;
 }
 
+void Scene::RemoveLight(uint index) {
+    if (index >= Lights.size()) return;
+
+    Lights.erase(Lights.begin() + index);
+    // Light points are keyed by light index, so shift the ones after it down.
+    std::unordered_map<uint, std::unique_ptr<Mesh>> light_points;
+    for (auto &[i, light_point] : LightPoints) {
+        if (i == index) RemoveMesh(light_point.get());
+        else light_points[i > index ? i - 1 : i] = std::move(light_point);
+    }
+    LightPoints = std::move(light_points);
+}
+
+void Scene::AddLightRing(uint count) {
+    // Small bounded lights of evenly spaced hues, circling the origin.
+    static const float RingRadius = 3, Radius = 2.5;
+    for (uint i = 0; i < count && Lights.size() < LightTiles::MaxLights; i++) {
+        const float angle = 2 * M_PI * i / count;
+        glm::vec4 color{1};
+        ImGui::ColorConvertHSVtoRGB(float(i) / count, 0.8f, 1.f, color.r, color.g, color.b);
+        Lights.push_back({{RingRadius * cosf(angle), 0, RingRadius * sinf(angle), 1}, color, Radius});
+    }
+}
+
 using namespace ImGui;
 
-void Scene::Render() {
-    const auto &io = ImGui::GetIO();
-    const bool window_hovered = IsWindowHovered();
-    if (window_hovered && io.MouseWheel != 0) {
-        SetCameraDistance(CameraDistance * (1.f - io.MouseWheel / 16.f));
+void Scene::SortMeshes() {
+    if (!SortFrontToBack) {
+        if (SortedEye) {
+            for (const auto &meshes : ViewportMeshes) {
+                for (auto *mesh : meshes) mesh->ClearDrawOrder();
+            }
+            SortedEye.reset();
+        }
+        return;
     }
-    const auto content_region = GetContentRegionAvail();
-    CameraProjection = glm::perspective(glm::radians(fov), content_region.x / content_region.y, 0.1f, 1000.f);
 
-    if (content_region.x <= 0 && content_region.y <= 0) return;
+    // Coarse order is enough, so only re-sort meshes that changed, or all of them once the eye has moved far enough.
+    const glm::vec3 eye = glm::inverse(CameraView)[3];
+    const bool eye_moved = !SortedEye || glm::distance(*SortedEye, eye) > ResortDistance * CameraDistance;
+    for (const auto &meshes : ViewportMeshes) {
+        for (auto *mesh : meshes) {
+            if (eye_moved || mesh->IsDirty()) mesh->SortFrontToBack(eye);
+        }
+    }
+    if (eye_moved) SortedEye = eye;
+}
 
-    const auto bg = GetStyleColorVec4(ImGuiCol_WindowBg);
-    Canvas->PrepareRender(content_region.x, content_region.y, bg.x, bg.y, bg.z, bg.w);
+Profiler::ZoneSample Scene::GetScenePassSample() const {
+    auto sample = Profiler::GetLatestSample(ScenePassZone, true);
+    if (DepthPrePass) sample.Ms += Profiler::GetLatestSample(DepthPrePassZone, true).Ms;
+    return sample;
+}
 
-    glBindBuffer(GL_UNIFORM_BUFFER, LightBufferId);
-    glBufferData(GL_UNIFORM_BUFFER, sizeof(Light) * Lights.size(), Lights.data(), GL_STATIC_DRAW);
+uint Scene::RenderCanvas(uint width, uint height, const glm::vec4 &background_color) {
+    Profiler::CpuZone cpu_zone{"Scene::RenderCanvas"};
+    // With a depth pre-pass, this times the pre-pass (and clear), and the rest of the scene pass gets its own zone below.
+    Profiler::GpuZone gpu_zone{DepthPrePass ? DepthPrePassZone : ScenePassZone};
 
-    CurrShaderProgram->Use();
+    const uint num_viewports = ViewportMeshes.size();
+    const uint viewport_width = std::max(width / num_viewports, 1u);
+    CameraProjection = glm::perspective(glm::radians(fov), float(viewport_width) / float(height), NearPlane, 1000.f);
+    Canvas->SetTransparency(Transparency);
+    Canvas->PrepareRender(width, height, background_color.r, background_color.g, background_color.b, background_color.a);
+
+    Tiling.Update(Lights, CameraView, CameraProjection, NearPlane, width, height, num_viewports);
+    // Other scenes (e.g. thumbnail renderers) share the binding points, so rebind our lights every render.
+    Tiling.Bind(LightBlockBinding, TileLightsUnit, LightIndicesUnit);
+    UpdateElementMaskBuffer();
+    glBindBufferBase(GL_UNIFORM_BUFFER, ElementMaskBlockBinding, ElementMaskBuffer.Id);
+
+    SortMeshes();
 
     namespace un = UniformName;
-    glUniformMatrix4fv(CurrShaderProgram->GetUniform(un::Projection), 1, GL_FALSE, &CameraProjection[0][0]);
-    glUniformMatrix4fv(CurrShaderProgram->GetUniform(un::CameraView), 1, GL_FALSE, &CameraView[0][0]);
-    glUniform1i(CurrShaderProgram->GetUniform(un::NumLights), Lights.size());
+    const bool transparency = Canvas->GetTransparency();
+    const auto set_vertex_uniforms = [&](const ShaderProgram &program) {
+        glUniformMatrix4fv(program.GetUniform(un::Projection), 1, GL_FALSE, &CameraProjection[0][0]);
+        glUniformMatrix4fv(program.GetUniform(un::CameraView), 1, GL_FALSE, &CameraView[0][0]);
+        glUniform1i(program.GetUniform(un::GridColumns), GridColumns);
+        glUniform1i(program.GetUniform(un::GridRows), GridRows);
+        glUniform1f(program.GetUniform(un::GridSpacing), GridSpacing);
+        glUniform1i(program.GetUniform(un::InstanceTransforms), Mesh::InstanceTransformsUnit);
+        glUniform1i(program.GetUniform(un::InstanceColors), Mesh::InstanceColorsUnit);
+        // With transparency, opaque fragments are drawn first, and translucent ones are then accumulated against their depth.
+        glUniform1i(program.GetUniform(un::TransparencyPass), transparency ? 1 : 0);
+    };
+    // All viewports share the same uniforms, so only the viewport changes between them.
+    const auto render_meshes = [&] {
+        for (uint viewport = 0; viewport < num_viewports; viewport++) {
+            if (num_viewports > 1) glViewport(viewport * viewport_width, 0, viewport_width, height);
+            for (auto *mesh : ViewportMeshes[viewport]) mesh->Render();
+        }
+    };
+
+    // Depth-only pre-pass, so the shading pass below only shades the nearest fragment of each pixel (with an equal depth test).
+    if (DepthPrePass) {
+        DepthShaderProgram->Use();
+        set_vertex_uniforms(*DepthShaderProgram);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        render_meshes();
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+        gpu_zone.End();
+    }
+    Profiler::GpuZone shading_gpu_zone{ScenePassZone}; // Ignored without a pre-pass, since `gpu_zone` is still active.
+
+    CurrShaderProgram->Use();
+    set_vertex_uniforms(*CurrShaderProgram);
+    glUniform1i(CurrShaderProgram->GetUniform(un::TileSize), LightTiles::TileSize);
+    glUniform1i(CurrShaderProgram->GetUniform(un::TileColumns), Tiling.GetTileColumns());
+    glUniform1i(CurrShaderProgram->GetUniform(un::TileLights), TileLightsUnit);
+    glUniform1i(CurrShaderProgram->GetUniform(un::LightIndices), LightIndicesUnit);
     glUniform4fv(CurrShaderProgram->GetUniform(un::AmbientColor), 1, &AmbientColor[0]);
     glUniform4fv(CurrShaderProgram->GetUniform(un::DiffuseColor), 1, &DiffusionColor[0]);
     glUniform4fv(CurrShaderProgram->GetUniform(un::SpecularColor), 1, &SpecularColor[0]);
@@ -128,14 +243,99 @@ void Scene::Render() {
     glUniform1i(CurrShaderProgram->GetUniform(un::FlatShading), FlatShading ? 1 : 0);
 
     // auto start_time = std::chrono::high_resolution_clock::now();
-    for (const auto *mesh : Meshes) mesh->Render();
+    Profiler::SamplesZone samples_zone{ShadedSamplesZone};
+    render_meshes();
+    samples_zone.End();
+    ShadedSampleLocations = uint64_t(width) * height * Canvas->GetSamplesPerPixel();
     // std::cout << "Draw time: " << std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start_time).count() << "us" << std::endl;
+    if (DepthPrePass) {
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
 
-    // Render the scene to an OpenGl texture and display it (without changing the cursor position).
+    bool any_translucent = false;
+    for (const auto &meshes : ViewportMeshes) {
+        for (const auto *mesh : meshes) any_translucent |= mesh->NumTranslucentInstances() > 0;
+    }
+    if (transparency && any_translucent) {
+        Canvas->BeginTransparentPass();
+        glUniform1i(CurrShaderProgram->GetUniform(un::TransparencyPass), 2);
+        for (uint viewport = 0; viewport < num_viewports; viewport++) {
+            if (num_viewports > 1) glViewport(viewport * viewport_width, 0, viewport_width, height);
+            for (auto *mesh : ViewportMeshes[viewport]) {
+                if (mesh->NumTranslucentInstances() > 0) mesh->Render();
+            }
+        }
+        Canvas->EndTransparentPass();
+    }
+
+    // The anti-aliasing pass is timed separately.
+    gpu_zone.End();
+    shading_gpu_zone.End();
+    return Canvas->Render();
+}
+
+void Scene::UpdateElementMaskBuffer() {
+    if (UploadedElements == Elements) return;
+
+    ElementMaskBuffer.SetData({{Elements.Hidden, Elements.Highlighted, 0, 0}}, GL_DYNAMIC_DRAW);
+    UploadedElements = Elements;
+}
+
+Scene::RenderInputs Scene::GetRenderInputs(uint width, uint height, const glm::vec4 &background_color) const {
+    return {
+        width, height, background_color, CameraView, fov, Lights,
+        AmbientColor, DiffusionColor, SpecularColor, Shininess, FlatShading, Transparency, DepthPrePass, SortFrontToBack,
+        AntiAliasingMode, DynamicResolution.DisableMsaa, GridColumns, GridRows, GridSpacing, Elements, ViewportMeshes,
+    };
+}
+
+bool Scene::Render() {
+    const auto &io = ImGui::GetIO();
+    const bool window_hovered = IsWindowHovered();
+    if (window_hovered && io.MouseWheel != 0) {
+        SetCameraDistance(CameraDistance * (1.f - io.MouseWheel / 16.f));
+    }
+    const auto content_region = GetContentRegionAvail();
+    MouseRay.reset();
+    if (content_region.x <= 0 && content_region.y <= 0) return false;
+
+    // The canvas keeps its last image, so only re-render when the result would differ.
+    const auto bg = GetStyleColorVec4(ImGuiCol_WindowBg);
+    auto inputs = GetRenderInputs(content_region.x, content_region.y, {bg.x, bg.y, bg.z, bg.w});
+    bool changed = inputs != LastRenderInputs;
+    for (const auto &meshes : ViewportMeshes) {
+        for (const auto *mesh : meshes) changed |= mesh->IsDirty();
+    }
+    UpdateRenderScale(changed, inputs.CameraView != LastRenderInputs.CameraView);
+
+    const bool rerender = changed || CanvasTextureId == 0 || RenderScale != RenderedScale;
+    if (rerender) {
+        const bool drop_msaa = DynamicResolution.DisableMsaa && RenderScale < 1 && AntiAliasingMode == AntiAliasing::Msaa;
+        Canvas->SetAntiAliasing(drop_msaa ? AntiAliasing::None : AntiAliasingMode);
+        const uint width = std::max(1u, uint(inputs.Width * RenderScale)), height = std::max(1u, uint(inputs.Height * RenderScale));
+        CanvasTextureId = RenderCanvas(width, height, inputs.BackgroundColor);
+        LastRenderInputs = std::move(inputs);
+        RenderedScale = RenderScale;
+    }
+    UpdateAntiAliasingCosts();
+
+    // Display the rendered texture (without changing the cursor position), stretched to the window if rendered at a reduced scale.
     const auto &cursor = GetCursorPos();
-    unsigned int texture_id = Canvas->Render();
-    Image((void *)(intptr_t)texture_id, content_region, {0, 1}, {1, 0});
+    Image((void *)(intptr_t)CanvasTextureId, content_region, {0, Canvas->GetTextureV()}, {Canvas->GetTextureU(), 0});
     SetCursorPos(cursor);
+    UpdateMouseRay(GetItemRectMin(), content_region);
+
+    if (ViewportMeshes.size() > 1 || !ViewportLabels.empty()) {
+        const auto &image_min = GetItemRectMin();
+        const float viewport_width = std::floor(content_region.x / ViewportMeshes.size());
+        auto *draw_list = GetWindowDrawList();
+        for (uint viewport = 0; viewport < ViewportMeshes.size(); viewport++) {
+            const ImVec2 viewport_min = image_min + ImVec2{viewport * viewport_width, 0};
+            if (viewport > 0) draw_list->AddLine(viewport_min, viewport_min + ImVec2{0, content_region.y}, GetColorU32(ImGuiCol_Separator), 2);
+            if (viewport < ViewportLabels.size()) draw_list->AddText(viewport_min + GetStyle().WindowPadding, GetColorU32(ImGuiCol_Text), ViewportLabels[viewport].c_str());
+        }
+    }
 
     // Render ImGuizmo.
     const auto &window_pos = GetWindowPos();
@@ -149,12 +349,128 @@ void Scene::Render() {
         const auto view_manipulate_pos = window_pos + ImVec2{GetWindowContentRegionMax().x - ViewManipulateSize, GetWindowContentRegionMin().y};
         ImGuizmo::ViewManipulate(&CameraView[0][0], CameraDistance, view_manipulate_pos, {ViewManipulateSize, ViewManipulateSize}, 0);
     }
+    return rerender || RenderScale < 1;
+}
+
+void Scene::UpdateMouseRay(const ImVec2 &image_min, const ImVec2 &image_size) {
+    const auto &io = ImGui::GetIO();
+    const ImVec2 mouse = io.MousePos - image_min;
+    if (!IsWindowHovered() || mouse.x < 0 || mouse.y < 0 || mouse.x >= image_size.x || mouse.y >= image_size.y) return;
+
+    // Unproject through the viewport under the mouse. All viewports share the camera.
+    const float viewport_width = image_size.x / ViewportMeshes.size();
+    const uint viewport = std::min(uint(mouse.x / viewport_width), uint(ViewportMeshes.size() - 1));
+    const glm::vec2 ndc{2 * (mouse.x - viewport * viewport_width) / viewport_width - 1, 1 - 2 * mouse.y / image_size.y};
+    const glm::mat4 inverse_view_projection = glm::inverse(CameraProjection * CameraView);
+    const glm::vec4 near = inverse_view_projection * glm::vec4{ndc, -1, 1}, far = inverse_view_projection * glm::vec4{ndc, 1, 1};
+    const glm::vec3 origin = glm::vec3(near) / near.w;
+    MouseRay = ViewportRay{{origin, glm::normalize(glm::vec3(far) / far.w - origin)}, viewport, IsMouseClicked(ImGuiMouseButton_Left)};
+}
+
+void Scene::UpdateRenderScale(bool changed, bool camera_moved) {
+    if (!DynamicResolution.Enabled) {
+        RenderScale = 1;
+        return;
+    }
+    if (!changed) {
+        if (RenderScale < 1 && ++FramesSinceChange >= FramesToSettle) RenderScale = 1;
+        return;
+    }
+
+    FramesSinceChange = 0;
+    if (camera_moved) RenderScale = std::min(RenderScale, DynamicResolution.MotionScale);
+    // GPU timings arrive a few frames late, so only act on each one once.
+    const auto pass = GetScenePassSample();
+    if (pass.Count != BudgetSampleCount) {
+        BudgetSampleCount = pass.Count;
+        // Cost is roughly proportional to the pixel count, which goes with the square of the scale.
+        if (pass.Ms > DynamicResolution.BudgetMs) RenderScale *= std::sqrt(DynamicResolution.BudgetMs / pass.Ms);
+    }
+    RenderScale = std::clamp(RenderScale, DynamicResolution.MinScale, 1.f);
+}
+
+void Scene::UpdateAntiAliasingCosts() {
+    // Scene pass timings arrive a few frames late, so they're attributed to the wrong mode for a few frames after switching.
+    const auto scene_pass = GetScenePassSample();
+    if (scene_pass.Count != CostSampleCount) {
+        CostSampleCount = scene_pass.Count;
+        AntiAliasingCosts[size_t(Canvas->GetAntiAliasing())].ScenePassMs = scene_pass.Ms;
+    }
+    for (size_t i = 0; i < AntiAliasingCosts.size(); i++) {
+        if (const char *zone = GLCanvas::GetAntiAliasingZone(AntiAliasing(i))) {
+            AntiAliasingCosts[i].AntiAliasingPassMs = Profiler::GetLatestSample(zone, true).Ms;
+        }
+    }
+}
+
+void Scene::RenderAntiAliasingConfig() {
+    SeparatorText("Anti-aliasing");
+    if (BeginTable("AntiAliasing", 4, ImGuiTableFlags_SizingStretchProp)) {
+        TableSetupColumn("Mode");
+        TableSetupColumn("Scene pass");
+        TableSetupColumn("AA pass");
+        TableSetupColumn("Memory");
+        TableHeadersRow();
+        // Memory is estimated for the current allocation, so modes compare at the same size.
+        const uint width = Canvas->GetAllocatedWidth(), height = Canvas->GetAllocatedHeight();
+        for (size_t i = 0; i < AntiAliasingCosts.size(); i++) {
+            const auto mode = AntiAliasing(i);
+            const auto &cost = AntiAliasingCosts[i];
+            TableNextRow();
+            TableNextColumn();
+            if (RadioButton(AntiAliasingNames[i], AntiAliasingMode == mode)) AntiAliasingMode = mode;
+            TableNextColumn();
+            if (cost.ScenePassMs > 0) Text("%.2f ms", cost.ScenePassMs);
+            else TextDisabled("-");
+            TableNextColumn();
+            if (GLCanvas::GetAntiAliasingZone(mode) == nullptr) TextDisabled("none");
+            else if (cost.AntiAliasingPassMs > 0) Text("%.2f ms", cost.AntiAliasingPassMs);
+            else TextDisabled("-");
+            TableNextColumn();
+            TextUnformatted(FormatBytes(GLCanvas::EstimateBytes(width, height, mode, Transparency)).c_str());
+        }
+        EndTable();
+    }
+    if (Canvas->GetAntiAliasing() != AntiAliasingMode) TextDisabled("Using %s while scaled down.", AntiAliasingNames[size_t(Canvas->GetAntiAliasing())]);
+    TextDisabled("Times are the latest GPU measurements with each mode.");
+}
+
+void Scene::RenderOverdrawConfig() {
+    SeparatorText("Overdraw");
+    Checkbox("Depth pre-pass", &DepthPrePass);
+    if (IsItemHovered()) SetTooltip("Draw depth only first, then shade only the nearest fragment of each pixel.");
+    SameLine();
+    Checkbox("Sort front to back", &SortFrontToBack);
+    if (IsItemHovered()) SetTooltip("Draw nearer instances first, so hidden fragments fail the depth test before shading.");
+
+    if (DepthPrePass) Text("Depth pre-pass: %.2f ms", Profiler::GetLatestSample(DepthPrePassZone, true).Ms);
+    Text("Shading pass: %.2f ms", Profiler::GetLatestSample(ScenePassZone, true).Ms);
+    const auto shaded = Profiler::GetLatestSamplesPassed(ShadedSamplesZone);
+    if (shaded.Count > 0 && ShadedSampleLocations > 0) {
+        Text("Shaded samples: %llu (%.2f per %s)", (unsigned long long)shaded.Value, double(shaded.Value) / ShadedSampleLocations, Canvas->GetSamplesPerPixel() > 1 ? "sample" : "pixel");
+        if (IsItemHovered()) SetTooltip("Opaque samples passing the depth test in the shading pass, relative to the canvas size.\nWith a depth pre-pass, each covered sample is shaded once. Anything more without one is overdraw.");
+    }
 }
 
 void Scene::RenderConfig() {
     if (BeginTabBar("SceneConfig")) {
         if (BeginTabItem("Geometries")) {
             Checkbox("Flat shading", &FlatShading);
+            Checkbox("Transparency", &Transparency);
+            if (IsItemHovered()) SetTooltip("Blend translucent instances (e.g. hydrogen atoms) with order-independent transparency.\nWhen off, all instances are drawn opaque.");
+            EndTabItem();
+        }
+        if (BeginTabItem("Quality")) {
+            Checkbox("Dynamic resolution", &DynamicResolution.Enabled);
+            if (!DynamicResolution.Enabled) BeginDisabled();
+            SliderFloat("Motion scale", &DynamicResolution.MotionScale, 0.5f, 1.f, "%.2f");
+            SliderFloat("Min scale", &DynamicResolution.MinScale, 0.5f, 1.f, "%.2f");
+            SliderFloat("GPU budget (ms)", &DynamicResolution.BudgetMs, 1.f, 33.f, "%.1f");
+            Checkbox("Disable MSAA while scaled", &DynamicResolution.DisableMsaa);
+            if (!DynamicResolution.Enabled) EndDisabled();
+            Text("Rendering %u x %u (%.0f%%)", Canvas->GetWidth(), Canvas->GetHeight(), RenderScale * 100);
+            RenderAntiAliasingConfig();
+            RenderOverdrawConfig();
             EndTabItem();
         }
         if (BeginTabItem("Camera")) {
@@ -188,10 +504,21 @@ void Scene::RenderConfig() {
             SliderFloat("Shininess", &Shininess, 0.0f, 150.0f);
 
             SeparatorText("Lights");
+            if (Lights.size() >= LightTiles::MaxLights) BeginDisabled();
+            if (Button("Add light")) Lights.push_back({{0, 0, 0, 1}, {1, 1, 1, 1}, 4});
+            SameLine();
+            if (Button("Add ring of 16")) AddLightRing(16);
+            if (Lights.size() >= LightTiles::MaxLights) EndDisabled();
+            if (Tiling.GetNumTiles() > 0) {
+                TextDisabled("%zu lights, %.1f per %ux%u tile on average", Lights.size(), float(Tiling.GetNumTileLights()) / Tiling.GetNumTiles(), LightTiles::TileSize, LightTiles::TileSize);
+            }
+            std::optional<size_t> remove_light;
             for (size_t i = 0; i < Lights.size(); i++) {
                 Separator();
                 PushID(i);
                 Text("Light %d", int(i + 1));
+                SameLine();
+                if (SmallButton("Remove")) remove_light = i;
                 bool show_lights = LightPoints.contains(i);
                 if (Checkbox("Show", &show_lights)) {
                     if (show_lights) {
@@ -211,8 +538,10 @@ void Scene::RenderConfig() {
                 if (ColorEdit3("Color", &Lights[i].Color[0]) && LightPoints.contains(i)) {
                     LightPoints[i]->SetColor(Lights[i].Color);
                 }
+                SliderFloat("Radius", &Lights[i].Radius, 0, 20, Lights[i].Radius <= 0 ? "Unbounded" : "%.2f");
                 PopID();
             }
+            if (remove_light) RemoveLight(*remove_light);
             EndTabItem();
         }
         EndTabBar();
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <array>
 #include <functional>
+#include <optional>
+#include <string>
 #include <unordered_map>
 
 #define IMGUI_DEFINE_MATH_OPERATORS
@@ -8,53 +11,161 @@
 
 #include "ImGuizmo.h"
 
+#include "GLCanvas.h"
+#include "Lights.h"
 #include "Mesh/Mesh.h"
+#include "MoleculeData.h"
+#include "Picking.h"
+#include "Profiler.h"
 
-struct GLCanvas;
 struct ShaderProgram;
 struct Rect;
 struct Physics;
 
-struct Light {
-    glm::vec4 Position{0.0f};
-    glm::vec4 Color{1.0f};
-};
-
 struct Scene {
     Scene();
     ~Scene();
 
-    void AddMesh(Mesh *);
-    void RemoveMesh(const Mesh *);
+    void AddMesh(Mesh *, uint viewport = 0);
+    void RemoveMesh(const Mesh *); // Removes the mesh from all viewports.
+    void SetNumViewports(uint);
 
-    void Render();
+    // Render the scene into the current ImGui window, along with the camera gizmo.
+    // The canvas is only re-rendered if something it shows has changed.
+    // Returns true if it was, or if it's still at reduced resolution (so it needs more frames to settle).
+    bool Render();
     void RenderConfig();
 
+    // Render all meshes into `Canvas` with the current camera, without any ImGui calls. Returns the canvas texture id.
+    uint RenderCanvas(uint width, uint height, const glm::vec4 &background_color);
+
     void SetCameraDistance(float);
 
-    std::vector<Mesh *> Meshes;
+    void RemoveLight(uint index);
+    void AddLightRing(uint count);
+
+    MemoryUsage GetMemoryUsage() const; // Canvas and scene-owned meshes (not meshes added by others).
+
+    // Meshes to render in each viewport.
+    // Viewports split the canvas into equal-width columns sharing the camera, lights and geometry,
+    // all rendered in one pass into one frame buffer (e.g. to compare molecule chains side by side).
+    std::vector<std::vector<Mesh *>> ViewportMeshes{1};
+    std::vector<std::string> ViewportLabels; // Optional label shown at the top-left of each viewport.
 
-    GLuint LightBufferId;
-    std::vector<Light> Lights;
+    std::vector<Light> Lights; // Up to `LightTiles::MaxLights`.
+    LightTiles Tiling;
     glm::vec4 AmbientColor = {0.4, 0.4, 0.4, 1};
     // todo Diffusion and specular colors are object properties, not scene properties.
     glm::vec4 DiffusionColor = {0.5, 0.5, 0.5, 1};
     glm::vec4 SpecularColor = {0.0, 0.0, 0.0, 1}; // No specular by default.
     float Shininess = 10;
     bool CustomColors = false, FlatShading = false;
+    bool Transparency = true; // Weighted blended order-independent transparency for translucent instances (see `GLCanvas`).
 
     bool ShowCameraGizmo = true;
 
+    // Layout for instances tagged with a grid cell (see `MoleculeGrid`). Untagged instances are unaffected.
+    uint GridColumns = 1, GridRows = 1;
+    float GridSpacing = 0;
+
+    // Hidden and highlighted elements of instances tagged with them (see `Molecule::SetElements`), applied in the vertex shader.
+    // Changing them only updates a small uniform block, so it's instant for any number of instances.
+    ElementMask Elements;
+
     glm::mat4 CameraView, CameraProjection;
     float CameraDistance = 4, fov = 50;
 
+    // Render the canvas below window resolution while the camera moves, or while the scene pass is over its GPU time budget,
+    // and restore full resolution once the image stops changing.
+    struct DynamicResolutionSettings {
+        bool Enabled{false};
+        float MotionScale{0.75}; // Max render scale while the camera moves.
+        float MinScale{0.5};
+        float BudgetMs{8};
+        bool DisableMsaa{false}; // Also render without MSAA while scaled down.
+    };
+    DynamicResolutionSettings DynamicResolution;
+    float RenderScale{1}; // Fraction of the window resolution (per axis) currently rendered.
+
+    AntiAliasing AntiAliasingMode{AntiAliasing::Msaa};
+
+    // Overdraw reduction, for dense scenes with many overlapping instances.
+    bool DepthPrePass{false}; // Depth-only pass first, then shade with an equal depth test.
+    bool SortFrontToBack{false}; // Coarsely, per mesh (see `Mesh::SortFrontToBack`).
+    // Profiler samples zone counting the opaque samples shaded by each render (see `Profiler::GetLatestSamplesPassed`).
+    inline static const char *ShadedSamplesZone = "Shaded samples";
+
     inline static float Bounds[6] = {-0.5f, -0.5f, -0.5f, 0.5f, 0.5f, 0.5f};
 
-    std::unique_ptr<ShaderProgram> MainShaderProgram;
+    std::unique_ptr<ShaderProgram> MainShaderProgram, DepthShaderProgram;
 
     ShaderProgram *CurrShaderProgram = nullptr;
 
     std::unordered_map<uint, std::unique_ptr<Mesh>> LightPoints; // For visualizing light positions. Key is `Lights` index.
 
     std::unique_ptr<GLCanvas> Canvas;
+
+    // World-space ray under the mouse while it's over the canvas, updated by `Render`, for picking.
+    struct ViewportRay {
+        Ray WorldRay;
+        uint Viewport;
+        bool Clicked; // Left mouse button pressed this frame.
+    };
+    std::optional<ViewportRay> MouseRay;
+
+private:
+    // Everything the canvas image depends on, other than mesh data (see `Mesh::IsDirty`).
+    struct RenderInputs {
+        uint Width{0}, Height{0};
+        glm::vec4 BackgroundColor{0};
+        glm::mat4 CameraView{1};
+        float fov{0};
+        std::vector<Light> Lights;
+        glm::vec4 AmbientColor{0}, DiffusionColor{0}, SpecularColor{0};
+        float Shininess{0};
+        bool FlatShading{false}, Transparency{false}, DepthPrePass{false}, SortFrontToBack{false};
+        AntiAliasing AntiAliasingMode{AntiAliasing::None};
+        bool DisableMsaaWhileScaled{false};
+        uint GridColumns{1}, GridRows{1};
+        float GridSpacing{0};
+        ElementMask Elements;
+        std::vector<std::vector<Mesh *>> ViewportMeshes;
+
+        bool operator==(const RenderInputs &) const = default;
+    };
+    RenderInputs GetRenderInputs(uint width, uint height, const glm::vec4 &background_color) const;
+
+    void UpdateElementMaskBuffer();
+
+    // `Elements` as (hidden, highlighted, padding) for the `ElementMaskBlock` uniform block.
+    GLBuffer<glm::uvec4, GL_UNIFORM_BUFFER> ElementMaskBuffer{MemoryCategory::Uniforms};
+    std::optional<ElementMask> UploadedElements;
+
+    RenderInputs LastRenderInputs; // As of the last `Render` that re-rendered the canvas.
+    uint CanvasTextureId{0};
+
+    void UpdateRenderScale(bool changed, bool camera_moved);
+    void UpdateMouseRay(const ImVec2 &image_min, const ImVec2 &image_size);
+    // Latest GPU time of the whole scene pass, including any depth pre-pass.
+    Profiler::ZoneSample GetScenePassSample() const;
+
+    void SortMeshes();
+    void RenderOverdrawConfig();
+
+    std::optional<glm::vec3> SortedEye; // Eye position of the last full re-sort.
+    uint64_t ShadedSampleLocations{0}; // Pixels times samples per pixel, in the last render.
+
+    float RenderedScale{1};
+    uint FramesSinceChange{0};
+    uint64_t BudgetSampleCount{0}; // Scene pass timings already acted on.
+
+    // Latest measured GPU times with each anti-aliasing mode, to compare their costs.
+    struct AntiAliasingCost {
+        float ScenePassMs{0}, AntiAliasingPassMs{0};
+    };
+    void UpdateAntiAliasingCosts();
+    void RenderAntiAliasingConfig();
+
+    std::array<AntiAliasingCost, size_t(AntiAliasing::Count)> AntiAliasingCosts;
+    uint64_t CostSampleCount{0};
 };
@@ -4,6 +4,8 @@
 #include <fstream>
 #include <iostream>
 
+#include "Trace.h"
+
 // From https://stackoverflow.com/a/40903508/780425
 static std::string ReadFile(const fs::path path) {
     std::ifstream f(path, std::ios::in | std::ios::binary);
@@ -13,12 +15,19 @@ static std::string ReadFile(const fs::path path) {
     return result;
 }
 
-Shader::Shader(GLenum type, const fs::path path, std::unordered_set<std::string> uniform_names)
+Shader::Shader(GLenum type, const fs::path path, std::unordered_set<std::string> uniform_names, const std::vector<std::string> &defines)
     : UniformNames(uniform_names) {
+    Trace::Scope trace{"Compile shader", "shader"};
     std::string str = ReadFile(path);
+    if (!defines.empty()) {
+        std::string define_lines;
+        for (const auto &define : defines) define_lines += "#define " + define + "\n";
+        const auto version_end = str.find('\n');
+        str.insert(version_end == std::string::npos ? str.size() : version_end + 1, define_lines);
+    }
     const char *cstr = str.c_str();
 
-    Id = glCreateShader(type);
+    Id = GLShaderHandle(glCreateShader(type));
     glShaderSource(Id, 1, &cstr, nullptr);
     glCompileShader(Id);
 
@@ -3,14 +3,16 @@
 #include <filesystem>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
-#include <GL/glew.h>
+#include "GLHandle.h"
 
 namespace fs = std::filesystem;
 
 struct Shader {
-    Shader(GLenum type, const fs::path, std::unordered_set<std::string> uniform_names = {});
+    // `defines` are inserted after the `#version` line, for compiling variants of the same source.
+    Shader(GLenum type, const fs::path, std::unordered_set<std::string> uniform_names = {}, const std::vector<std::string> &defines = {});
 
-    GLuint Id;
+    GLShaderHandle Id;
     std::unordered_set<std::string> UniformNames;
 };
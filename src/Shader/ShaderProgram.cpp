@@ -3,9 +3,12 @@
 #include <format>
 #include <iostream>
 
+#include "Trace.h"
+
 ShaderProgram::ShaderProgram(std::vector<const Shader *> &&shaders)
     : Shaders(std::move(shaders)) {
-    Id = glCreateProgram();
+    Trace::Scope trace{"Link shader program", "shader"};
+    Id = GLProgramHandle(glCreateProgram());
     for (const auto *shader : Shaders) glAttachShader(Id, shader->Id);
 
     glLinkProgram(Id);
@@ -13,7 +13,7 @@ struct ShaderProgram {
 
     inline GLuint GetUniform(const std::string &name) const { return Uniforms.at(name); }
 
-    GLuint Id;
+    GLProgramHandle Id;
     std::vector<const Shader *> Shaders;
     std::unordered_map<std::string, GLuint> Uniforms;
 };
@@ -0,0 +1,98 @@
+#pragma once
+
+// Define `SIMD_SCALAR` to use the scalar fallback everywhere (e.g. to compare).
+#if defined(SIMD_SCALAR)
+#include <algorithm>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SIMD_NEON
+#else
+#include <algorithm>
+#endif
+
+// Four floats operated on together, with SSE2 or NEON where available, and plain scalar code otherwise.
+// Only what packet ray traversal and alignment sums need (see `PickingBvh::IntersectPacket` and `AlignFrame`).
+// Comparisons return per-lane masks, combined with `&`/`|` and read with `Bits`.
+struct Float4 {
+#if defined(SIMD_SSE2)
+    __m128 V;
+
+    Float4() = default;
+    Float4(__m128 v) : V(v) {}
+    Float4(float value) : V(_mm_set1_ps(value)) {}
+    static Float4 Load(const float *values) { return _mm_loadu_ps(values); }
+    void Store(float *values) const { _mm_storeu_ps(values, V); }
+
+    friend Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.V, b.V); }
+    friend Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.V, b.V); }
+    friend Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.V, b.V); }
+    friend Float4 Min(Float4 a, Float4 b) { return _mm_min_ps(a.V, b.V); }
+    friend Float4 Max(Float4 a, Float4 b) { return _mm_max_ps(a.V, b.V); }
+    friend Float4 operator<=(Float4 a, Float4 b) { return _mm_cmple_ps(a.V, b.V); }
+    friend Float4 operator&(Float4 a, Float4 b) { return _mm_and_ps(a.V, b.V); }
+    friend Float4 operator|(Float4 a, Float4 b) { return _mm_or_ps(a.V, b.V); }
+    // Lane `i` of a comparison mask as bit `i`.
+    int Bits() const { return _mm_movemask_ps(V); }
+    double Sum() const {
+        float values[4];
+        Store(values);
+        return double(values[0]) + values[1] + values[2] + values[3];
+    }
+#elif defined(SIMD_NEON)
+    float32x4_t V;
+
+    Float4() = default;
+    Float4(float32x4_t v) : V(v) {}
+    Float4(float value) : V(vdupq_n_f32(value)) {}
+    static Float4 Load(const float *values) { return vld1q_f32(values); }
+    void Store(float *values) const { vst1q_f32(values, V); }
+
+    friend Float4 operator+(Float4 a, Float4 b) { return vaddq_f32(a.V, b.V); }
+    friend Float4 operator-(Float4 a, Float4 b) { return vsubq_f32(a.V, b.V); }
+    friend Float4 operator*(Float4 a, Float4 b) { return vmulq_f32(a.V, b.V); }
+    friend Float4 Min(Float4 a, Float4 b) { return vminq_f32(a.V, b.V); }
+    friend Float4 Max(Float4 a, Float4 b) { return vmaxq_f32(a.V, b.V); }
+    friend Float4 operator<=(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vcleq_f32(a.V, b.V)); }
+    friend Float4 operator&(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a.V), vreinterpretq_u32_f32(b.V))); }
+    friend Float4 operator|(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a.V), vreinterpretq_u32_f32(b.V))); }
+    int Bits() const {
+        static const int32_t Shifts[4]{0, 1, 2, 3};
+        const uint32x4_t signs = vshrq_n_u32(vreinterpretq_u32_f32(V), 31);
+        return vaddvq_u32(vshlq_u32(signs, vld1q_s32(Shifts)));
+    }
+    double Sum() const {
+        float values[4];
+        Store(values);
+        return double(values[0]) + values[1] + values[2] + values[3];
+    }
+#else
+    float V[4];
+
+    Float4() = default;
+    Float4(float value) : V{value, value, value, value} {}
+    static Float4 Load(const float *values) { return Map([values](uint i) { return values[i]; }); }
+    void Store(float *values) const { std::copy(V, V + 4, values); }
+
+    friend Float4 operator+(Float4 a, Float4 b) { return Map([&](uint i) { return a.V[i] + b.V[i]; }); }
+    friend Float4 operator-(Float4 a, Float4 b) { return Map([&](uint i) { return a.V[i] - b.V[i]; }); }
+    friend Float4 operator*(Float4 a, Float4 b) { return Map([&](uint i) { return a.V[i] * b.V[i]; }); }
+    friend Float4 Min(Float4 a, Float4 b) { return Map([&](uint i) { return std::min(a.V[i], b.V[i]); }); }
+    friend Float4 Max(Float4 a, Float4 b) { return Map([&](uint i) { return std::max(a.V[i], b.V[i]); }); }
+    // Masks are 1 (set) or 0 per lane.
+    friend Float4 operator<=(Float4 a, Float4 b) { return Map([&](uint i) { return a.V[i] <= b.V[i] ? 1.f : 0.f; }); }
+    friend Float4 operator&(Float4 a, Float4 b) { return Map([&](uint i) { return a.V[i] != 0 && b.V[i] != 0 ? 1.f : 0.f; }); }
+    friend Float4 operator|(Float4 a, Float4 b) { return Map([&](uint i) { return a.V[i] != 0 || b.V[i] != 0 ? 1.f : 0.f; }); }
+    int Bits() const { return (V[0] != 0) | (V[1] != 0) << 1 | (V[2] != 0) << 2 | (V[3] != 0) << 3; }
+    double Sum() const { return double(V[0]) + V[1] + V[2] + V[3]; }
+
+private:
+    template<typename F> static Float4 Map(F &&lane) {
+        Float4 result;
+        for (uint i = 0; i < 4; i++) result.V[i] = lane(i);
+        return result;
+    }
+#endif
+};
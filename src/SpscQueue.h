@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <optional>
+
+// Lock-free bounded queue for exactly one producer thread and one consumer thread.
+// Neither side ever blocks: `Push` fails when full and `Pop` returns `std::nullopt` when empty.
+template<typename T, size_t Capacity> struct SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+
+    bool Push(T &&value) {
+        const size_t tail = Tail.load(std::memory_order_relaxed);
+        if (tail - Head.load(std::memory_order_acquire) == Capacity) return false;
+
+        Slots[tail & (Capacity - 1)] = std::move(value);
+        Tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::optional<T> Pop() {
+        const size_t head = Head.load(std::memory_order_relaxed);
+        if (head == Tail.load(std::memory_order_acquire)) return {};
+
+        std::optional<T> value{std::move(Slots[head & (Capacity - 1)])};
+        Head.store(head + 1, std::memory_order_release);
+        return value;
+    }
+
+    size_t Size() const { return Tail.load(std::memory_order_acquire) - Head.load(std::memory_order_acquire); }
+
+private:
+    std::array<T, Capacity> Slots;
+    // Keep the producer and consumer indices on separate cache lines to avoid false sharing.
+    alignas(64) std::atomic<size_t> Head{0};
+    alignas(64) std::atomic<size_t> Tail{0};
+};
@@ -0,0 +1,120 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+struct TraceEvent {
+    const char *Name, *Category;
+    Trace::Clock::time_point Start, End;
+};
+
+// Written only by its own thread. `Count` is the total number of events ever written, published with release semantics.
+struct ThreadBuffer {
+    uint32_t ThreadId;
+    std::string ThreadName;
+    std::vector<TraceEvent> Events = std::vector<TraceEvent>(Trace::EventsPerThread);
+    std::atomic<uint64_t> Count{0};
+    std::atomic<bool> Retired{false}; // The thread has exited. Its events are kept until the next recording starts.
+};
+
+// Retires the thread's buffer on thread exit.
+struct ThreadBufferHandle {
+    std::shared_ptr<ThreadBuffer> Buffer;
+    const char *ThreadName{nullptr};
+    ~ThreadBufferHandle() {
+        if (Buffer) Buffer->Retired = true;
+    }
+};
+} // namespace
+
+static std::mutex BuffersMutex; // Only guards registration and export, never recording.
+static std::vector<std::shared_ptr<ThreadBuffer>> Buffers;
+static uint32_t NextThreadId = 1;
+static Trace::Clock::time_point RecordingStart;
+static thread_local ThreadBufferHandle CurrentThread;
+
+static ThreadBuffer &GetThreadBuffer() {
+    if (!CurrentThread.Buffer) {
+        auto buffer = std::make_shared<ThreadBuffer>();
+        std::lock_guard lock(BuffersMutex);
+        buffer->ThreadId = NextThreadId++;
+        buffer->ThreadName = CurrentThread.ThreadName ? CurrentThread.ThreadName : std::format("Thread {}", buffer->ThreadId);
+        Buffers.push_back(buffer);
+        CurrentThread.Buffer = std::move(buffer);
+    }
+    return *CurrentThread.Buffer;
+}
+
+void Trace::SetEnabled(bool enabled) {
+    if (enabled && !IsEnabled()) {
+        std::lock_guard lock(BuffersMutex);
+        std::erase_if(Buffers, [](const auto &buffer) { return buffer->Retired.load(); });
+        RecordingStart = Clock::now(); // Earlier events in live buffers are skipped on export.
+    }
+    Enabled = enabled;
+}
+
+void Trace::Record(const char *name, const char *category, Clock::time_point start, Clock::time_point end) {
+    auto &buffer = GetThreadBuffer();
+    const uint64_t count = buffer.Count.load(std::memory_order_relaxed);
+    buffer.Events[count % EventsPerThread] = {name, category, start, end};
+    buffer.Count.store(count + 1, std::memory_order_release);
+}
+
+void Trace::SetThreadName(const char *name) {
+    CurrentThread.ThreadName = name;
+    if (CurrentThread.Buffer) {
+        std::lock_guard lock(BuffersMutex);
+        CurrentThread.Buffer->ThreadName = name;
+    }
+}
+
+static std::string EscapeJson(const char *str) {
+    std::string escaped;
+    for (const char *c = str; *c; c++) {
+        if (*c == '"' || *c == '\\') escaped += '\\';
+        escaped += *c;
+    }
+    return escaped;
+}
+
+bool Trace::WriteJson(const fs::path &path) {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+
+    std::lock_guard lock(BuffersMutex);
+    const auto ToMicroseconds = [](Clock::duration d) { return std::chrono::duration<double, std::micro>(d).count(); };
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    for (const auto &buffer : Buffers) {
+        out << (first ? "" : ",\n") << std::format(R"({{"name": "thread_name", "ph": "M", "pid": 1, "tid": {}, "args": {{"name": "{}"}}}})", buffer->ThreadId, EscapeJson(buffer->ThreadName.c_str()));
+        first = false;
+
+        // Copy the valid window of the ring, then drop anything the writer overwrote while we were copying.
+        const uint64_t end = buffer->Count.load(std::memory_order_acquire);
+        const uint64_t begin = end > EventsPerThread ? end - EventsPerThread : 0;
+        std::vector<TraceEvent> events;
+        events.reserve(end - begin);
+        for (uint64_t i = begin; i < end; i++) events.push_back(buffer->Events[i % EventsPerThread]);
+        // The writer may also be midway through the (unpublished) event after the last one it published.
+        const uint64_t written_after_copy = buffer->Count.load(std::memory_order_acquire) + 1;
+        const uint64_t num_overwritten = std::min<uint64_t>(events.size(), written_after_copy > EventsPerThread + begin ? written_after_copy - EventsPerThread - begin : 0);
+
+        for (uint64_t i = num_overwritten; i < events.size(); i++) {
+            const auto &e = events[i];
+            if (e.Start < RecordingStart) continue;
+            out << std::format(
+                ",\n" R"({{"name": "{}", "cat": "{}", "ph": "X", "pid": 1, "tid": {}, "ts": {:.3f}, "dur": {:.3f}}})",
+                EscapeJson(e.Name), EscapeJson(e.Category), buffer->ThreadId, ToMicroseconds(e.Start - RecordingStart), ToMicroseconds(e.End - e.Start)
+            );
+        }
+    }
+    out << "\n]}\n";
+    return out.good();
+}
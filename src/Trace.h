@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// Records timestamped events for export as Chrome trace-event JSON (open in chrome://tracing or ui.perfetto.dev).
+// Each thread writes to its own fixed-size ring buffer (oldest events are overwritten), so recording never takes a lock.
+// While recording is off, a `Trace::Scope` costs a single relaxed atomic load, so scopes can stay in release builds.
+// Event names and categories must be string literals (only their pointers are stored).
+struct Trace {
+    using Clock = std::chrono::steady_clock;
+
+    inline static const size_t EventsPerThread = 1 << 16;
+
+    struct Scope {
+        Scope(const char *name, const char *category) : Name(IsEnabled() ? name : nullptr), Category(category) {
+            if (Name) Start = Clock::now();
+        }
+        ~Scope() {
+            if (Name) Record(Name, Category, Start, Clock::now());
+        }
+
+    private:
+        const char *Name, *Category;
+        Clock::time_point Start;
+    };
+
+    static bool IsEnabled() { return Enabled.load(std::memory_order_relaxed); }
+    // Starting a new recording discards all previously recorded events.
+    static void SetEnabled(bool);
+
+    static void Record(const char *name, const char *category, Clock::time_point start, Clock::time_point end);
+    static void SetThreadName(const char *); // Shown in the trace viewer.
+
+    // Safe to call while other threads are recording. Returns false if the file couldn't be written.
+    static bool WriteJson(const fs::path &);
+
+private:
+    inline static std::atomic<bool> Enabled{false};
+};
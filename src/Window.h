@@ -9,6 +9,10 @@ struct WindowsState {
     Window SceneControls{"Scene controls"};
     Window Scene{"Scene"};
     Window MoleculeChainControls{"Molecule chain"};
+    Window Gallery{"Gallery", false};
+    Window ImageExport{"High-quality image", false};
+    Window Profiler{"Profiler", false};
+    Window Memory{"Memory", false};
     // By default, the demo window is docked, but not visible.
     Window ImGuiDemo{"Dear ImGui demo", false};
 };
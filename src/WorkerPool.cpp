@@ -0,0 +1,65 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+#include "Trace.h"
+
+// Idle workers exit after this long without tasks, so the pool only holds threads while there's work.
+static const auto IdleTimeout = std::chrono::seconds(2);
+
+WorkerPool &WorkerPool::Get() {
+    static WorkerPool Pool;
+    return Pool;
+}
+
+WorkerPool::~WorkerPool() {
+    std::unique_lock lock{Mutex};
+    Stopping = true;
+    Tasks.clear();
+    TaskAdded.notify_all();
+    WorkerExited.wait(lock, [this] { return NumWorkers == 0; });
+}
+
+void WorkerPool::Submit(std::function<void()> &&task) {
+    std::lock_guard lock{Mutex};
+    if (Stopping) return;
+
+    Tasks.push_back(std::move(task));
+    // Leave a core for the UI.
+    static const uint MaxWorkers = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    if (NumIdle >= Tasks.size() || NumWorkers >= MaxWorkers) {
+        TaskAdded.notify_one();
+        return;
+    }
+    NumWorkers++;
+    std::thread{[this] { Work(); }}.detach();
+}
+
+void WorkerPool::Work() {
+    Trace::SetThreadName("Pool worker");
+    std::unique_lock lock{Mutex};
+    while (true) {
+        NumIdle++;
+        const bool has_task = TaskAdded.wait_for(lock, IdleTimeout, [this] { return Stopping || !Tasks.empty(); });
+        NumIdle--;
+        if (Stopping || !has_task) break;
+
+        auto task = std::move(Tasks.front());
+        Tasks.pop_front();
+        lock.unlock();
+        // A throwing task would otherwise terminate the process from this detached thread.
+        try {
+            task();
+        } catch (const std::exception &e) {
+            std::cerr << "Worker pool task failed: " << e.what() << std::endl;
+        } catch (...) {
+            std::cerr << "Worker pool task failed with an unknown exception" << std::endl;
+        }
+        task = {}; // Release captures before relocking.
+        lock.lock();
+    }
+    NumWorkers--;
+    WorkerExited.notify_all();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Background threads shared by all loaded chains (e.g. for `ChainAnalysis`), so the number of threads doesn't grow with the number of chains.
+// Threads are started as tasks are queued, up to one per core but one (left for the UI), and exit after idling for a while.
+// Tasks run in the order they're queued. Anything a task uses must outlive it (e.g. capture shared state by `std::shared_ptr`).
+// Exceptions thrown by a task are reported and dropped, so the worker keeps running.
+struct WorkerPool {
+    static WorkerPool &Get(); // Process-wide.
+
+    ~WorkerPool(); // Waits for running tasks. Tasks still queued are dropped.
+
+    void Submit(std::function<void()> &&);
+
+private:
+    void Work();
+
+    std::mutex Mutex;
+    std::condition_variable TaskAdded, WorkerExited;
+    std::deque<std::function<void()>> Tasks;
+    uint NumWorkers{0}, NumIdle{0};
+    bool Stopping{false};
+};
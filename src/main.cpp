@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <cstdlib>
+#include <format>
 #include <iostream>
 
 #include <GL/glew.h>
@@ -12,18 +15,98 @@
 #include <SDL_opengl.h>
 #include <nfd.h>
 
+#include "FrameStream.h"
+#include "Gallery.h"
+#include "ImageExport.h"
 #include "Molecule.h"
+#include "Profiler.h"
 #include "Scene.h"
+#include "Trace.h"
 #include "Window.h"
 
 static WindowsState Windows;
 
 static std::unique_ptr<Scene> MainScene;
 static std::unique_ptr<MoleculeChain> CurrMoleculeChain;
+// Shown side by side with `CurrMoleculeChain` (in scene viewports 1..N), following its frame and display settings.
+static std::vector<std::unique_ptr<MoleculeChain>> ComparisonChains;
+static std::unique_ptr<Gallery> CurrGallery;
+static std::unique_ptr<FrameStream> CurrFrameStream; // When set, received frames are appended to `CurrMoleculeChain`.
+static std::unique_ptr<ImageExport> CurrImageExport;
+
+// Each appended frame creates new GL buffers, so cap how many we take per UI frame to keep the UI responsive.
+static const uint MaxStreamFramesPerUiFrame = 8;
+
+// When set, the loop blocks on events while nothing is changing, instead of redrawing every vsync.
+static bool RenderOnDemand = true;
+// ImGui can take a few frames to settle after input (hover, navigation and layout updates).
+static const uint ActiveFramesAfterEvent = 3;
 
 using namespace ImGui;
 
+static void UpdateSceneViewports() {
+    MainScene->SetNumViewports(ComparisonChains.size() + 1);
+    MainScene->ViewportLabels.clear();
+    if (ComparisonChains.empty()) return;
+
+    MainScene->ViewportLabels.push_back(CurrMoleculeChain ? CurrMoleculeChain->GetName() : "");
+    for (const auto &chain : ComparisonChains) MainScene->ViewportLabels.push_back(chain->GetName());
+}
+
+static void RenderChainMemoryRows(const MoleculeChain &chain) {
+    const auto report = chain.GetMemoryReport();
+    report.Total().RenderTableRow(std::format("Chain: {} ({} molecules)", chain.GetName(), chain.Molecules.size()).c_str());
+    Indent();
+    report.AtomMeshes.RenderTableRow("Atom meshes");
+    report.BondMeshes.RenderTableRow("Bond meshes");
+    if (report.GridMeshes.TotalCpu() > 0) report.GridMeshes.RenderTableRow("Grid meshes");
+    report.ParseBuffers.RenderTableRow("Parse buffers");
+    report.Analysis.RenderTableRow("Analysis");
+    Unindent();
+}
+
+static void RenderMemoryWindow() {
+    // Everything reachable from the app's state. Live GPU allocations not covered by this have leaked.
+    MemoryUsage accounted = MainScene->GetMemoryUsage();
+    accounted += Molecule::GetSharedGeometryMemoryUsage();
+    if (MemoryUsage::BeginTable("Memory")) {
+        MainScene->GetMemoryUsage().RenderTableRow("Scene");
+        Molecule::GetSharedGeometryMemoryUsage().RenderTableRow("Shared molecule geometry");
+        if (CurrMoleculeChain) {
+            RenderChainMemoryRows(*CurrMoleculeChain);
+            accounted += CurrMoleculeChain->GetMemoryReport().Total();
+        }
+        for (const auto &chain : ComparisonChains) {
+            RenderChainMemoryRows(*chain);
+            accounted += chain->GetMemoryReport().Total();
+        }
+        if (CurrGallery) {
+            const auto gallery_usage = CurrGallery->GetMemoryUsage();
+            gallery_usage.RenderTableRow("Gallery");
+            accounted += gallery_usage;
+        }
+        if (CurrImageExport) {
+            const auto export_usage = CurrImageExport->GetMemoryUsage();
+            export_usage.RenderTableRow("Image export");
+            accounted += export_usage;
+        }
+        EndTable();
+    }
+
+    SeparatorText("Live GPU allocations");
+    for (size_t i = 0; i < size_t(MemoryCategory::Count); i++) {
+        Text("%s: %s", MemoryCategoryNames[i], FormatBytes(LiveGpuMemory.GpuBytes[i]).c_str());
+    }
+    const int64_t untracked = int64_t(LiveGpuMemory.TotalGpu()) - int64_t(accounted.TotalGpu());
+    if (untracked != 0) TextColored({1, 0.6f, 0.2f, 1}, "Not owned by any loaded object: %s%s", untracked < 0 ? "-" : "", FormatBytes(std::abs(untracked)).c_str());
+    else TextDisabled("All GPU allocations are owned by loaded objects.");
+}
+
 int main(int, char **) {
+    // Record from startup (including shader compilation) if requested. Stop and save from the File menu.
+    Trace::SetThreadName("Main");
+    if (std::getenv("GEOLDMVIZ_TRACE")) Trace::SetEnabled(true);
+
     // Setup SDL
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER | SDL_INIT_GAMEPAD) != 0) {
         printf("Error: %s\n", SDL_GetError());
@@ -126,20 +209,60 @@ int main(int, char **) {
 
     // Main loop
     bool done = false;
+    uint active_frames = ActiveFramesAfterEvent;
     while (!done) {
+        // Work in progress that needs frames without any input.
+        const bool busy = (CurrFrameStream && CurrFrameStream->IsConnected()) ||
+            (Windows.MoleculeChainControls.Visible && CurrMoleculeChain && (CurrMoleculeChain->IsAnimating() || CurrMoleculeChain->IsAnalyzing())) ||
+            (CurrMoleculeChain && CurrMoleculeChain->IsAligning()) ||
+            std::any_of(ComparisonChains.begin(), ComparisonChains.end(), [](const auto &chain) { return chain->IsAligning(); }) ||
+            (Windows.Gallery.Visible && CurrGallery && CurrGallery->HasPendingThumbnails()) ||
+            (Windows.ImageExport.Visible && CurrImageExport && CurrImageExport->IsRendering());
+        if (RenderOnDemand && active_frames == 0 && !busy) {
+            // Wait without taking the event, so it's handled below.
+            // Wake up periodically anyway, for time-based UI state (hover tooltips, text cursor blink) and new stream connections.
+            SDL_WaitEventTimeout(nullptr, IsAnyItemHovered() || io.WantTextInput ? 100 : 500);
+        }
+
+        Profiler::BeginFrame();
         // Poll and handle events (inputs, window resize, etc.)
         // You can read the io.WantCaptureMouse, io.WantCaptureKeyboard flags to tell if dear imgui wants to use your inputs.
         // - When io.WantCaptureMouse is true, do not dispatch mouse input data to your main application, or clear/overwrite your copy of the mouse data.
         // - When io.WantCaptureKeyboard is true, do not dispatch keyboard input data to your main application, or clear/overwrite your copy of the keyboard data.
         // Generally you may always pass all inputs to dear imgui, and hide them from your application based on those two flags.
-        SDL_Event event;
-        while (SDL_PollEvent(&event)) {
-            ImGui_ImplSDL3_ProcessEvent(&event);
-            if (event.type == SDL_EVENT_QUIT || (event.type == SDL_EVENT_WINDOW_CLOSE_REQUESTED && event.window.windowID == SDL_GetWindowID(window)))
-                done = true;
+        {
+            Profiler::CpuZone zone{"Events"};
+            SDL_Event event;
+            while (SDL_PollEvent(&event)) {
+                active_frames = ActiveFramesAfterEvent;
+                ImGui_ImplSDL3_ProcessEvent(&event);
+                if (event.type == SDL_EVENT_QUIT || (event.type == SDL_EVENT_WINDOW_CLOSE_REQUESTED && event.window.windowID == SDL_GetWindowID(window)))
+                    done = true;
+            }
         }
 
+        if (CurrFrameStream) {
+            Profiler::CpuZone zone{"Stream ingest"};
+            bool drained = false;
+            for (uint i = 0; i < MaxStreamFramesPerUiFrame && !drained; i++) {
+                auto frame = CurrFrameStream->Pop();
+                if (!frame) {
+                    drained = true;
+                    continue;
+                }
+                CurrMoleculeChain->SetStreaming(true);
+                CurrMoleculeChain->Append(std::move(*frame), std::format("stream/frame_{:04}", CurrMoleculeChain->Molecules.size()));
+            }
+            // Until the producer disconnects and its queued frames are all appended.
+            CurrMoleculeChain->SetStreaming(CurrFrameStream->IsConnected() || !drained);
+        } else if (CurrMoleculeChain) {
+            CurrMoleculeChain->SetStreaming(false);
+        }
+        if (CurrMoleculeChain) CurrMoleculeChain->Update();
+        for (auto &chain : ComparisonChains) chain->Update();
+
         // Start the Dear ImGui frame
+        Profiler::CpuZone ui_zone{"Build UI"};
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplSDL3_NewFrame();
         NewFrame();
@@ -148,11 +271,14 @@ int main(int, char **) {
         if (GetFrameCount() == 1) {
             auto demo_node_id = DockBuilderSplitNode(dockspace_id, ImGuiDir_Right, 0.3f, nullptr, &dockspace_id);
             DockBuilderDockWindow(Windows.ImGuiDemo.Name, demo_node_id);
+            DockBuilderDockWindow(Windows.Profiler.Name, demo_node_id);
+            DockBuilderDockWindow(Windows.Memory.Name, demo_node_id);
             auto scene_node_id = dockspace_id;
             auto controls_node_id = DockBuilderSplitNode(scene_node_id, ImGuiDir_Left, 0.4f, nullptr, &scene_node_id);
             DockBuilderDockWindow(Windows.SceneControls.Name, controls_node_id);
             DockBuilderDockWindow(Windows.MoleculeChainControls.Name, controls_node_id);
             DockBuilderDockWindow(Windows.Scene.Name, scene_node_id);
+            DockBuilderDockWindow(Windows.Gallery.Name, scene_node_id);
         }
         if (BeginMainMenuBar()) {
             if (BeginMenu("File")) {
@@ -163,7 +289,9 @@ int main(int, char **) {
                     };
                     nfdresult_t result = NFD_OpenDialog(&file_path, filter, 1, "res/");
                     if (result == NFD_OKAY) {
+                        CurrFrameStream.reset();
                         CurrMoleculeChain = std::make_unique<MoleculeChain>(fs::path(file_path), MainScene.get());
+                        UpdateSceneViewports();
                         NFD_FreePath(file_path);
                     } else if (result != NFD_CANCEL) {
                         std::cerr << "Error: " << NFD_GetError() << '\n';
@@ -173,28 +301,107 @@ int main(int, char **) {
                     nfdchar_t *folder_path;
                     nfdresult_t result = NFD_PickFolder(&folder_path, "res/");
                     if (result == NFD_OKAY) {
+                        CurrFrameStream.reset();
                         CurrMoleculeChain = std::make_unique<MoleculeChain>(fs::path(folder_path), MainScene.get());
+                        UpdateSceneViewports();
+                        NFD_FreePath(folder_path);
+                    } else if (result != NFD_CANCEL) {
+                        std::cerr << "Error: " << NFD_GetError() << '\n';
+                    }
+                }
+                if (MenuItem("Browse Molecules", nullptr)) {
+                    nfdchar_t *folder_path;
+                    nfdresult_t result = NFD_PickFolder(&folder_path, "res/");
+                    if (result == NFD_OKAY) {
+                        CurrGallery = std::make_unique<Gallery>(fs::path(folder_path));
+                        Windows.Gallery.Visible = true;
                         NFD_FreePath(folder_path);
                     } else if (result != NFD_CANCEL) {
                         std::cerr << "Error: " << NFD_GetError() << '\n';
                     }
                 }
+                if (MenuItem("Add Molecule Chain for Comparison", nullptr, false, bool(CurrMoleculeChain))) {
+                    nfdchar_t *folder_path;
+                    nfdresult_t result = NFD_PickFolder(&folder_path, "res/");
+                    if (result == NFD_OKAY) {
+                        ComparisonChains.emplace_back(std::make_unique<MoleculeChain>(fs::path(folder_path), MainScene.get(), ComparisonChains.size() + 1));
+                        UpdateSceneViewports();
+                        NFD_FreePath(folder_path);
+                    } else if (result != NFD_CANCEL) {
+                        std::cerr << "Error: " << NFD_GetError() << '\n';
+                    }
+                }
+                if (MenuItem("Clear Comparison", nullptr, false, !ComparisonChains.empty())) {
+                    ComparisonChains.clear();
+                    UpdateSceneViewports();
+                }
+                Separator();
+                if (MenuItem("Listen for molecule stream", nullptr, false, !CurrFrameStream)) {
+                    CurrMoleculeChain = std::make_unique<MoleculeChain>(MainScene.get());
+                    UpdateSceneViewports();
+                    CurrFrameStream = std::make_unique<FrameStream>();
+                }
+                if (MenuItem("Stop listening", nullptr, false, bool(CurrFrameStream))) CurrFrameStream.reset();
+                Separator();
+                if (MenuItem("Export high-quality image...", nullptr, false, bool(CurrMoleculeChain))) {
+                    if (!CurrImageExport) CurrImageExport = std::make_unique<ImageExport>();
+                    Windows.ImageExport.Visible = true;
+                }
+                Separator();
+                if (MenuItem("Start trace recording", nullptr, false, !Trace::IsEnabled())) Trace::SetEnabled(true);
+                if (MenuItem("Stop and save trace...", nullptr, false, Trace::IsEnabled())) {
+                    Trace::SetEnabled(false);
+                    nfdchar_t *file_path;
+                    nfdfilteritem_t filter[] = {
+                        {"Chrome trace", "json"},
+                    };
+                    nfdresult_t result = NFD_SaveDialog(&file_path, filter, 1, nullptr, "geoldmviz_trace.json");
+                    if (result == NFD_OKAY) {
+                        if (!Trace::WriteJson(file_path)) std::cerr << "Failed to write trace to " << file_path << '\n';
+                        NFD_FreePath(file_path);
+                    } else if (result != NFD_CANCEL) {
+                        std::cerr << "Error: " << NFD_GetError() << '\n';
+                    }
+                }
                 EndMenu();
             }
             if (BeginMenu("Windows")) {
                 MenuItem(Windows.SceneControls.Name, nullptr, &Windows.SceneControls.Visible);
                 MenuItem(Windows.MoleculeChainControls.Name, nullptr, &Windows.MoleculeChainControls.Visible);
                 MenuItem(Windows.Scene.Name, nullptr, &Windows.Scene.Visible);
+                MenuItem(Windows.Gallery.Name, nullptr, &Windows.Gallery.Visible);
+                MenuItem(Windows.ImageExport.Name, nullptr, &Windows.ImageExport.Visible);
+                MenuItem(Windows.Profiler.Name, nullptr, &Windows.Profiler.Visible);
+                MenuItem(Windows.Memory.Name, nullptr, &Windows.Memory.Visible);
                 MenuItem(Windows.ImGuiDemo.Name, nullptr, &Windows.ImGuiDemo.Visible);
+                Separator();
+                MenuItem("Render on demand", nullptr, &RenderOnDemand);
                 EndMenu();
             }
             EndMainMenuBar();
         }
 
         if (Windows.ImGuiDemo.Visible) ShowDemoWindow(&Windows.ImGuiDemo.Visible);
+        if (Windows.Profiler.Visible) {
+            Begin(Windows.Profiler.Name, &Windows.Profiler.Visible);
+            Profiler::RenderWindow();
+            End();
+        }
+
+        if (Windows.Memory.Visible) {
+            Begin(Windows.Memory.Name, &Windows.Memory.Visible);
+            RenderMemoryWindow();
+            End();
+        }
 
         if (Windows.MoleculeChainControls.Visible) {
             Begin(Windows.MoleculeChainControls.Name, &Windows.MoleculeChainControls.Visible);
+            if (CurrFrameStream) {
+                if (!CurrFrameStream->IsListening()) Text("Failed to listen on %s", CurrFrameStream->SocketPath.c_str());
+                else if (CurrFrameStream->IsConnected()) Text("Streaming from %s (%u frames)", CurrFrameStream->SocketPath.c_str(), CurrFrameStream->NumReceived());
+                else Text("Waiting for a producer on %s", CurrFrameStream->SocketPath.c_str());
+                Separator();
+            }
             if (CurrMoleculeChain == nullptr) {
                 Text("No molecule chain has been loaded.");
             } else {
@@ -202,6 +409,10 @@ int main(int, char **) {
             }
             End();
         }
+        // Every frame, even with the controls closed, since the primary chain also changes by animating and streaming.
+        if (CurrMoleculeChain) {
+            for (auto &chain : ComparisonChains) chain->SyncTo(*CurrMoleculeChain);
+        }
         if (Windows.SceneControls.Visible) {
             Begin(Windows.SceneControls.Name, &Windows.SceneControls.Visible);
             if (MainScene == nullptr) {
@@ -212,21 +423,62 @@ int main(int, char **) {
             End();
         }
 
+        if (Windows.Gallery.Visible) {
+            Begin(Windows.Gallery.Name, &Windows.Gallery.Visible);
+            if (CurrGallery == nullptr) {
+                Text("No molecule directory has been opened. Use \"File->Browse Molecules\".");
+            } else if (auto open_path = CurrGallery->Render()) {
+                CurrFrameStream.reset();
+                CurrMoleculeChain = std::make_unique<MoleculeChain>(*open_path, MainScene.get());
+                UpdateSceneViewports();
+            }
+            End();
+        }
+
+        if (Windows.ImageExport.Visible) {
+            Begin(Windows.ImageExport.Name, &Windows.ImageExport.Visible);
+            if (!CurrImageExport) CurrImageExport = std::make_unique<ImageExport>();
+            if (CurrImageExport->Render(*MainScene, CurrMoleculeChain.get())) {
+                nfdchar_t *file_path;
+                nfdfilteritem_t filter[] = {
+                    {"PNG image", "png"},
+                };
+                nfdresult_t result = NFD_SaveDialog(&file_path, filter, 1, nullptr, "geoldmviz.png");
+                if (result == NFD_OKAY) {
+                    if (!CurrImageExport->Save(file_path)) std::cerr << "Failed to write image to " << file_path << '\n';
+                    NFD_FreePath(file_path);
+                } else if (result != NFD_CANCEL) {
+                    std::cerr << "Error: " << NFD_GetError() << '\n';
+                }
+            }
+            End();
+        }
+
         if (Windows.Scene.Visible) {
             PushStyleVar(ImGuiStyleVar_WindowPadding, {0, 0});
             Begin(Windows.Scene.Name, &Windows.Scene.Visible);
 
-            MainScene->Render();
+            // Keep drawing while the scene changes, since changes often continue (e.g. camera gizmo animations),
+            // and until it's back to full resolution.
+            if (MainScene->Render()) active_frames = std::max(active_frames, 2u);
+            if (CurrMoleculeChain) CurrMoleculeChain->UpdatePicking();
+            for (auto &chain : ComparisonChains) chain->UpdatePicking();
             End();
             PopStyleVar();
         }
 
+        ui_zone.End();
+
         // Rendering
+        Profiler::CpuZone render_zone{"Render UI"};
         Render();
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        {
+            Profiler::GpuZone gpu_zone{"UI pass"};
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
 
-        ImGui_ImplOpenGL3_RenderDrawData(GetDrawData());
+            ImGui_ImplOpenGL3_RenderDrawData(GetDrawData());
+        }
 
         // Update and Render additional Platform Windows
         // (Platform functions may change the current OpenGL context, so we save/restore it to make it easier to paste this code elsewhere.
@@ -238,17 +490,30 @@ int main(int, char **) {
             RenderPlatformWindowsDefault();
             SDL_GL_MakeCurrent(backup_current_window, backup_current_context);
         }
+        render_zone.End();
 
-        SDL_GL_SwapWindow(window);
+        {
+            Profiler::CpuZone zone{"Swap (incl. vsync wait)"};
+            SDL_GL_SwapWindow(window);
+        }
+        if (active_frames > 0) active_frames--;
+        Profiler::EndFrame();
     }
 
     // Cleanup
+    ComparisonChains.clear();
+    CurrFrameStream.reset();
+    CurrMoleculeChain.reset();
+    CurrGallery.reset();
+    CurrImageExport.reset();
+    MainScene.reset();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplSDL3_Shutdown();
     DestroyContext();
 
     NFD_Quit();
 
+    GLContextAlive = false; // GL objects still alive (e.g. static shared geometry) are left for the context to free.
     SDL_GL_DeleteContext(gl_context);
     SDL_DestroyWindow(window);
     SDL_Quit();
@@ -0,0 +1,317 @@
+// Headless validation of whole sampling runs: bonds, valence stability, connectivity and formula for every molecule,
+// with the app's bond detection and metrics (see `ComputeFrameMetrics`). Needs no display or GL.
+// Usage: BatchAnalyze <xyz_dir_or_file_or_frame_file> [--csv results.csv] [--json results.jsonl] [--sdf molecules.sdf]
+//                     [--threads 0] [--batch 16384]
+// Inputs are a directory of XYZ (.txt) files, one XYZ file, or a binary chain of frames stored back to back as in `src/FrameProtocol.h`.
+// Molecules are analyzed and formatted on all cores in fixed-size batches, pipelined so that while one batch is analyzed,
+// the next is read and the previous one's results are written (in input order). Only three batches are held at a time, however large the run.
+// Binary frames are read by the reader thread. XYZ files are read by the workers, since each is parsed as a whole anyway.
+// A summary is always printed. `--json` writes one JSON object per line, and `--sdf` a V2000 SD file with bonds and the metrics as data fields.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "ChainAnalysis.h"
+#include "CommandLine.h"
+#include "DatasetConfig.h"
+#include "FrameProtocol.h"
+#include "MoleculeData.h"
+#include "Trace.h"
+
+static const QM9WithH DatasetConfig;
+
+// One molecule of a batch: where it's read from, and its results, formatted for each requested output.
+struct BatchItem {
+    uint64_t Index{0}; // In the whole run.
+    std::string Name;
+    fs::path Path; // Set for XYZ inputs, which are read on the workers.
+    std::optional<MoleculeData> Molecule; // Set for binary frames, which are read by the main thread.
+    bool Failed{false};
+    FrameMetrics Metrics;
+    std::string Csv, Json, Sdf;
+};
+
+struct Outputs {
+    std::ofstream Csv, Json, Sdf;
+};
+
+// Which outputs were requested. Read by the workers, which must not touch the streams the writer thread writes to.
+struct OutputFormats {
+    bool Csv, Json, Sdf;
+};
+
+// Escapes quotes and backslashes, which are the only special characters expected in file names.
+static std::string JsonString(const std::string &s) {
+    std::string escaped;
+    escaped.reserve(s.size() + 2);
+    escaped += '"';
+    for (const char c : s) {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    escaped += '"';
+    return escaped;
+}
+
+static std::string CsvString(const std::string &s) {
+    if (s.find_first_of(",\"\n") == std::string::npos) return s;
+    std::string quoted = "\"";
+    for (const char c : s) {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    return quoted + '"';
+}
+
+// V2000 counts are three digits wide.
+inline static const uint MaxSdfCount = 999;
+
+static std::string SdfRecord(const BatchItem &item, const std::string &formula) {
+    const auto &molecule = *item.Molecule;
+    std::string record = std::format("{}\n  GeoLDMViz\n\n{:3}{:3}  0  0  0  0  0  0  0  0999 V2000\n", item.Name, molecule.NumAtoms(), molecule.Bonds.size());
+    for (uint i = 0; i < molecule.NumAtoms(); i++) {
+        record += std::format("{:10.4f}{:10.4f}{:10.4f} {:<3} 0  0  0  0  0  0  0  0  0  0  0  0\n",
+                              molecule.X[i], molecule.Y[i], molecule.Z[i], DatasetConfig.AtomDecoder[molecule.Types[i]]);
+    }
+    // Atoms are numbered from 1.
+    for (const auto &bond : molecule.Bonds) record += std::format("{:3}{:3}{:3}  0  0  0  0\n", bond.B + 1, bond.A + 1, bond.Order);
+    const auto &m = item.Metrics;
+    record += std::format("M  END\n> <formula>\n{}\n\n> <stable>\n{}\n\n> <stable_atoms>\n{}\n\n> <largest_fragment>\n{}\n\n$$$$\n",
+                          formula, int(m.IsStable()), m.NumStableAtoms, m.LargestFragment);
+    return record;
+}
+
+static void Analyze(BatchItem &item, const OutputFormats &formats) {
+    if (!item.Molecule) {
+        try {
+            item.Molecule = ReadXyzFile(item.Path);
+        } catch (const std::exception &e) {
+            std::cerr << "Failed to parse " << item.Path << ": " << e.what() << std::endl;
+        }
+    }
+    if (!item.Molecule) {
+        item.Failed = true;
+        return;
+    }
+
+    auto &molecule = *item.Molecule;
+    molecule.Bonds = FindBonds(molecule);
+    item.Metrics = ComputeFrameMetrics(molecule);
+    const auto &m = item.Metrics;
+    const std::string formula = ChemicalFormula(molecule.Types);
+    const bool connected = m.LargestFragment == m.NumAtoms;
+    if (formats.Csv) {
+        item.Csv = std::format("{},{},{},{},{},{},{},{},{},{:.4f}\n", item.Index, CsvString(item.Name), formula, m.NumAtoms, m.NumBonds,
+                               m.NumStableAtoms, int(m.IsStable()), m.LargestFragment, int(connected), m.RadiusOfGyration);
+    }
+    if (formats.Json) {
+        item.Json = std::format(
+            "{{\"index\": {}, \"name\": {}, \"formula\": \"{}\", \"num_atoms\": {}, \"num_bonds\": {}, \"stable_atoms\": {}, "
+            "\"stable\": {}, \"largest_fragment\": {}, \"connected\": {}, \"radius_of_gyration\": {:.4f}}}\n",
+            item.Index, JsonString(item.Name), formula, m.NumAtoms, m.NumBonds, m.NumStableAtoms, m.IsStable(), m.LargestFragment, connected, m.RadiusOfGyration
+        );
+    }
+    if (formats.Sdf && molecule.NumAtoms() <= MaxSdfCount && molecule.Bonds.size() <= MaxSdfCount) item.Sdf = SdfRecord(item, formula);
+    item.Molecule.reset(); // Only the results are kept until the batch is written.
+}
+
+// Next frame of a binary chain. Returns false at the end of the file, or on a corrupt frame (reported), since frames can't be resynced.
+static bool ReadFrame(std::istream &in, MoleculeData &molecule, uint64_t index) {
+    FrameHeader header;
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header))) return false;
+    if (header.Magic != FrameMagic || header.NumAtoms > MaxFrameAtoms) {
+        std::cerr << "Corrupt frame header at frame " << index << ". Stopping." << std::endl;
+        return false;
+    }
+
+    std::vector<glm::vec3> positions(header.NumAtoms); // Interleaved in the file.
+    molecule.Types.resize(header.NumAtoms);
+    if (!in.read(reinterpret_cast<char *>(molecule.Types.data()), header.NumAtoms) ||
+        !in.read(reinterpret_cast<char *>(positions.data()), positions.size() * sizeof(glm::vec3))) {
+        std::cerr << "Truncated frame " << index << ". Stopping." << std::endl;
+        return false;
+    }
+    if (std::any_of(molecule.Types.begin(), molecule.Types.end(), [](uint8_t type) { return type >= DatasetConfig.AtomDecoder.size(); })) {
+        std::cerr << "Unknown atom type in frame " << index << ". Stopping." << std::endl;
+        return false;
+    }
+    molecule.X.resize(header.NumAtoms);
+    molecule.Y.resize(header.NumAtoms);
+    molecule.Z.resize(header.NumAtoms);
+    for (uint i = 0; i < header.NumAtoms; i++) {
+        molecule.X[i] = positions[i].x;
+        molecule.Y[i] = positions[i].y;
+        molecule.Z[i] = positions[i].z;
+    }
+    return true;
+}
+
+static int PrintUsage() {
+    std::cerr << "Usage: BatchAnalyze <xyz_dir_or_file_or_frame_file> [--csv results.csv] [--json results.jsonl] [--sdf molecules.sdf] "
+                 "[--threads 0] [--batch 16384]"
+              << std::endl;
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) return PrintUsage();
+
+    const fs::path input_path = argv[1];
+    fs::path csv_path, json_path, sdf_path;
+    uint num_threads = 0, batch_size = 16384;
+    // Every option takes a value.
+    for (int i = 2; i < argc; i += 2) {
+        const char *option = argv[i], *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            std::cerr << "Missing value for " << option << std::endl;
+            return PrintUsage();
+        }
+        if (std::strcmp(option, "--csv") == 0) csv_path = value;
+        else if (std::strcmp(option, "--json") == 0) json_path = value;
+        else if (std::strcmp(option, "--sdf") == 0) sdf_path = value;
+        else if (std::strcmp(option, "--threads") == 0 || std::strcmp(option, "--batch") == 0) {
+            if (!ParseCount(value, std::strcmp(option, "--threads") == 0 ? num_threads : batch_size)) {
+                std::cerr << "Invalid number for " << option << ": " << value << std::endl;
+                return PrintUsage();
+            }
+        } else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return PrintUsage();
+        }
+    }
+    batch_size = std::max(batch_size, 1u);
+    if (num_threads == 0) num_threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+    // XYZ files are listed up front (sorted, as `MoleculeChain` orders them), but only read a batch at a time.
+    std::vector<fs::path> xyz_paths;
+    std::ifstream frames;
+    if (fs::is_directory(input_path)) {
+        for (const auto &entry : fs::directory_iterator(input_path)) {
+            if (entry.path().extension() == ".txt") xyz_paths.push_back(entry.path());
+        }
+        if (xyz_paths.empty()) {
+            std::cerr << "No .txt files found in directory: " << input_path << std::endl;
+            return 1;
+        }
+        std::sort(xyz_paths.begin(), xyz_paths.end());
+    } else if (input_path.extension() == ".txt") {
+        xyz_paths.push_back(input_path);
+    } else {
+        frames.open(input_path, std::ios::binary);
+        if (!frames) {
+            std::cerr << "Failed to open " << input_path << std::endl;
+            return 1;
+        }
+    }
+
+    Outputs outputs;
+    const auto open_output = [](std::ofstream &out, const fs::path &path) {
+        if (path.empty()) return true;
+        out.open(path);
+        if (!out) std::cerr << "Failed to open " << path << " for writing" << std::endl;
+        return bool(out);
+    };
+    if (!open_output(outputs.Csv, csv_path) || !open_output(outputs.Json, json_path) || !open_output(outputs.Sdf, sdf_path)) return 1;
+    const OutputFormats formats{outputs.Csv.is_open(), outputs.Json.is_open(), outputs.Sdf.is_open()};
+    if (formats.Csv) outputs.Csv << "index,name,formula,num_atoms,num_bonds,stable_atoms,stable,largest_fragment,connected,radius_of_gyration\n";
+
+    uint64_t num_molecules = 0, num_failed = 0, num_stable = 0, num_connected = 0, num_atoms = 0, num_stable_atoms = 0, num_sdf_skipped = 0;
+    uint64_t num_read = 0, next_xyz = 0;
+    bool more = true;
+    const auto read_batch = [&](std::vector<BatchItem> &batch) {
+        Trace::Scope trace{"Read batch", "read"};
+        batch.clear();
+        if (!more) return;
+
+        if (frames.is_open()) {
+            MoleculeData molecule;
+            while (batch.size() < batch_size && (more = ReadFrame(frames, molecule, num_read + batch.size()))) {
+                const uint64_t index = num_read + batch.size();
+                batch.push_back({.Index = index, .Name = std::format("frame_{}", index), .Molecule = std::move(molecule)});
+                molecule = {};
+            }
+        } else {
+            for (; batch.size() < batch_size && next_xyz < xyz_paths.size(); next_xyz++) {
+                batch.push_back({.Index = next_xyz, .Name = xyz_paths[next_xyz].filename().string(), .Path = xyz_paths[next_xyz]});
+            }
+            more = next_xyz < xyz_paths.size();
+        }
+        num_read += batch.size();
+    };
+    // Workers take molecules from a shared counter, so faster threads take more.
+    const auto analyze_batch = [&](std::vector<BatchItem> &batch) {
+        Trace::Scope trace{"Analyze batch", "analyze"};
+        std::atomic<uint> next_item{0};
+        std::vector<std::thread> workers;
+        const uint batch_threads = std::min<uint>(num_threads, batch.size());
+        for (uint t = 0; t < batch_threads; t++) {
+            workers.emplace_back([&] {
+                Trace::SetThreadName("Batch worker");
+                for (uint i = next_item++; i < batch.size(); i = next_item++) Analyze(batch[i], formats);
+            });
+        }
+        for (auto &worker : workers) worker.join();
+    };
+    const auto write_batch = [&](std::vector<BatchItem> &batch) {
+        Trace::Scope trace{"Write batch", "write"};
+        for (const auto &item : batch) {
+            num_molecules++;
+            if (item.Failed) {
+                num_failed++;
+                continue;
+            }
+            const auto &m = item.Metrics;
+            num_stable += m.IsStable();
+            num_connected += m.LargestFragment == m.NumAtoms;
+            num_atoms += m.NumAtoms;
+            num_stable_atoms += m.NumStableAtoms;
+            if (formats.Csv) outputs.Csv << item.Csv;
+            if (formats.Json) outputs.Json << item.Json;
+            if (formats.Sdf) {
+                if (item.Sdf.empty()) num_sdf_skipped++;
+                else outputs.Sdf << item.Sdf;
+            }
+        }
+        batch.clear();
+    };
+
+    // Each step analyzes one batch while the next is read and the previous one is written.
+    // A batch is read into the buffer written in the step before, so the three stages never share one.
+    std::vector<BatchItem> batches[3];
+    const auto start_time = std::chrono::steady_clock::now();
+    read_batch(batches[0]);
+    for (uint step = 0;; step++) {
+        auto &analyzing = batches[step % 3], &reading = batches[(step + 1) % 3], &writing = batches[(step + 2) % 3];
+        if (analyzing.empty() && writing.empty()) break;
+
+        std::thread reader([&] {
+            Trace::SetThreadName("Batch reader");
+            read_batch(reading);
+        });
+        std::thread writer([&] {
+            Trace::SetThreadName("Batch writer");
+            write_batch(writing);
+        });
+        analyze_batch(analyzing);
+        reader.join();
+        writer.join();
+    }
+    const float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start_time).count();
+
+    const uint64_t num_analyzed = num_molecules - num_failed;
+    const auto percent = [](uint64_t count, uint64_t total) { return total == 0 ? 0.0 : 100.0 * count / total; };
+    std::cout << std::format("Analyzed {} molecules in {:.2f} s ({:.0f} molecules/s, {} threads)", num_analyzed, seconds, num_analyzed / std::max(seconds, 1e-6f), num_threads) << std::endl;
+    if (num_failed > 0) std::cout << num_failed << " molecules could not be read." << std::endl;
+    std::cout << std::format("Stable molecules: {} ({:.2f}%)\n", num_stable, percent(num_stable, num_analyzed));
+    std::cout << std::format("Stable atoms: {} of {} ({:.2f}%)\n", num_stable_atoms, num_atoms, percent(num_stable_atoms, num_atoms));
+    std::cout << std::format("Connected molecules: {} ({:.2f}%)", num_connected, percent(num_connected, num_analyzed)) << std::endl;
+    if (num_sdf_skipped > 0) std::cout << num_sdf_skipped << " molecules with more than " << MaxSdfCount << " atoms or bonds were left out of the SD file." << std::endl;
+    return 0;
+}
@@ -0,0 +1,110 @@
+// Headless high-quality still of a molecule, ray traced on the CPU (see `RayTracer`), for machines without a GPU.
+// Usage: RenderStill <xyz_file_or_chain_dir> [--out still.png] [--width 1920] [--height 1080] [--samples 64] [--threads 0]
+//                    [--atom-scale 0.5] [--bond-radius 1.2] [--bonds on|off] [--light-size 0.5] [--occlusion 1.5]
+// For a chain directory, the final molecule is rendered. The camera and lights match the app's defaults.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "CommandLine.h"
+#include "MoleculeData.h"
+#include "RayTracer.h"
+
+static int PrintUsage() {
+    std::cerr << "Usage: RenderStill <xyz_file_or_chain_dir> [--out still.png] [--width 1920] [--height 1080] [--samples 64] [--threads 0] "
+                 "[--atom-scale 0.5] [--bond-radius 1.2] [--bonds on|off] [--light-size 0.5] [--occlusion 1.5]"
+              << std::endl;
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) return PrintUsage();
+
+    fs::path molecule_path = argv[1], out_path = "still.png";
+    RayTracer::Settings settings;
+    float atom_scale = 0.5, bond_radius = 1.2;
+    bool bonds = true;
+    // Every option takes a value.
+    for (int i = 2; i < argc; i += 2) {
+        const char *option = argv[i], *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            std::cerr << "Missing value for " << option << std::endl;
+            return PrintUsage();
+        }
+        bool valid = true;
+        if (std::strcmp(option, "--out") == 0) out_path = value;
+        else if (std::strcmp(option, "--width") == 0) valid = ParseCount(value, settings.Width);
+        else if (std::strcmp(option, "--height") == 0) valid = ParseCount(value, settings.Height);
+        else if (std::strcmp(option, "--samples") == 0) valid = ParseCount(value, settings.Samples);
+        else if (std::strcmp(option, "--threads") == 0) valid = ParseCount(value, settings.NumThreads);
+        else if (std::strcmp(option, "--atom-scale") == 0) valid = ParseFloat(value, atom_scale);
+        else if (std::strcmp(option, "--bond-radius") == 0) valid = ParseFloat(value, bond_radius);
+        else if (std::strcmp(option, "--bonds") == 0) valid = ParseOnOff(value, bonds);
+        else if (std::strcmp(option, "--light-size") == 0) valid = ParseFloat(value, settings.LightSize);
+        else if (std::strcmp(option, "--occlusion") == 0) valid = ParseFloat(value, settings.OcclusionDistance);
+        else {
+            std::cerr << "Unknown option: " << option << std::endl;
+            return PrintUsage();
+        }
+        if (!valid) {
+            std::cerr << "Invalid value for " << option << ": " << value << std::endl;
+            return PrintUsage();
+        }
+    }
+    settings.Width = std::max(settings.Width, 1u);
+    settings.Height = std::max(settings.Height, 1u);
+    settings.Samples = std::max(settings.Samples, 1u);
+
+    if (fs::is_directory(molecule_path)) {
+        // Same (alphabetical) order as `MoleculeChain`, which also shows the final molecule first.
+        std::vector<fs::path> paths;
+        for (const auto &entry : fs::directory_iterator(molecule_path)) {
+            if (entry.path().extension() == ".txt") paths.push_back(entry.path());
+        }
+        if (paths.empty()) {
+            std::cerr << "No .txt files found in directory: " << molecule_path << std::endl;
+            return 1;
+        }
+        molecule_path = *std::max_element(paths.begin(), paths.end());
+    }
+    auto molecule = ReadXyzFile(molecule_path);
+    if (!molecule) {
+        std::cerr << "Failed to read " << molecule_path << std::endl;
+        return 1;
+    }
+    molecule->Bonds = FindBonds(*molecule);
+
+    RayTracer::Input input;
+    input.AddMolecule(*molecule, atom_scale, bond_radius, bonds);
+    input.Lights = ThreePointLights();
+    // Same view direction and distance as the app's initial view of a molecule (see `Scene` and `MoleculeChain::SetMoleculeIndex`),
+    // but looking at the molecule's center rather than the origin.
+    static const float x_angle = M_PI * -0.1, y_angle = M_PI * 0.6;
+    static const glm::vec3 eye_direction(cosf(y_angle) * cosf(x_angle), sinf(x_angle), sinf(y_angle) * cosf(x_angle));
+    const auto [bounds_min, bounds_max] = molecule->ComputeBounds();
+    const glm::vec3 center = (bounds_min + bounds_max) * 0.5f;
+    input.CameraView = glm::lookAt(center + eye_direction * glm::distance(bounds_min, bounds_max) * 2.f, center, glm::vec3{0, 1, 0});
+
+    std::cout << "Rendering " << molecule_path << " (" << molecule->NumAtoms() << " atoms) at " << settings.Width << "x" << settings.Height
+              << ", " << settings.Samples << " samples per pixel" << std::endl;
+    RayTracer tracer{std::move(input), settings};
+    while (!tracer.IsDone()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        std::cout << "\r" << int(tracer.GetProgress() * 100) << "%" << std::flush;
+    }
+    tracer.Wait();
+    std::cout << "\rDone in " << tracer.GetElapsedSeconds() << " s" << std::endl;
+
+    if (!WritePng(out_path, tracer.GetImage(), settings.Width, settings.Height)) {
+        std::cerr << "Failed to write " << out_path << std::endl;
+        return 1;
+    }
+    std::cout << "Wrote " << out_path << std::endl;
+    return 0;
+}
@@ -0,0 +1,95 @@
+// Stand-in for a running sampler: replays a directory of XYZ chain files to a listening GeoLDMViz over the frame stream socket.
+// Usage: ReplayChain [chain_dir=res/chain_0] [frames_per_second=30] [socket_path=/tmp/geoldmviz.sock]
+// In GeoLDMViz, choose "File->Listen for molecule stream" before (or after) starting this program.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "CommandLine.h"
+#include "MoleculeData.h"
+#include "FrameProtocol.h"
+
+static bool SendAll(int fd, const void *data, size_t size) {
+    const auto *bytes = static_cast<const char *>(data);
+    while (size > 0) {
+        const ssize_t n = send(fd, bytes, size, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        bytes += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool SendFrame(int fd, const MoleculeData &molecule) {
+    const FrameHeader header{FrameMagic, molecule.NumAtoms()};
+    std::vector<glm::vec3> positions(molecule.NumAtoms()); // Interleaved on the wire.
+    for (uint i = 0; i < molecule.NumAtoms(); i++) positions[i] = molecule.GetPosition(i);
+    return SendAll(fd, &header, sizeof(header)) &&
+        SendAll(fd, molecule.Types.data(), molecule.Types.size()) &&
+        SendAll(fd, positions.data(), positions.size() * sizeof(glm::vec3));
+}
+
+int main(int argc, char **argv) {
+    const fs::path chain_path = argc > 1 ? argv[1] : "res/chain_0";
+    // The frame duration must fit in a `steady_clock::duration`.
+    static const float MinFramesPerSecond = 0.001;
+    float frames_per_second = 30;
+    if (argc > 2 && (!ParseFloat(argv[2], frames_per_second) || frames_per_second < MinFramesPerSecond)) {
+        std::cerr << "Invalid frames per second: " << argv[2] << " (must be a number of at least " << MinFramesPerSecond << ")" << std::endl;
+        std::cerr << "Usage: ReplayChain [chain_dir=res/chain_0] [frames_per_second=30] [socket_path=/tmp/geoldmviz.sock]" << std::endl;
+        return 1;
+    }
+    const std::string socket_path = argc > 3 ? argv[3] : DefaultFrameSocketPath;
+
+    std::vector<fs::path> paths;
+    for (const auto &entry : fs::directory_iterator(chain_path)) {
+        if (entry.path().extension() == ".txt") paths.push_back(entry.path());
+    }
+    std::sort(paths.begin(), paths.end()); // Same (alphabetical) order as `MoleculeChain`.
+    if (paths.empty()) {
+        std::cerr << "No .txt files found in directory: " << chain_path << std::endl;
+        return 1;
+    }
+
+    // A viewer closing the socket mid-replay fails the next send with `EPIPE`, rather than killing the process.
+    // (`MSG_NOSIGNAL` would only cover Linux.)
+    std::signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+        std::cerr << "Failed to connect to " << socket_path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    const auto frame_duration = std::chrono::duration<double>(1 / frames_per_second);
+    auto next_frame_time = std::chrono::steady_clock::now();
+    for (const auto &path : paths) {
+        const auto molecule = ReadXyzFile(path);
+        if (!molecule) continue;
+        if (!SendFrame(fd, *molecule)) {
+            if (errno == EPIPE || errno == ECONNRESET) std::cerr << "Connection closed by the viewer." << std::endl;
+            else std::cerr << "Failed to send frame: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        std::cout << "Sent " << path.filename() << " (" << molecule->NumAtoms() << " atoms)" << std::endl;
+        next_frame_time += std::chrono::duration_cast<std::chrono::steady_clock::duration>(frame_duration);
+        std::this_thread::sleep_until(next_frame_time);
+    }
+
+    close(fd);
+    return 0;
+}